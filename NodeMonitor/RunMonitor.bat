@@ -1,4 +1,4 @@
-call  "C:\Program Files\nodejs\nodevars.bat"
-
-cd \files\LightingUPS\NodeMonitor
-node index.js
+call  "C:\Program Files\nodejs\nodevars.bat"
+
+cd \files\LightingUPS\NodeMonitor
+node index.js
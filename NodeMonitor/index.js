@@ -1,441 +1,766 @@
-var fs = require('fs');
-var express = require('express');
-var app = express();
-
-var childProcess = require('child_process');
-var execFile = childProcess.execFile;
-
-var http = require('http');
-var socketIo = require('socket.io');
-
-var httpServer = http.createServer(app);
-var io = socketIo(httpServer);
-
-var programmerPortName = 'COM7';
-var serialPortName = 'COM8';
-
-var SerialPort = require("serialport");
-var serialPort = new SerialPort(serialPortName, {
-  baudRate: 300
-});
-
-var serialPortRxLine = '';
-var serialPortRxLineNum = 0;
-var serialPortTimeoutTimer = null;
-var cmdQueue = [];
-var currentSWVer = null;
-var currentSettings = null;
-var currentTCalOffset = null;
-
-var savedSettings = null;
-var savedTCalOffset = null;
-
-var Mode = {
-    Monitoring : 'Monitoring',
-    Reprogramming : 'Reprogramming',
-    Exiting : 'Exiting'
-};
-var currentMode = Mode.Monitoring;
-
- function sendCommandToMicrocontroller (cmd) {
-    serialPort.write(cmd + "\r");
-    // start timeout timer
-    serialPortTimeoutTimer = setTimeout(serialPortTimedOut, 3000);
- }
-
-// requests info from the attached unit by queueing commands
-function requestUnitInfo ()
-{
-    cmdQueue.push("ver");
-    cmdQueue.push("settings");
-    cmdQueue.push("get tcaloffset");
-    cmdQueue.push("status");
-    sendCommandToMicrocontroller(cmdQueue[0]);
-}
-
-function serialPortTimedOut ()
-{
-    console.log('Serial port timeout');
-    switch (currentMode) {
-        case Mode.Monitoring :
-            serialPortRxLine = '';
-            if ((cmdQueue.length == 0) ||
-                ((cmdQueue.length == 1) && (cmdQueue[0] == 'status'))) {
-                // we were only requesting status. request all info
-                cmdQueue = [];
-                requestUnitInfo();
-            } else if (cmdQueue.length > 0) {
-                // there are commands in the queue - retry sending
-                sendCommandToMicrocontroller(cmdQueue[0]);
-            }
-            if (currentSettings !== null) {
-                // clear out old settings
-                currentSWVer = null;
-                currentSettings = null;
-                currentTCalOffset = null;
-                // blank out UI fields
-                sendSWVersionToClient(currentSWVer);
-                sendSettingsToClient(currentSettings);
-                sendTCalOffsetToClient(currentTCalOffset);
-            }
-            break;
-        case Mode.Exiting :
-            serialPort.close();
-            break;
-        default :
-            break;
-    }
-}
-
-//
-//  routes
-//
-app.get('/', function(req, res){
-    res.sendFile(__dirname + '/index.html');
-});
-app.get('/home', function(req, res){
-    res.sendFile(__dirname + '/home.html');
-});
-app.get('/status', function(req, res) {
-    queryStatus(res);
-});
-app.get('/w3.css', function(req, res){
-    res.sendFile(__dirname + '/w3.css');
-});
-
-// convert temperature from Centigrade to Fahrenheit
-function convertTempToF (
-    degC)
-{
-    var degF = ((parseFloat(degC) * 9.0) / 5.0) + 32.0;
-    return degF.toFixed(1) + '&#x2109';
-}
-
-function sendEventToUI (
-    eventName,
-    eventValue)
-{
-    var eventJSON =
-        '{ "type": "event", "data": ' + '{' +
-           '"name": "' + eventName + '", ' +
-           '"value": "' + eventValue + '"}' +
-        '}';
-    io.emit('controllerMessage', eventJSON);
-}
-
-function defaultSettings ()
-{
-    return {
-            "ID": "",
-            "Mode": "",
-            "Dark": "",
-            "Auto": "",
-            "Manual": ""
-        };
-}
-
-function sendSettingsToClient (
-    settings)
-{
-    if (settings == null) {
-        settings = defaultSettings();
-    }
-    sendEventToUI('ID', settings.ID);
-    sendEventToUI('Mode', settings.Mode);
-    sendEventToUI('Dark', settings.Dark);
-    sendEventToUI('Auto', settings.Auto);
-    sendEventToUI('Manual', settings.Manual);
-}
-
-function sendSWVersionToClient (
-    swver)
-{
-    if (swver == null) {
-        swver = '';
-    }
-    sendEventToUI('swver', swver);
-}
-
-function sendTCalOffsetToClient (
-    tcaloffset)
-{
-    if (tcaloffset == null) {
-        tcaloffset = '';
-    }
-    sendEventToUI('Tcaloffset', tcaloffset);
-}
-
-function commenceReprogramming ()
-{
-    // save current settings to restore after reprogramming
-    savedSettings = currentSettings;
-    savedTCalOffset = currentTCalOffset;
-
-    //  child process for re-flashing firmware with avrdude
-    var child = execFile('avrdude', [
-        '-p', 'attiny84',
-        '-P', programmerPortName,
-        '-c', 'avrispv2',
-        '-e',
-        '-U', 'flash:w:C:\\files\\LightingUPS\\firmware\\default\\LightingUPS.hex:i'
-        ]);
-    child.stdin.setEncoding('utf-8');
-
-    child.stdout.on('data', function (data) {
-        console.log('child stdout: "' + data + '"');
-    });
-
-    child.stderr.on('data', function (data) {
-        var logmsg = '';
-        for (i = 0; i < data.length; ++i) {
-            var c = data.charCodeAt(i);
-            if ((c < 32) || (c > 126)) {
-                logmsg += ('(' + c + ')');
-            } else {
-                logmsg += data[i];
-            }
-        }
-        console.log('child stderr: "' + logmsg + '"');
-    });
-
-    child.on('close', function () {
-        console.log('child exited');
-
-        // reestablish communications with unit
-        serialPortRxLine = '';
-        cmdQueue.push("ver");
-
-        // restore saved settings
-        if (savedSettings !== null) {
-            cmdQueue.push("set id " + savedSettings.ID);
-            cmdQueue.push("set mode " + savedSettings.Mode);
-            cmdQueue.push("set dark " + savedSettings.Dark);
-            cmdQueue.push("set auto " + savedSettings.Auto);
-            cmdQueue.push("set manual " + savedSettings.Manual);
-        }
-        if (savedTCalOffset !== null) {
-            cmdQueue.push("set tcaloffset " + savedTCalOffset);
-        }
-
-        // read settings afresh from  unit
-        cmdQueue.push("settings");
-        cmdQueue.push("get tcaloffset");
-        cmdQueue.push("status");
-        currentMode = Mode.Monitoring;
-        sendCommandToMicrocontroller(cmdQueue[0]);
-    });
-}
-
-function processMicrocontrollerMessage (
-    message)
-{
-    clearTimeout(serialPortTimeoutTimer);
-    var responseIsComplete = true;  // false indicates multi-line response
-    var gotExpectedResponse = true; // empty message is a valid response
-    if (message.length > 0) {
-        switch (message[0]) {
-            case 'O' :
-                // OK
-                break;
-            case 'U' :
-                // response to status query
-                console.log('got status string');
-                var tokens = message.trim().split(/\s+/);
-                sendEventToUI('UPS', tokens[0]);
-                sendEventToUI('BV', tokens[1]);
-                sendEventToUI('AC', tokens[2]);
-                sendEventToUI('C', tokens[3]);
-                sendEventToUI('Light', tokens[4]);
-                sendEventToUI('Motion', tokens[5]);
-                if (tokens.length > 6) {
-                    // V1.0 firmware did not use temperature sensor
-                    sendEventToUI('Temp', tokens[6]);
-                }
-                break;
-            case 'V' :
-                currentSWVer = message;
-                console.log('sw version: ' + currentSWVer);
-                sendSWVersionToClient(currentSWVer);
-                break;
-            case '{' :
-                console.log('receiving settings');
-                if (message.length == 1) {
-                    // firmware V1.0 format settings
-                    currentSettings = defaultSettings();
-                    responseIsComplete = false;
-                } else {
-                    if (message[message.length-1] == '}') {
-                        currentSettings = JSON.parse(message);
-                        sendSettingsToClient(currentSettings);
-                        console.log('end of settings');
-                    } else {
-                        gotExpectedResponse = false;
-                    }
-                }
-                break;
-            case ' ' :
-                var tokens = message.trim().split(/\s+/);
-                if (tokens.length == 2) {
-                    // V1.0 format setting
-                    responseIsComplete = false;
-                    console.log('got V1.0 setting:' + message);
-                    switch (tokens[0]) {
-                        case 'ID:'     : currentSettings.ID     = tokens[1]; break;
-                        case 'Mode:'   : currentSettings.Mode   = tokens[1]; break;
-                        case 'Dark:'   : currentSettings.Dark   = tokens[1]; break;
-                        case 'Auto:'   : currentSettings.Auto   = tokens[1]; break;
-                        case 'Manual:' : currentSettings.Manual = tokens[1]; break;
-                        case 'offset:' : currentTCalOffset      = tokens[1];
-                                         responseIsComplete = true;
-                                         sendTCalOffsetToClient(currentTCalOffset);
-                                         break;
-                        default        : console.log('unexpected setting name: "' + tokens[0] + '"');
-                    }
-                }
-                break;
-            case '}' :
-                // end of V1.0 format settings
-                console.log('end of settings');
-                sendSettingsToClient(currentSettings);
-                break;
-            case 't' :
-                var tokens = message.trim().split(/\s+/);
-                currentTCalOffset = tokens[1];
-                console.log('temp cal offset ' + currentTCalOffset);
-                sendTCalOffsetToClient(currentTCalOffset);
-                break;
-            case 'u' :
-                // unrecognized command
-                if (cmdQueue[0] == 'ver') {
-                    // probably a unit with V1.0 firmware
-                    console.log('ver unrecognized - assuming V1.0');
-                    currentSWVer = 'V1.0';
-                    sendSWVersionToClient(currentSWVer);
-                } else if (cmdQueue[0] == 'get tcaloffset') {
-                    // probably a unit with V1.0 firmware
-                    console.log('get tcaloffset unrecognized');
-                    currentTCalOffset = null;
-                } else {
-                    gotExpectedResponse = false;
-                }
-                break;
-            default :
-                gotExpectedResponse = false;
-                break;
-        }
-    }
-    if (responseIsComplete) {
-        if (gotExpectedResponse) {
-            cmdQueue.shift();
-        } else {
-            console.log('retrying ' + cmdQueue[0]);
-        }
-        if (cmdQueue.length == 0) {
-            // finished all queued commands.
-            // determine what to do next
-            switch (currentMode) {
-                case Mode.Monitoring :
-                    // request status
-                    cmdQueue.push('status');
-                    break;
-                case Mode.Reprogramming :
-                    // initiate reprogramming
-                    console.log('commence reprogramming...');
-                    clearTimeout(serialPortTimeoutTimer);
-                    commenceReprogramming();
-                    break;
-                case Mode.Exiting :
-                    serialPort.close();
-                    break;
-            }
-        }
-        if (cmdQueue.length > 0) {
-            sendCommandToMicrocontroller(cmdQueue[0]);
-        }
-    }
-}
-
-io.on('connection', function(socket){
-    console.log('got a connection.');
-    socket.on('serverCommand', function(msg){
-        console.log('got server command from client: ' + msg);
-        switch (msg) {
-            case 'refresh' :
-                sendSWVersionToClient(currentSWVer);
-                sendSettingsToClient(currentSettings);
-                sendTCalOffsetToClient(currentTCalOffset);
-                break;
-            case 'reprogram' :
-                currentMode = Mode.Reprogramming;
-                break;
-            default :
-                console.log('unrecognized server command');
-        }
-  });
-
-    socket.on('unitCommand', function(msg){
-      cmdQueue.push(msg);
-      console.log('got unit command from client: ' + msg);
-  });
-  socket.on('disconnect', function () {
-    console.log('lost connection.');
-  });
-});
-
-serialPort.on("open", function () {
-    console.log('serial port open');
-    serialPort.on('data', function(data) {
-        var dataStr = data.toString();
-        for (i = 0; i < dataStr.length; i++) {
-            var dataStrChar = dataStr[i];
-            switch(dataStrChar) {
-                case '\n' :
-                    break;
-                case '\r' :
-                    if (serialPortRxLine.length > 0) {
-                        console.log(++serialPortRxLineNum + ': ' + serialPortRxLine);
-                        processMicrocontrollerMessage(serialPortRxLine);
-                        serialPortRxLine = '';
-                    }
-                    break;
-                default:
-                    serialPortRxLine += dataStrChar;
-                    break;
-            }
-        }
-        // console.log('data received: ' + data);
-    }
-);
-
-serialPort.on('close', function() {
-    console.log('serial port closed');
-  }
-);
-
-  requestUnitInfo();
-});
-
-var port = 5401;
-httpServer.listen(port, function(){
-  console.log('listening on *:' + port);
-});
-
-// launch child process for chrome UI
-var browser = execFile('C:\\Program Files (x86)\\Google\\Chrome\\Application\\chrome.exe', [
-    '--new-window', 'http://localhost:' + port + '/home'
-    ]);
-browser.stdin.setEncoding('utf-8');
-
-browser.stdout.on('data', function (data) {
-    console.log('browser stdout: "' + data + '"');
-});
-browser.stderr.on('data', function (data) {
-    console.log('browser stderr: "' + data + '"');
-});
-
-browser.on('close', function () {
-    console.log('browser exited');
-    currentMode = Mode.Exiting;
-    io.close();
-    httpServer.close();
-});
+var fs = require('fs');
+var express = require('express');
+var app = express();
+
+var childProcess = require('child_process');
+var execFile = childProcess.execFile;
+
+var http = require('http');
+var socketIo = require('socket.io');
+
+var httpServer = http.createServer(app);
+var io = socketIo(httpServer);
+
+var programmerPortName = 'COM7';
+var serialPortName = 'COM8';
+// the firmware's SOFTWARESERIAL_BAUD_RATE: 300 unless it was built
+// with another (up to 1200), or 9600 with SOFTWARESERIAL_USI true
+var serialPortBaudRate = 300;
+
+var SerialPort = require("serialport");
+var serialPort = new SerialPort(serialPortName, {
+  baudRate: serialPortBaudRate
+});
+
+var serialPortRxLine = '';
+var serialPortRxLineNum = 0;
+var serialPortRxFrame = null;   // bytes of a binary frame so far
+var unitSendsFrames = false;    // the unit agreed to send binary status
+var serialPortTimeoutTimer = null;
+var cmdQueue = [];
+var currentSWVer = null;
+var currentSettings = null;
+var currentTCalOffset = null;
+
+var savedSettings = null;
+var savedTCalOffset = null;
+
+var Mode = {
+    Monitoring : 'Monitoring',
+    Reprogramming : 'Reprogramming',
+    Exiting : 'Exiting'
+};
+var currentMode = Mode.Monitoring;
+
+ function sendCommandToMicrocontroller (cmd) {
+    serialPort.write(cmd + "\r");
+    // start timeout timer
+    serialPortTimeoutTimer = setTimeout(serialPortTimedOut, 3000);
+ }
+
+// asks the unit to send status as binary frames with only the fields
+// that changed (or failing that, whole binary frames)
+var telemetryCommand = 'telemetry delta';
+var binaryTelemetryCommand = 'telemetry binary';
+// asks for the next frame to have all the fields
+var keyframeCommand = 'telemetry key';
+
+// asks the unit to send status every streamPeriod seconds (and on
+// changes) without being polled. until it agrees we poll with status
+var streamPeriod = 2;
+var streamCommand = 'stream ' + streamPeriod;
+var unitIsStreaming = false;
+
+// requests info from the attached unit by queueing commands
+function requestUnitInfo ()
+{
+    unitIsStreaming = false;
+    unitSendsFrames = false;
+    unitStatusFields = null;
+    keyframeRequested = false;
+    cmdQueue.push("ver");
+    cmdQueue.push("settings");
+    cmdQueue.push("get tcaloffset");
+    cmdQueue.push(telemetryCommand);
+    cmdQueue.push(streamCommand);
+    sendCommandToMicrocontroller(cmdQueue[0]);
+}
+
+// while the unit streams and no command is waiting for a response,
+// the timeout catches the status stopping (e.g. the unit was reset)
+function watchStatusStream ()
+{
+    clearTimeout(serialPortTimeoutTimer);
+    serialPortTimeoutTimer = setTimeout(serialPortTimedOut, streamPeriod * 3000);
+}
+
+function serialPortTimedOut ()
+{
+    console.log('Serial port timeout');
+    switch (currentMode) {
+        case Mode.Monitoring :
+            serialPortRxLine = '';
+            if ((cmdQueue.length == 0) ||
+                ((cmdQueue.length == 1) && (cmdQueue[0] == 'status'))) {
+                // we were only requesting status. request all info
+                cmdQueue = [];
+                requestUnitInfo();
+            } else if (cmdQueue.length > 0) {
+                // there are commands in the queue - retry sending
+                sendCommandToMicrocontroller(cmdQueue[0]);
+            }
+            if (currentSettings !== null) {
+                // clear out old settings
+                currentSWVer = null;
+                currentSettings = null;
+                currentTCalOffset = null;
+                // blank out UI fields
+                sendSWVersionToClient(currentSWVer);
+                sendSettingsToClient(currentSettings);
+                sendTCalOffsetToClient(currentTCalOffset);
+            }
+            break;
+        case Mode.Exiting :
+            serialPort.close();
+            break;
+        default :
+            break;
+    }
+}
+
+//
+//  routes
+//
+app.get('/', function(req, res){
+    res.sendFile(__dirname + '/index.html');
+});
+app.get('/home', function(req, res){
+    res.sendFile(__dirname + '/home.html');
+});
+app.get('/status', function(req, res) {
+    queryStatus(res);
+});
+app.get('/w3.css', function(req, res){
+    res.sendFile(__dirname + '/w3.css');
+});
+
+// convert temperature from Centigrade to Fahrenheit
+function convertTempToF (
+    degC)
+{
+    var degF = ((parseFloat(degC) * 9.0) / 5.0) + 32.0;
+    return degF.toFixed(1) + '&#x2109';
+}
+
+function sendEventToUI (
+    eventName,
+    eventValue)
+{
+    var eventJSON =
+        '{ "type": "event", "data": ' + '{' +
+           '"name": "' + eventName + '", ' +
+           '"value": "' + eventValue + '"}' +
+        '}';
+    io.emit('controllerMessage', eventJSON);
+}
+
+function defaultSettings ()
+{
+    return {
+            "ID": "",
+            "Mode": "",
+            "Dark": "",
+            "Auto": "",
+            "Manual": ""
+        };
+}
+
+function sendSettingsToClient (
+    settings)
+{
+    if (settings == null) {
+        settings = defaultSettings();
+    }
+    sendEventToUI('ID', settings.ID);
+    sendEventToUI('Mode', settings.Mode);
+    sendEventToUI('Dark', settings.Dark);
+    sendEventToUI('Auto', settings.Auto);
+    sendEventToUI('Manual', settings.Manual);
+}
+
+function sendSWVersionToClient (
+    swver)
+{
+    if (swver == null) {
+        swver = '';
+    }
+    sendEventToUI('swver', swver);
+}
+
+function sendTCalOffsetToClient (
+    tcaloffset)
+{
+    if (tcaloffset == null) {
+        tcaloffset = '';
+    }
+    sendEventToUI('Tcaloffset', tcaloffset);
+}
+
+function commenceReprogramming ()
+{
+    // save current settings to restore after reprogramming
+    savedSettings = currentSettings;
+    savedTCalOffset = currentTCalOffset;
+
+    //  child process for re-flashing firmware with avrdude
+    var child = execFile('avrdude', [
+        '-p', 'attiny84',
+        '-P', programmerPortName,
+        '-c', 'avrispv2',
+        '-e',
+        '-U', 'flash:w:C:\\files\\LightingUPS\\firmware\\default\\LightingUPS.hex:i'
+        ]);
+    child.stdin.setEncoding('utf-8');
+
+    child.stdout.on('data', function (data) {
+        console.log('child stdout: "' + data + '"');
+    });
+
+    child.stderr.on('data', function (data) {
+        var logmsg = '';
+        for (i = 0; i < data.length; ++i) {
+            var c = data.charCodeAt(i);
+            if ((c < 32) || (c > 126)) {
+                logmsg += ('(' + c + ')');
+            } else {
+                logmsg += data[i];
+            }
+        }
+        console.log('child stderr: "' + logmsg + '"');
+    });
+
+    child.on('close', function () {
+        console.log('child exited');
+
+        // reestablish communications with unit
+        serialPortRxLine = '';
+        cmdQueue.push("ver");
+
+        // restore saved settings
+        if (savedSettings !== null) {
+            cmdQueue.push("set id " + savedSettings.ID);
+            cmdQueue.push("set mode " + savedSettings.Mode);
+            cmdQueue.push("set dark " + savedSettings.Dark);
+            cmdQueue.push("set auto " + savedSettings.Auto);
+            cmdQueue.push("set manual " + savedSettings.Manual);
+        }
+        if (savedTCalOffset !== null) {
+            cmdQueue.push("set tcaloffset " + savedTCalOffset);
+        }
+
+        // read settings afresh from  unit
+        cmdQueue.push("settings");
+        cmdQueue.push("get tcaloffset");
+        cmdQueue.push(telemetryCommand);
+        cmdQueue.push(streamCommand);
+        unitIsStreaming = false;
+        unitSendsFrames = false;
+        unitStatusFields = null;
+        keyframeRequested = false;
+        currentMode = Mode.Monitoring;
+        sendCommandToMicrocontroller(cmdQueue[0]);
+    });
+}
+
+// the firmware's crc8 (CommonCode/crc8.c)
+function crc8 (
+    bytes,
+    length)
+{
+    var crc = 0;
+    for (var i = 0; i < length; ++i) {
+        var b = bytes[i];
+        for (var bit = 0; bit < 8; ++bit) {
+            var feedbackBit = (crc ^ b) & 0x01;
+            crc >>= 1;
+            if (feedbackBit) {
+                crc ^= 0x8C;
+            }
+            b >>= 1;
+        }
+    }
+    return crc;
+}
+
+// undoes the firmware's COBS_encode. returns null if the encoding is
+// broken
+function decodeCOBS (
+    encoded)
+{
+    var data = [];
+    var i = 0;
+    while (i < encoded.length) {
+        var code = encoded[i++];
+        if ((code == 0) || ((i + code - 1) > encoded.length)) {
+            return null;
+        }
+        for (var n = 1; n < code; ++n) {
+            data.push(encoded[i++]);
+        }
+        if (i < encoded.length) {
+            data.push(0);
+        }
+    }
+    return data;
+}
+
+var upsStateChars = ['I', 'U', 'W', 'B', 'A'];
+var powerCommandChars = ['0', 'M', 'f', 'A', 'n', 'n'];
+var modeChars = ['P', 'B', 'S'];
+
+// the unit's status as of the last frame, rebuilt from the frames
+// (layout in firmware/StatusIndicators.c)
+var unitStatusFields = null;
+// where each field starts in the fields, and where the last one ends
+var statusFieldOffsets = [0, 1, 2, 4, 5, 6, 7, 9];
+var lastFrameNumber = null;
+var keyframeRequested = false;
+
+// sends the charge estimate to the UI, or blanks it out (null) while
+// the unit doesn't have one
+function sendChargeEstimateToUI (
+    stateOfCharge,
+    runtime)
+{
+    sendEventToUI('SOC', (stateOfCharge === null) ? '' : stateOfCharge);
+    sendEventToUI('Runtime', (runtime === null) ? '' : runtime);
+}
+
+// sends the status fields to the UI the way they appear in the text
+// status line
+function sendStatusFieldsToUI (
+    fields)
+{
+    var flags = fields[1];
+    var batteryVoltage = fields[2] | (fields[3] << 8);
+    var temperature = (fields[5] < 128) ? fields[5] : (fields[5] - 256);
+    sendEventToUI('UPS', 'U' + upsStateChars[fields[0] & 0x0F]);
+    sendEventToUI('BV', 'B' + (batteryVoltage / 100).toFixed(2));
+    sendEventToUI('AC', 'A' + (flags & 0x01));
+    sendEventToUI('C', 'C' + modeChars[(flags >> 4) & 0x03] +
+        powerCommandChars[fields[0] >> 4]);
+    sendEventToUI('Light', 'L' + fields[4]);
+    sendEventToUI('Motion', 'M' + ((flags >> 1) & 0x01));
+    sendEventToUI('Temp', 'T' + temperature);
+    if (flags & 0x04) {
+        sendChargeEstimateToUI('S' + fields[6],
+            'R' + (fields[7] | (fields[8] << 8)));
+    } else {
+        sendChargeEstimateToUI(null, null);
+    }
+}
+
+// queues a command, and sends it if nothing is waiting for a response
+function queueCommand (
+    cmd)
+{
+    cmdQueue.push(cmd);
+    if (cmdQueue.length == 1) {
+        clearTimeout(serialPortTimeoutTimer);
+        sendCommandToMicrocontroller(cmdQueue[0]);
+    }
+}
+
+// a change may have been missed. deltas can't be applied until the
+// unit sends all the fields again
+function requestKeyframe ()
+{
+    unitStatusFields = null;
+    if (!keyframeRequested) {
+        keyframeRequested = true;
+        queueCommand(keyframeCommand);
+    }
+}
+
+// decodes a binary status frame, updates the unit's status from it
+// and sends that to the UI. returns false if the frame is corrupted
+function processStatusFrame (
+    frame)
+{
+    var data = decodeCOBS(frame);
+    if ((data === null) || (data.length < 3) ||
+        (crc8(data, data.length - 1) != data[data.length - 1])) {
+        console.log('bad status frame');
+        requestKeyframe();
+        return false;
+    }
+    var frameType = data[0] & 0x0F;
+    var frameNumber = data[0] >> 4;
+    var frameFollows = (lastFrameNumber !== null) &&
+        (frameNumber == ((lastFrameNumber + 1) & 0x0F));
+    lastFrameNumber = frameNumber;
+    switch (frameType) {
+        case 1 :
+            // all the fields
+            if (data.length != 11) {
+                console.log('bad status frame');
+                return false;
+            }
+            console.log('got status frame');
+            unitStatusFields = data.slice(1, 10);
+            keyframeRequested = false;
+            break;
+        case 2 :
+            // the fields that changed. the bitmap says how long the
+            // frame should be: type, bitmap, the fields and the crc
+            var changedFields = data[1];
+            var deltaLength = 3;
+            for (var f = 0; f < (statusFieldOffsets.length - 1); ++f) {
+                if (changedFields & (1 << f)) {
+                    deltaLength += statusFieldOffsets[f + 1] - statusFieldOffsets[f];
+                }
+            }
+            if ((changedFields >= (1 << (statusFieldOffsets.length - 1))) ||
+                (data.length != deltaLength)) {
+                console.log('bad status frame');
+                requestKeyframe();
+                return false;
+            }
+            if ((unitStatusFields === null) || !frameFollows) {
+                console.log('missed a status frame');
+                requestKeyframe();
+                return true;
+            }
+            console.log('got status delta');
+            var d = 2;
+            for (var f = 0; f < (statusFieldOffsets.length - 1); ++f) {
+                if (changedFields & (1 << f)) {
+                    for (var b = statusFieldOffsets[f]; b < statusFieldOffsets[f + 1]; ++b) {
+                        unitStatusFields[b] = data[d++];
+                    }
+                }
+            }
+            break;
+        default :
+            console.log('unknown status frame type ' + frameType);
+            return false;
+    }
+    sendStatusFieldsToUI(unitStatusFields);
+    return true;
+}
+
+// status came in that wasn't asked for
+function statusStreamed ()
+{
+    if (cmdQueue.length == 0) {
+        watchStatusStream();
+    }
+    // otherwise a command is waiting for its response
+}
+
+// a binary frame came in. it is streamed status, or the response to
+// a status command
+function processMicrocontrollerFrame (
+    frame)
+{
+    var goodFrame = processStatusFrame(frame);
+    if (cmdQueue[0] == 'status') {
+        clearTimeout(serialPortTimeoutTimer);
+        commandCompleted(goodFrame);
+    } else if (goodFrame) {
+        statusStreamed();
+    }
+}
+
+function processStatusLine (
+    message)
+{
+    console.log('got status string');
+    var tokens = message.trim().split(/\s+/);
+    sendEventToUI('UPS', tokens[0]);
+    sendEventToUI('BV', tokens[1]);
+    sendEventToUI('AC', tokens[2]);
+    sendEventToUI('C', tokens[3]);
+    sendEventToUI('Light', tokens[4]);
+    sendEventToUI('Motion', tokens[5]);
+    if (tokens.length > 6) {
+        // V1.0 firmware did not use temperature sensor
+        sendEventToUI('Temp', tokens[6]);
+    }
+    if (tokens.length > 8) {
+        // charge estimate, once the firmware has one
+        sendChargeEstimateToUI(tokens[7], tokens[8]);
+    } else {
+        sendChargeEstimateToUI(null, null);
+    }
+}
+
+// the unit didn't recognize a command (older firmware, or a feature
+// its firmware was built without). returns true if we can do without
+// it
+function commandUnsupported (
+    cmd)
+{
+    if (cmd == 'ver') {
+        // probably a unit with V1.0 firmware
+        console.log('ver unrecognized - assuming V1.0');
+        currentSWVer = 'V1.0';
+        sendSWVersionToClient(currentSWVer);
+    } else if (cmd == 'get tcaloffset') {
+        // probably a unit with V1.0 firmware
+        console.log('get tcaloffset unrecognized');
+        currentTCalOffset = null;
+    } else if (cmd == telemetryCommand) {
+        // no delta frames. try whole ones
+        console.log('delta status unsupported');
+        cmdQueue.splice(1, 0, binaryTelemetryCommand);
+    } else if (cmd == binaryTelemetryCommand) {
+        // no binary status. stay with text
+        console.log('binary status unsupported');
+    } else if (cmd == streamCommand) {
+        // no streaming. poll for status
+        console.log('status streaming unsupported');
+    } else {
+        return false;
+    }
+    return true;
+}
+
+function processMicrocontrollerMessage (
+    message)
+{
+    if ((message[0] == 'U') && (cmdQueue[0] != 'status')) {
+        processStatusLine(message);
+        statusStreamed();
+        return;
+    }
+    clearTimeout(serialPortTimeoutTimer);
+    var responseIsComplete = true;  // false indicates multi-line response
+    var gotExpectedResponse = true; // empty message is a valid response
+    if (message.length > 0) {
+        switch (message[0]) {
+            case 'O' :
+                // OK
+                if (cmdQueue[0] == streamCommand) {
+                    unitIsStreaming = true;
+                } else if ((cmdQueue[0] == telemetryCommand) ||
+                           (cmdQueue[0] == binaryTelemetryCommand)) {
+                    unitSendsFrames = true;
+                }
+                break;
+            case 'E' :
+                // ERROR
+                gotExpectedResponse = commandUnsupported(cmdQueue[0]);
+                break;
+            case 'U' :
+                // response to status query
+                processStatusLine(message);
+                break;
+            case 'V' :
+                currentSWVer = message;
+                console.log('sw version: ' + currentSWVer);
+                sendSWVersionToClient(currentSWVer);
+                break;
+            case '{' :
+                console.log('receiving settings');
+                if (message.length == 1) {
+                    // firmware V1.0 format settings
+                    currentSettings = defaultSettings();
+                    responseIsComplete = false;
+                } else {
+                    if (message[message.length-1] == '}') {
+                        currentSettings = JSON.parse(message);
+                        sendSettingsToClient(currentSettings);
+                        console.log('end of settings');
+                    } else {
+                        gotExpectedResponse = false;
+                    }
+                }
+                break;
+            case ' ' :
+                var tokens = message.trim().split(/\s+/);
+                if (tokens.length == 2) {
+                    // V1.0 format setting
+                    responseIsComplete = false;
+                    console.log('got V1.0 setting:' + message);
+                    switch (tokens[0]) {
+                        case 'ID:'     : currentSettings.ID     = tokens[1]; break;
+                        case 'Mode:'   : currentSettings.Mode   = tokens[1]; break;
+                        case 'Dark:'   : currentSettings.Dark   = tokens[1]; break;
+                        case 'Auto:'   : currentSettings.Auto   = tokens[1]; break;
+                        case 'Manual:' : currentSettings.Manual = tokens[1]; break;
+                        case 'offset:' : currentTCalOffset      = tokens[1];
+                                         responseIsComplete = true;
+                                         sendTCalOffsetToClient(currentTCalOffset);
+                                         break;
+                        default        : console.log('unexpected setting name: "' + tokens[0] + '"');
+                    }
+                }
+                break;
+            case '}' :
+                // end of V1.0 format settings
+                console.log('end of settings');
+                sendSettingsToClient(currentSettings);
+                break;
+            case 't' :
+                var tokens = message.trim().split(/\s+/);
+                currentTCalOffset = tokens[1];
+                console.log('temp cal offset ' + currentTCalOffset);
+                sendTCalOffsetToClient(currentTCalOffset);
+                break;
+            case 'u' :
+                // unrecognized command (V1.0 firmware)
+                gotExpectedResponse = commandUnsupported(cmdQueue[0]);
+                break;
+            default :
+                gotExpectedResponse = false;
+                break;
+        }
+    }
+    if (responseIsComplete) {
+        commandCompleted(gotExpectedResponse);
+    }
+}
+
+// moves on from the command at the head of the queue, or sends it again
+function commandCompleted (
+    gotExpectedResponse)
+{
+    if (gotExpectedResponse) {
+        cmdQueue.shift();
+    } else {
+        console.log('retrying ' + cmdQueue[0]);
+    }
+    if (cmdQueue.length == 0) {
+        // finished all queued commands.
+        // determine what to do next
+        switch (currentMode) {
+            case Mode.Monitoring :
+                if (unitIsStreaming) {
+                    // listen for status
+                    watchStatusStream();
+                } else {
+                    // request status
+                    cmdQueue.push('status');
+                }
+                break;
+            case Mode.Reprogramming :
+                // initiate reprogramming
+                console.log('commence reprogramming...');
+                clearTimeout(serialPortTimeoutTimer);
+                commenceReprogramming();
+                break;
+            case Mode.Exiting :
+                serialPort.close();
+                break;
+        }
+    }
+    if (cmdQueue.length > 0) {
+        sendCommandToMicrocontroller(cmdQueue[0]);
+    }
+}
+
+io.on('connection', function(socket){
+    console.log('got a connection.');
+    socket.on('serverCommand', function(msg){
+        console.log('got server command from client: ' + msg);
+        switch (msg) {
+            case 'refresh' :
+                sendSWVersionToClient(currentSWVer);
+                sendSettingsToClient(currentSettings);
+                sendTCalOffsetToClient(currentTCalOffset);
+                break;
+            case 'reprogram' :
+                currentMode = Mode.Reprogramming;
+                if (cmdQueue.length == 0) {
+                    // only listening to streamed status
+                    clearTimeout(serialPortTimeoutTimer);
+                    commenceReprogramming();
+                }
+                break;
+            default :
+                console.log('unrecognized server command');
+        }
+  });
+
+    socket.on('unitCommand', function(msg){
+      console.log('got unit command from client: ' + msg);
+      queueCommand(msg);
+  });
+  socket.on('disconnect', function () {
+    console.log('lost connection.');
+  });
+});
+
+serialPort.on("open", function () {
+    console.log('serial port open');
+    serialPort.on('data', function(data) {
+        for (i = 0; i < data.length; i++) {
+            var dataByte = data[i];
+            if (dataByte == 0) {
+                // binary frames come between two zero bytes
+                if (serialPortRxFrame === null) {
+                    // a zero only starts a frame if the unit sends
+                    // them. otherwise it's noise on the line
+                    if (unitSendsFrames) {
+                        serialPortRxLine = '';
+                        serialPortRxFrame = [];
+                    }
+                } else if (serialPortRxFrame.length > 0) {
+                    // a bad frame may have been text taken for a
+                    // frame, so go back to text either way. the next
+                    // frame's zero starts it again
+                    var frame = serialPortRxFrame;
+                    serialPortRxFrame = null;
+                    processMicrocontrollerFrame(frame);
+                }
+            } else if (serialPortRxFrame !== null) {
+                serialPortRxFrame.push(dataByte);
+            } else {
+                var dataStrChar = String.fromCharCode(dataByte);
+                switch(dataStrChar) {
+                    case '\n' :
+                        break;
+                    case '\r' :
+                        if (serialPortRxLine.length > 0) {
+                            console.log(++serialPortRxLineNum + ': ' + serialPortRxLine);
+                            processMicrocontrollerMessage(serialPortRxLine);
+                            serialPortRxLine = '';
+                        }
+                        break;
+                    default:
+                        serialPortRxLine += dataStrChar;
+                        break;
+                }
+            }
+        }
+        // console.log('data received: ' + data);
+    }
+);
+
+serialPort.on('close', function() {
+    console.log('serial port closed');
+  }
+);
+
+  requestUnitInfo();
+});
+
+var port = 5401;
+httpServer.listen(port, function(){
+  console.log('listening on *:' + port);
+});
+
+// launch child process for chrome UI
+var browser = execFile('C:\\Program Files (x86)\\Google\\Chrome\\Application\\chrome.exe', [
+    '--new-window', 'http://localhost:' + port + '/home'
+    ]);
+browser.stdin.setEncoding('utf-8');
+
+browser.stdout.on('data', function (data) {
+    console.log('browser stdout: "' + data + '"');
+});
+browser.stderr.on('data', function (data) {
+    console.log('browser stderr: "' + data + '"');
+});
+
+browser.on('close', function () {
+    console.log('browser exited');
+    currentMode = Mode.Exiting;
+    if (cmdQueue.length == 0) {
+        clearTimeout(serialPortTimeoutTimer);
+        serialPort.close();
+    }
+    io.close();
+    httpServer.close();
+});
@@ -1,36 +1,46 @@
-//
-//  AC Adapter Monitor
-//
-//  Monitors the state of the UPS's AC Adapter
-//
-#ifndef ADAPTERMONITOR_H
-#define ADAPTERMONITOR_H
-
-#include <stdint.h>
-
-// Analog comparator interrupt mode select
-#define ACIMS_TOGGLE    0
-#define ACIMS_FALLING   2
-#define ACIMS_RISING    3
-
-// prototypes for functions that clients supply to
-// get notification of comparator event
-typedef void (*AdapterMonitor_Notification)(void);
-
-typedef enum {
-    as_unknown,
-    as_underVoltage,        // below minimun voltage (< 8V)
-    as_goodVoltage,         // good (> 8V)
-} AdapterMonitor_adapterStatus;
-
-extern void AdapterMonitor_Initialize (void);
-
-extern void AdapterMonitor_registerForNotification (
-    const uint8_t interruptModeSelect,
-    AdapterMonitor_Notification notificationFunction);
-
-extern AdapterMonitor_adapterStatus AdapterMonitor_currentStatus (void);
-
-extern void AdapterMonitor_task (void);
-
+//
+//  AC Adapter Monitor
+//
+//  Monitors the state of the UPS's AC Adapter
+//
+#ifndef ADAPTERMONITOR_H
+#define ADAPTERMONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The comparator input AIN1 is PA2, which drives the AC adapter FET on
+// the current board, so the monitor is only built for a board that
+// brings the adapter voltage divider to PA2 (and the FET elsewhere).
+// PowerSwitches then uses it to switch to the battery the moment the
+// adapter voltage drops
+#ifndef ADAPTERMONITOR_PRESENT
+#define ADAPTERMONITOR_PRESENT false
+#endif
+
+// Analog comparator interrupt mode select
+#define ACIMS_TOGGLE    0
+#define ACIMS_FALLING   2
+#define ACIMS_RISING    3
+
+// prototypes for functions that clients supply to
+// get notification of comparator event
+typedef void (*AdapterMonitor_Notification)(void);
+
+typedef enum {
+    as_unknown,
+    as_underVoltage,        // below minimun voltage (< 8V)
+    as_goodVoltage,         // good (> 8V)
+} AdapterMonitor_adapterStatus;
+
+extern void AdapterMonitor_Initialize (void);
+
+extern void AdapterMonitor_registerForNotification (
+    const uint8_t interruptModeSelect,
+    AdapterMonitor_Notification notificationFunction);
+
+extern AdapterMonitor_adapterStatus AdapterMonitor_currentStatus (void);
+
+extern void AdapterMonitor_task (void);
+
 #endif      // ADAPTERMONITOR_H
\ No newline at end of file
@@ -1,123 +1,111 @@
-//
-//  Battery Monitor
-//
-//  Monitors the state of the UPS's battery
-//
-//  Pin usage:
-//     ADC0 (PA0) - input from battery voltage divider
-//
-
-#include "BatteryMonitor.h"
-
-#include "ADCManager.h"
-#include "SystemTime.h"
-#include "DataHistory.h"
-
-#define BATTERY_ADC_CHANNEL 0
-
-#define BATTERY_DIVIDER_R1 10.0
-#define BATTERY_DIVIDER_R2 21.7
-#define SYSTEM_VCC 4.99
-
-#define RESISTOR_DIVIDER_COUNTS(VIN, VCC, R1, R2) ((uint16_t)((((R1/(R1+R2))*VIN)/VCC)*1024+0.5))
-#define BATTERY_VOLTAGE_COUNTS(VIN) RESISTOR_DIVIDER_COUNTS(VIN, SYSTEM_VCC, BATTERY_DIVIDER_R1, BATTERY_DIVIDER_R2)
-
-#define BATTERY_10V9 BATTERY_VOLTAGE_COUNTS(10.9)
-#define BATTERY_12V  BATTERY_VOLTAGE_COUNTS(12.0)
-#define BATTERY_13V  BATTERY_VOLTAGE_COUNTS(13.0)
-
-#define BATTERY_VOLTAGE_SAMPLES 3
-// sample 20 times per second
-#define BATTERY_VOLTAGE_SAMPLE_TIME (SYSTEMTIME_TICKS_PER_SECOND / 20)
-
-typedef enum {
-    bms_idle,
-    bms_waitingForADCStart,
-    bms_waitingForADCCompletion
-} BatteryMonitor_state;
-
-static BatteryMonitor_batteryStatus battStatus = bs_unknown;
-static BatteryMonitor_state bmState = bms_idle;
-static SystemTime_Timer sampleTimer;
-DataHistory_define(BATTERY_VOLTAGE_SAMPLES, batteryVoltageHistory);
-
-void BatteryMonitor_Initialize (void)
-{
-    bmState = bms_idle;
-    battStatus = bs_unknown;
-    SystemTime_startTimer(0, &sampleTimer); // start sampling immediately
-    DataHistory_clear(&batteryVoltageHistory);
-
-    // set up the ADC channel for measuring battery voltage
-    ADCManager_setupChannel(BATTERY_ADC_CHANNEL, ADC_REF_VCC, false);
-}
-
-BatteryMonitor_batteryStatus BatteryMonitor_currentStatus (void)
-{
-    return battStatus;
-}
-
-int16_t BatteryMonitor_currentVoltage (void)
-{
-    uint16_t batteryVoltage = 0;
-    if (DataHistory_length(&batteryVoltageHistory) >= BATTERY_VOLTAGE_SAMPLES) {
-        uint16_t minVoltage;
-        uint16_t maxVoltage;
-        DataHistory_getStatistics(
-            &batteryVoltageHistory, BATTERY_VOLTAGE_SAMPLES,
-            &minVoltage, &maxVoltage, &batteryVoltage);
-    }
-
-    int32_t vBatt = batteryVoltage;
-    // counts to 1/100s volt
-    // measured resistor divider ratio: 0.315, VCC: 4.99V
-    // ((4.99V / 0.315) / 1024) * 100 => 1.54
-    return ((((int32_t)vBatt) * 154) / 100);
-}
-
-void BatteryMonitor_task (void)
-{
-    switch (bmState) {
-        case bms_idle :
-            if (SystemTime_timerHasExpired(&sampleTimer)) {
-                SystemTime_startTimer(BATTERY_VOLTAGE_SAMPLE_TIME, &sampleTimer);
-                bmState = bms_waitingForADCStart;
-            }
-            break;
-        case bms_waitingForADCStart :
-            if (ADCManager_StartConversion(BATTERY_ADC_CHANNEL)) {
-                // successfully started conversion
-                bmState = bms_waitingForADCCompletion;
-            }
-            break;    
-        case bms_waitingForADCCompletion : {
-            uint16_t batteryVoltage;
-            if (ADCManager_ConversionIsComplete(&batteryVoltage)) {
-                DataHistory_insertValue(batteryVoltage, &batteryVoltageHistory);
-
-                if (DataHistory_length(&batteryVoltageHistory) >=
-                        BATTERY_VOLTAGE_SAMPLES) {
-                    uint16_t minVoltage;
-                    uint16_t maxVoltage;
-                    uint16_t avgVoltage;
-                    DataHistory_getStatistics(
-                        &batteryVoltageHistory, BATTERY_VOLTAGE_SAMPLES,
-                        &minVoltage, &maxVoltage, &avgVoltage);
-                    // determine status based on voltage reading
-                    if (maxVoltage < BATTERY_10V9) {
-                        battStatus = bs_underVoltage;
-                    } else if (maxVoltage < BATTERY_12V) {
-                        battStatus = bs_lowVoltage;
-                    } else if (maxVoltage < BATTERY_13V) {
-                        battStatus = bs_goodVoltage;
-                    } else {
-                        battStatus = bs_fullVoltage;
-                    }
-                }
-                bmState = bms_idle;
-            }
-            }
-            break;
-    }
-}
-
+//
+//  Battery Monitor
+//
+//  Monitors the state of the UPS's battery
+//
+//  The reported voltage is filtered (IIR), but the status goes by the
+//  higher of the last two samples, as it always has. A sag while the
+//  battery takes the LED load can drag the filtered voltage down, and
+//  mustn't be taken for undervoltage and cut the lights off.
+//
+//  Pin usage:
+//     ADC0 (PA0) - input from battery voltage divider
+//
+
+#include "BatteryMonitor.h"
+
+#include "ADCManager.h"
+#include "TaskScheduler.h"
+#include "SystemTime.h"
+#include "IIRFilter.h"
+#include "CalibrationManager.h"
+
+#define BATTERY_ADC_CHANNEL 0
+
+// status thresholds, in 1/100 volt
+#define BATTERY_10V9 1090
+#define BATTERY_12V  1200
+#define BATTERY_13V  1300
+
+// an oversampled sample is already the average of 16 conversions, so
+// the filter only has to smooth over a couple of them. A 10-bit sample
+// is a count or so noisier, which is 15mV at the battery
+#define BATTERY_FILTER_SHIFT 1
+// sample 20 times per second
+#define BATTERY_VOLTAGE_SAMPLE_TIME (SYSTEMTIME_TICKS_PER_SECOND / 20)
+// conversions to discard after the ADC switches to the battery
+#define BATTERY_SETTLE_CONVERSIONS 1
+
+static BatteryMonitor_batteryStatus battStatus = bs_unknown;
+static uint8_t resultsTaken;
+static uint16_t previousSample;     // for the status window
+static bool havePreviousSample;
+IIRFilter_define(BATTERY_FILTER_SHIFT, batteryVoltageFilter);
+
+// called from the ADC interrupt handler
+static void resultReady (void)
+{
+    TaskScheduler_wakeTask(BatteryMonitor_task);
+}
+
+void BatteryMonitor_Initialize (void)
+{
+    battStatus = bs_unknown;
+    resultsTaken = 0;
+    havePreviousSample = false;
+    batteryVoltageFilter_clear();
+
+    // set up the ADC channel for measuring battery voltage
+    ADCManager_setupChannel(BATTERY_ADC_CHANNEL, ADC_REF_VCC,
+        ADCMANAGER_OVERSAMPLE(BATTERYMONITOR_OVERSAMPLE_BITS),
+        BATTERY_VOLTAGE_SAMPLE_TIME, BATTERY_SETTLE_CONVERSIONS, resultReady);
+}
+
+BatteryMonitor_batteryStatus BatteryMonitor_currentStatus (void)
+{
+    return battStatus;
+}
+
+uint16_t BatteryMonitor_currentCounts (void)
+{
+    return batteryVoltageFilter_value();
+}
+
+int16_t BatteryMonitor_currentVoltage (void)
+{
+    int16_t vBatt = 0;
+    if (batteryVoltageFilter_isValid()) {
+        // counts to 1/100s volt
+        vBatt = CalibrationManager_convert(cc_battery, BatteryMonitor_currentCounts());
+    }
+
+    return vBatt;
+}
+
+void BatteryMonitor_task (void)
+{
+    uint16_t batteryVoltage;
+    if (ADCManager_takeResult(BATTERY_ADC_CHANNEL, &resultsTaken, &batteryVoltage)) {
+        batteryVoltageFilter_insert(batteryVoltage);
+
+        if (havePreviousSample) {
+            // determine status based on the max of the last two readings
+            const uint16_t maxVoltage = (batteryVoltage > previousSample)
+                ? batteryVoltage
+                : previousSample;
+            const int16_t vBatt = CalibrationManager_convert(cc_battery, maxVoltage);
+            if (vBatt < BATTERY_10V9) {
+                battStatus = bs_underVoltage;
+            } else if (vBatt < BATTERY_12V) {
+                battStatus = bs_lowVoltage;
+            } else if (vBatt < BATTERY_13V) {
+                battStatus = bs_goodVoltage;
+            } else {
+                battStatus = bs_fullVoltage;
+            }
+        }
+        previousSample = batteryVoltage;
+        havePreviousSample = true;
+    }
+}
+
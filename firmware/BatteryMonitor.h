@@ -1,28 +1,48 @@
-//
-//  Battery Monitor
-//
-//  Monitors the state of the UPS's battery
-//
-#ifndef BATTERYMONITOR_H
-#define BATTERYMONITOR_H
-
-#include <stdint.h>
-
-typedef enum {
-    bs_unknown,
-    bs_underVoltage,        // below minimun voltage (10.8V)
-    bs_lowVoltage,          // low (between 11 and 12V)
-    bs_goodVoltage,         // good (between 12 and 13V)
-    bs_fullVoltage          // full (over 13V)
-} BatteryMonitor_batteryStatus;
-
-extern void BatteryMonitor_Initialize (void);
-
-extern BatteryMonitor_batteryStatus BatteryMonitor_currentStatus (void);
-
-// voltage in units of 1/100 volt
-extern int16_t BatteryMonitor_currentVoltage (void);
-
-extern void BatteryMonitor_task (void);
-
+//
+//  Battery Monitor
+//
+//  Monitors the state of the UPS's battery
+//
+#ifndef BATTERYMONITOR_H
+#define BATTERYMONITOR_H
+
+#include <stdint.h>
+#include "ADCManager.h"
+
+// the battery is oversampled 16 times for 12 bit counts (about 4mV a
+// count at the battery) when the ADC can oversample. Otherwise its
+// counts are 10 bits
+#if ADCMANAGER_OVERSAMPLING
+#define BATTERYMONITOR_OVERSAMPLE_BITS 2
+#else
+#define BATTERYMONITOR_OVERSAMPLE_BITS 0
+#endif
+
+// battery counts to 1/100 volt before calibration (see
+// CalibrationManager.h), with the counts taken as 12 bits. Measured
+// resistor divider ratio: 0.315, VCC: 4.99V:
+// ((4.99V / 0.315) / 4096) * 100 * 65536 => 25346
+#define BATTERYMONITOR_NOMINAL_GAIN 25346
+#define BATTERYMONITOR_NOMINAL_OFFSET 0
+
+typedef enum {
+    bs_unknown,
+    bs_underVoltage,        // below minimun voltage (10.8V)
+    bs_lowVoltage,          // low (between 11 and 12V)
+    bs_goodVoltage,         // good (between 12 and 13V)
+    bs_fullVoltage          // full (over 13V)
+} BatteryMonitor_batteryStatus;
+
+extern void BatteryMonitor_Initialize (void);
+
+extern BatteryMonitor_batteryStatus BatteryMonitor_currentStatus (void);
+
+// voltage in units of 1/100 volt
+extern int16_t BatteryMonitor_currentVoltage (void);
+
+// filtered readings, in ADC counts (0 until the first one)
+extern uint16_t BatteryMonitor_currentCounts (void);
+
+extern void BatteryMonitor_task (void);
+
 #endif      // BATTERYMONITOR_H
\ No newline at end of file
@@ -1,24 +1,141 @@
-//
-//  Calibration Manager
-//
-//  Manages workflow for setting voltage parameters in EEPROM
-//
-//  uses pins
-//      PA5 - cal button
-//      PA7 - voltage selector bit 0
-//      PB2 - voltage selector bit 1
-//
-
-#include "CalibrationManager.h"
-
-static CalibrationManager_state cmState = cm_waitingForButtonPress;
-
-void CalibrationManager_Initialize (void)
-{
-    // set value selector and button pins as inputs with pullup
-}
-
-void CalibrationManager_task (void)
-{
-}
-
+//
+//  Calibration Manager
+//
+//  Manages workflow for setting calibration parameters in EEPROM
+//
+//  How it works:
+//      The gains and offsets are kept in EEPROM, and each conversion
+//      reads them from there. A read only waits for the EEPROM while a
+//      write is in progress, which is just after a calibration command.
+//
+//      The first reference point is only held in RAM until the second
+//      one for the same channel arrives (a reading of 0 can't be a
+//      reference point, so 0 means there isn't one). From the two points
+//          gain = ((value2 - value1) * 65536) / ((counts2 - counts1) << shift)
+//          offset = value1 - (convert(counts1) - old offset)
+//      The gain is below 65536 only when the value difference is
+//      smaller than the counts difference, so the divide is done 16
+//      bits at a time by shift and subtract rather than with a 32-bit
+//      divide.
+//
+
+#include "CalibrationManager.h"
+
+#include "EEPROMStorage.h"
+#include "BatteryMonitor.h"
+#include "InternalTemperatureMonitor.h"
+
+// counts are shifted left this much before the multiply. Battery
+// counts are 12 bits, or 10 bits shifted up to 12. Temperature counts
+// are up to 1023, so gains up to 2 fit
+#define BATTERY_SHIFT (2 - BATTERYMONITOR_OVERSAMPLE_BITS)
+#define TEMPERATURE_SHIFT 1
+
+// each channel has an offset and then a gain in EEPROM, in channel
+// order from the temperature offset
+#define offsetAddress(channel) (ADDR_TEMP_CAL_OFFSET + ((channel) * 4))
+#define gainAddress(channel) (offsetAddress(channel) + 2)
+
+// state variables
+static CalibrationManager_channel point1Channel;
+static uint16_t point1Counts;
+static int16_t point1Value;
+
+// (a * 65536) / b, for a < b, by shift and subtract
+static uint16_t divideFraction (
+    uint16_t a,
+    const uint16_t b)
+{
+    uint16_t quotient = 0;
+    for (uint8_t bit = 0; bit < 16; ++bit) {
+        const bool carry = ((a & 0x8000) != 0);
+        a <<= 1;
+        quotient <<= 1;
+        if (carry || (a >= b)) {
+            a -= b;
+            quotient |= 1;
+        }
+    }
+
+    return quotient;
+}
+
+static uint8_t countsShift (
+    const CalibrationManager_channel channel)
+{
+    return (channel == cc_battery) ? BATTERY_SHIFT : TEMPERATURE_SHIFT;
+}
+
+// the counts scaled by the gain, without the offset
+static int16_t scale (
+    const CalibrationManager_channel channel,
+    const uint16_t counts,
+    const uint16_t gain)
+{
+    // the high 16 bits of the 32-bit product
+    const uint32_t product =
+        (uint32_t)(uint16_t)(counts << countsShift(channel)) * gain;
+
+    return (int16_t)(product >> 16);
+}
+
+void CalibrationManager_Initialize (void)
+{
+    point1Counts = 0;
+}
+
+int16_t CalibrationManager_convert (
+    const CalibrationManager_channel channel,
+    const uint16_t counts)
+{
+    return scale(channel, counts, CalibrationManager_gain(channel)) +
+        CalibrationManager_offset(channel);
+}
+
+uint16_t CalibrationManager_gain (
+    const CalibrationManager_channel channel)
+{
+    return EEPROM_readWord(gainAddress(channel));
+}
+
+int16_t CalibrationManager_offset (
+    const CalibrationManager_channel channel)
+{
+    return (int16_t)EEPROM_readWord(offsetAddress(channel));
+}
+
+bool CalibrationManager_setPoint (
+    const CalibrationManager_channel channel,
+    const uint8_t point,
+    const uint16_t counts,
+    const int16_t value)
+{
+    bool pointSet = false;
+
+    if ((point == 1) && (counts != 0)) {
+        point1Channel = channel;
+        point1Counts = counts;
+        point1Value = value;
+        pointSet = true;
+    } else if ((point == 2) && (point1Counts != 0) && (channel == point1Channel)) {
+        const uint8_t shift = countsShift(channel);
+        int16_t countsDiff = (int16_t)((counts - point1Counts) << shift);
+        int16_t valueDiff = value - point1Value;
+        if (countsDiff < 0) {
+            countsDiff = -countsDiff;
+            valueDiff = -valueDiff;
+        }
+        if ((valueDiff > 0) && (valueDiff < countsDiff)) {
+            const uint16_t gain = divideFraction(valueDiff, countsDiff);
+            EEPROM_writeWord(gainAddress(channel), gain);
+            // convert() with the new gain still adds the old offset
+            EEPROM_writeWord(offsetAddress(channel), (uint16_t)(point1Value -
+                CalibrationManager_convert(channel, point1Counts) +
+                CalibrationManager_offset(channel)));
+            point1Counts = 0;
+            pointSet = true;
+        }
+    }
+
+    return pointSet;
+}
@@ -1,20 +1,51 @@
-//
-//  Calibration Manager
-//
-//  Manages workflow for setting voltage parameters in EEPROM
-//
-#ifndef CALIBRATIONMANAGER_H
-#define CALIBRATIONMANAGER_H
-
-typedef enum {
-    cm_waitingForButtonPress,
-    cm_buttonDebounce,
-    cm_acknowldegeSet,
-    cm_buttonRelease
-} CalibrationManager_state;
-
-extern void CalibrationManager_Initialize (void);
-
-extern void CalibrationManager_task (void);
-
-#endif      // CALIBRATIONMANAGER_H
\ No newline at end of file
+//
+//  Calibration Manager
+//
+//  Manages workflow for setting calibration parameters in EEPROM, and
+//  converts ADC counts to the units of each calibrated channel
+//
+//  Each channel has a gain and an offset:
+//      value = ((counts << shift) * gain) / 65536 + offset
+//  where the shift is fixed for the channel, so the gain is a 16-bit
+//  fraction and the conversion is one 16 x 16 bit multiply. Two
+//  reference points, each a reading and the value it should give, set
+//  the gain and offset for a unit
+//
+#ifndef CALIBRATIONMANAGER_H
+#define CALIBRATIONMANAGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    cc_temperature,     // 10-bit counts to degrees C
+    cc_battery,         // 10 or 12-bit counts to 1/100 volt
+    cc_numChannels
+} CalibrationManager_channel;
+
+// called once at power-up, after EEPROMStorage_Initialize
+extern void CalibrationManager_Initialize (void);
+
+extern int16_t CalibrationManager_convert (
+    const CalibrationManager_channel channel,
+    const uint16_t counts);
+
+extern uint16_t CalibrationManager_gain (
+    const CalibrationManager_channel channel);
+
+extern int16_t CalibrationManager_offset (
+    const CalibrationManager_channel channel);
+
+
+// records reference point 1 or 2: the channel read <counts> where it
+// should have read <value>. Recording point 2 sets the gain and offset
+// from the two points. Returns false (and changes nothing) if the
+// point is not 1 or 2, <counts> is 0, point 2 comes without point 1,
+// or the points don't give a gain in range
+extern bool CalibrationManager_setPoint (
+    const CalibrationManager_channel channel,
+    const uint8_t point,
+    const uint16_t counts,
+    const int16_t value);
+
+#endif      // CALIBRATIONMANAGER_H
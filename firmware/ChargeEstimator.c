@@ -0,0 +1,193 @@
+//
+//  Charge Estimator
+//
+//  Estimates the battery's state of charge and remaining runtime
+//
+//  How it works:
+//      Once a second the battery voltage is turned into an open
+//      circuit voltage: the drop across the battery's internal
+//      resistance is added back while the battery carries the LEDs,
+//      and the charger's lift is taken off while mains are on. A
+//      table of open circuit voltages (in flash) gives the state of
+//      charge, and the estimate moves part of the way to it each
+//      second, which filters out the noise.
+//
+//      Right after the load or the charger comes or goes, the voltage
+//      is still moving (surface charge, recovery from the load), so
+//      for a while the estimate is left alone. While charging it only
+//      creeps up, a step a second, since the charger holds the voltage
+//      up whatever the charge.
+//
+//      While the LEDs run from the battery, the drop in the estimate
+//      over each ten minutes feeds a filtered discharge rate (over a
+//      shorter time the steps in the voltage reading show), and the
+//      remaining runtime is the charge left divided by that rate. It
+//      starts out at the nominal rate for the LED load. The ten minutes
+//      are counted in seconds since the readings settled.
+//
+//      Charge is kept in 1/256 percent, and rates in 1/256 percent
+//      per minute, so all of it is 16-bit math.
+//
+
+#include "ChargeEstimator.h"
+
+#include "SystemTime.h"
+#include "TaskScheduler.h"
+#include "BatteryMonitor.h"
+#include "MainsMonitor.h"
+#include "PowerSwitches.h"
+#include <avr/pgmspace.h>
+
+#define UPDATE_INTERVAL SYSTEMTIME_TICKS_PER_SECOND
+
+#define ONE_PERCENT 256
+#define FULL_CHARGE (100 * ONE_PERCENT)
+
+// voltage drop across the battery's internal resistance at the LED
+// load, in 1/100 volt
+#define LOAD_SAG 25
+// how far the charger holds the battery above its open circuit
+// voltage, in 1/100 volt
+#define CHARGER_LIFT 80
+// seconds to leave the estimate alone after the load or the charger
+// comes or goes
+#define SETTLE_SECONDS 120
+// the estimate moves 1/8 of the way to each reading
+#define CHARGE_FILTER_SHIFT 3
+
+#define MINUTE_SECONDS 60
+// discharge rate is measured over ten minutes, and filtered 1/4 of
+// the way to each measurement
+#define RATE_MINUTES 10
+#define RATE_SECONDS (RATE_MINUTES * MINUTE_SECONDS)
+#define RATE_FILTER_SHIFT 2
+// nominal rate for a 7Ah battery: 1A of LEDs takes 100% in 420
+// minutes
+#define NOMINAL_DISCHARGE_RATE ((FULL_CHARGE + 210) / 420)
+// while charging the estimate rises at most this much a second, which
+// is 100% in about 7 hours, near the 0.7A charger's rate
+#define CHARGE_STEP 1
+
+// state of charge (percent) of the sealed lead-acid battery at open
+// circuit voltages CURVE_STEP apart, from CURVE_BASE (in 1/100 volt).
+// 0% is where the load is cut off. The steps are a power of two, so
+// looking up a voltage takes a shift rather than a divide
+#define CURVE_BASE 1150
+#define CURVE_STEP_SHIFT 4
+#define CURVE_STEP (1 << CURVE_STEP_SHIFT)
+#define CURVE_POINTS 10
+static const uint8_t chargeCurve[CURVE_POINTS] PROGMEM = {
+    0, 8, 18, 30, 43, 57, 70, 83, 98, 100
+};
+
+// state variables
+static bool haveEstimate;
+static uint16_t charge;             // 1/256 percent
+static uint16_t dischargeRate;      // 1/256 percent per minute
+static uint8_t lastLoad;            // charging, loaded or neither
+static uint8_t settleSeconds;       // left until readings are trusted
+static uint16_t settledSeconds;     // since then, or the last rate
+                                    // measurement
+static uint16_t rateStartCharge;
+
+// state of charge (1/256 percent) at an open circuit voltage
+static uint16_t chargeAtVoltage (
+    const int16_t volts)
+{
+    uint16_t chargeAt = FULL_CHARGE;
+
+    const int16_t aboveBase = volts - CURVE_BASE;
+    if (aboveBase <= 0) {
+        chargeAt = 0;
+    } else if (aboveBase < ((CURVE_POINTS - 1) * CURVE_STEP)) {
+        // interpolate between the points either side
+        const uint8_t p = (uint8_t)aboveBase >> CURVE_STEP_SHIFT;
+        const uint8_t lower = pgm_read_byte_near(&chargeCurve[p]);
+        const uint8_t upper = pgm_read_byte_near(&chargeCurve[p + 1]);
+        chargeAt = ((uint16_t)lower * ONE_PERCENT) +
+            (((uint16_t)(uint8_t)(upper - lower) *
+              ((uint8_t)aboveBase & (CURVE_STEP - 1))) *
+             (ONE_PERCENT / CURVE_STEP));
+    }
+
+    return chargeAt;
+}
+
+void ChargeEstimator_Initialize (void)
+{
+    // the charge comes with the first reading, and the rate
+    // measurement starts once the readings settle
+    haveEstimate = false;
+    dischargeRate = NOMINAL_DISCHARGE_RATE;
+    lastLoad = 0;
+    settleSeconds = SETTLE_SECONDS;
+}
+
+bool ChargeEstimator_haveEstimate (void)
+{
+    return haveEstimate;
+}
+
+uint8_t ChargeEstimator_stateOfCharge (void)
+{
+    return (uint8_t)((charge + (ONE_PERCENT / 2)) / ONE_PERCENT);
+}
+
+uint16_t ChargeEstimator_minutesRemaining (void)
+{
+    return (PowerSwitches_currentState() == pss_onBattery)
+        ? (charge / dischargeRate)
+        : 0;
+}
+
+void ChargeEstimator_task (void)
+{
+    const bool charging = MainsMonitor_mainsOn();
+    const bool loaded = !charging && (PowerSwitches_currentState() == pss_onBattery);
+    const uint8_t load = charging | (loaded << 1);
+    if (load != lastLoad) {
+        lastLoad = load;
+        settleSeconds = SETTLE_SECONDS;
+    }
+
+    if (BatteryMonitor_currentStatus() != bs_unknown) {
+        int16_t volts = BatteryMonitor_currentVoltage();
+        if (loaded) {
+            volts += LOAD_SAG;
+        } else if (charging) {
+            volts -= CHARGER_LIFT;
+        }
+        const uint16_t chargeNow = chargeAtVoltage(volts);
+
+        if (!haveEstimate) {
+            // the first reading is all there is to go on
+            charge = chargeNow;
+            haveEstimate = true;
+        } else if (settleSeconds > 0) {
+            --settleSeconds;
+            settledSeconds = 0;
+            rateStartCharge = charge;
+        } else if (charging) {
+            if (chargeNow > charge) {
+                charge += CHARGE_STEP;
+            }
+        } else {
+            // charge is under 2^15, so the difference fits
+            charge += ((int16_t)(chargeNow - charge)) >> CHARGE_FILTER_SHIFT;
+
+            if (loaded && (++settledSeconds >= RATE_SECONDS)) {
+                const int16_t drop = (charge < rateStartCharge)
+                    ? (int16_t)((rateStartCharge - charge) / RATE_MINUTES)
+                    : 0;
+                dischargeRate += (drop - (int16_t)dischargeRate) >> RATE_FILTER_SHIFT;
+                if (dischargeRate == 0) {
+                    dischargeRate = 1;
+                }
+                settledSeconds = 0;
+                rateStartCharge = charge;
+            }
+        }
+    }
+
+    TaskScheduler_delayCurrentTask(UPDATE_INTERVAL);
+}
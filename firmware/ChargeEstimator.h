@@ -0,0 +1,31 @@
+//
+//  Charge Estimator
+//
+//  Estimates the battery's state of charge from its voltage, and how
+//  long it can run the LEDs from there. The voltage is corrected for
+//  the sag under the LED load, and isn't trusted while the charger
+//  holds it up or while it recovers after the load or the charger
+//  goes away
+//
+#ifndef CHARGEESTIMATOR_H
+#define CHARGEESTIMATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+extern void ChargeEstimator_Initialize (void);
+
+// true once there has been a reading to estimate from
+extern bool ChargeEstimator_haveEstimate (void);
+
+// state of charge, in percent (0 is where the load is cut off)
+extern uint8_t ChargeEstimator_stateOfCharge (void);
+
+// minutes the battery can run the LEDs from its present charge, while
+// it is running them (pss_onBattery). 0 in any other state, since
+// then it isn't running down
+extern uint16_t ChargeEstimator_minutesRemaining (void);
+
+extern void ChargeEstimator_task (void);
+
+#endif      // CHARGEESTIMATOR_H
@@ -1,193 +1,404 @@
-//
-// Command processor
-//
-// Interprets and executes commands from the console
-//
-
-#include "CommandProcessor.h"
-
-#include <stdlib.h>
-#include <stdio.h>
-#include <avr/pgmspace.h>
-#include "SystemTime.h"
-#include "Console.h"
-#include "CharString.h"
-#include "StringUtils.h"
-#include "EEPROM.h"
-#include "EEPROMStorage.h"
-#include "StatusIndicators.h"
-#include "PowerCommand.h"
-
-#define CMD_TOKEN_BUFFER_LEN 20
-
-char swver[] PROGMEM = "V2.0";
-
-static const char tokenDelimiters[] = " \n\r";
-
-typedef enum Reply_enum {
-    r_none,
-    r_ok,
-    r_error
-} Reply;
-
-void CommandProcessor_processCommand (
-    const char* command)
-{
-#if 0
-    char msgbuf[80];
-    sprintf(msgbuf, "cmd: '%s'", command);
-    Console_print(msgbuf);
-#endif
-    Reply reply = r_none;
-    char cmdTokenBuf[CMD_TOKEN_BUFFER_LEN];
-    strncpy(cmdTokenBuf, command, CMD_TOKEN_BUFFER_LEN-1);
-    cmdTokenBuf[CMD_TOKEN_BUFFER_LEN-1] = 0;
-    const char* cmdToken = strtok(cmdTokenBuf, tokenDelimiters);
-    if (cmdToken != NULL) {
-	if (strcasecmp_P(cmdToken, PSTR("status")) == 0) {
-            StatusIndicators_sendStatusMesssage();
-        } else if (strcasecmp_P(cmdToken, PSTR("leds")) == 0) {
-            cmdToken = strtok(NULL, tokenDelimiters);
-            if (cmdToken != NULL) {
-                reply = r_ok;
-                if (strcasecmp_P(cmdToken, PSTR("on")) == 0) {
-                    PowerCommand_turnOn();
-                } else if (strcasecmp_P(cmdToken, PSTR("off")) == 0) {
-                    PowerCommand_turnOff(AUTO_ON_LOCKOUT_TIME);
-                } else {
-                    reply = r_error;
-                }
-            } else {
-                reply = r_error;
-            }
-        } else if (strcasecmp_P(cmdToken, PSTR("settings")) == 0) {
-            CharString_define(16, settingStr);
-            Console_printP(PSTR("{"));
-            CharString_copyP(PSTR("\"ID\":"), &settingStr);
-            StringUtils_appendDecimal(EEPROMStorage_deviceID, 0, &settingStr);
-            Console_printCS(&settingStr);
-            CharString_copyP(PSTR(",\"Mode\":\""), &settingStr);
-            CharString_appendC((char)EEPROMStorage_mode, &settingStr);
-            Console_printCS(&settingStr);
-            CharString_copyP(PSTR("\",\"Dark\":"), &settingStr);
-            StringUtils_appendDecimal(EEPROMStorage_darkLevel, 0, &settingStr);
-            Console_printCS(&settingStr);
-            CharString_copyP(PSTR(",\"Auto\":"), &settingStr);
-            StringUtils_appendDecimal(EEPROMStorage_autoTime, 0, &settingStr);
-            Console_printCS(&settingStr);
-            CharString_copyP(PSTR(",\"Manual\":"), &settingStr);
-            StringUtils_appendDecimal(EEPROMStorage_manualTime, 0, &settingStr);
-            Console_printCS(&settingStr);
-            CharString_copyP(PSTR("}"), &settingStr);
-            Console_printLineCS(&settingStr);
-        } else if (strcasecmp_P(cmdToken, PSTR("set")) == 0) {
-            cmdToken = strtok(NULL, tokenDelimiters);
-            if (cmdToken != NULL) {
-                reply = r_ok;
-                if (strcasecmp_P(cmdToken, PSTR("id")) == 0) {
-                    cmdToken = strtok(NULL, tokenDelimiters);
-                    if (cmdToken != NULL) {
-                        const unsigned int deviceID = atoi(cmdToken);
-                        EEPROMStorage_setDeviceId((uint8_t)deviceID);
-                    } else {
-                        reply = r_error;
-                    }
-                } else if (strcasecmp_P(cmdToken, PSTR("mode")) == 0) {
-                    cmdToken = strtok(NULL, tokenDelimiters);
-                    if (cmdToken != NULL) {
-                        const char mode = cmdToken[0];
-                        if ((mode == 'P') ||
-                            (mode == 'B') ||
-                            (mode == 'S')) {
-                            EEPROMStorage_setMode((uint8_t)mode);
-                        } else {
-                            reply = r_error;
-                        }
-                    } else {
-                        reply = r_error;
-                    }
-                } else if (strcasecmp_P(cmdToken, PSTR("dark")) == 0) {
-                    cmdToken = strtok(NULL, tokenDelimiters);
-                    if (cmdToken != NULL) {
-                        const unsigned int darkLevel = atoi(cmdToken);
-                        EEPROMStorage_setDarkLevel((uint8_t)darkLevel);
-                    } else {
-                        reply = r_error;
-                    }
-                } else if (strcasecmp_P(cmdToken, PSTR("auto")) == 0) {
-                    cmdToken = strtok(NULL, tokenDelimiters);
-                    if (cmdToken != NULL) {
-                        const unsigned int autoTimeOn = atoi(cmdToken);
-                        EEPROMStorage_setAutoTime((uint16_t)autoTimeOn);
-                    } else {
-                        reply = r_error;
-                    }
-                } else if (strcasecmp_P(cmdToken, PSTR("manual")) == 0) {
-                    cmdToken = strtok(NULL, tokenDelimiters);
-                    if (cmdToken != NULL) {
-                        const unsigned int manualTimeOn = atoi(cmdToken);
-                        EEPROMStorage_setManualTime((uint16_t)manualTimeOn);
-                    } else {
-                        reply = r_error;
-                    }
-                } else if (strcasecmp_P(cmdToken, PSTR("tCalOffset")) == 0) {
-                    cmdToken = strtok(NULL, tokenDelimiters);
-                    if (cmdToken != NULL) {
-                        const int16_t tempCalOffset = atoi(cmdToken);
-                        EEPROMStorage_setTempCalOffset(tempCalOffset);
-                    } else {
-                        reply = r_error;
-                    }
-                } else {
-                    reply = r_error;
-                }
-            } else {
-                reply = r_error;
-            }
-        } else if (strcasecmp_P(cmdToken, PSTR("get")) == 0) {
-            cmdToken = strtok(NULL, tokenDelimiters);
-            if (cmdToken != NULL) {
-                if (strcasecmp_P(cmdToken, PSTR("tCalOffset")) == 0) {
-                    CharString_define(16, offsetStr);
-                    CharString_copyP(PSTR("tCalOffset: "), &offsetStr);
-                    StringUtils_appendDecimal(EEPROMStorage_tempCalOffset, 0, &offsetStr);
-                    Console_printLineCS(&offsetStr);
-                } else {
-                    reply = r_error;
-                }
-            } else {
-                reply = r_error;
-            }
-        } else if (strcasecmp_P(cmdToken, PSTR("echo")) == 0) {
-            cmdToken = strtok(NULL, tokenDelimiters);
-            if (cmdToken != NULL) {
-                reply = r_ok;
-                if (strcasecmp_P(cmdToken, PSTR("on")) == 0) {
-                    Console_setEcho(true);
-                } else if (strcasecmp_P(cmdToken, PSTR("off")) == 0) {
-                    Console_setEcho(false);
-                } else {
-                    reply = r_error;
-                }
-            } else {
-                reply = r_error;
-            }
-        } else if (strcasecmp_P(cmdToken, PSTR("ver")) == 0) {
-            Console_printLineP(swver);
-        } else {
-            reply = r_error;
-        }
-    } else {
-        reply = r_ok;
-    }
-    switch (reply) {
-        case r_none :
-            break;
-        case r_ok :
-            Console_printLineP(PSTR("OK"));
-            break;
-        case r_error :
-            Console_printLineP(PSTR("ERROR"));
-            break;
-    }
-}
+//
+// Command processor
+//
+// Interprets and executes commands from the console
+//
+
+#include "CommandProcessor.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <avr/pgmspace.h>
+#include "SystemTime.h"
+#include "Console.h"
+#include "CharString.h"
+#include "StringUtils.h"
+#include "EEPROM.h"
+#include "EEPROMStorage.h"
+#include "StatusIndicators.h"
+#include "PowerCommand.h"
+#include "TaskProfiler.h"
+#include "CalibrationManager.h"
+#include "BatteryMonitor.h"
+#include "InternalTemperatureMonitor.h"
+#include "SoftwareSerialRx.h"
+
+#define CMD_TOKEN_BUFFER_LEN 20
+
+char swver[] PROGMEM = "V2.0";
+
+static const char tokenDelimiters[] = " \n\r";
+
+typedef enum Reply_enum {
+    r_none,
+    r_ok,
+    r_error
+} Reply;
+
+// the commands, and the words that follow some of them. Each word is
+// ended by a 0, and each list by an empty word. Commands are in the
+// same order as Command
+static const char commandWords[] PROGMEM =
+    "status\0"
+#if STATUS_FRAMES
+    "telemetry\0"
+#endif
+#if STATUS_STREAM
+    "stream\0"
+#endif
+    "leds\0"
+    "settings\0"
+    "set\0"
+    "get\0"
+    "cal\0"
+    "echo\0"
+    "serial\0"
+#if SYSTEMTIME_HOOK_USAGE
+    "isr\0"
+#endif
+#if PROFILE_TASKS
+    "prof\0"
+#endif
+    "ver\0";
+
+typedef enum Command_enum {
+    c_status,
+#if STATUS_FRAMES
+    c_telemetry,
+#endif
+#if STATUS_STREAM
+    c_stream,
+#endif
+    c_leds,
+    c_settings,
+    c_set,
+    c_get,
+    c_cal,
+    c_echo,
+    c_serial,
+#if SYSTEMTIME_HOOK_USAGE
+    c_isr,
+#endif
+#if PROFILE_TASKS
+    c_prof,
+#endif
+    c_ver
+} Command;
+
+// after leds and echo
+static const char onOffWords[] PROGMEM = "on\0off\0";
+// after set, in the same order as Setting
+static const char settingWords[] PROGMEM =
+    "id\0mode\0dark\0auto\0manual\0tCalOffset\0";
+// after cal, in the same order as CalibrationManager_channel
+static const char calChannelWords[] PROGMEM = "temp\0batt\0";
+#if STATUS_FRAMES
+// after telemetry: the formats, in the same order as
+// StatusIndicators_format, then key
+static const char telemetryWords[] PROGMEM = "text\0binary\0delta\0key\0";
+#define TELEMETRY_KEY 3
+#endif
+
+typedef enum Setting_enum {
+    s_id,
+    s_mode,
+    s_dark,
+    s_auto,
+    s_manual,
+    s_tCalOffset
+} Setting;
+
+// the next token of the command, or NULL if there are no more
+static const char* nextToken (void)
+{
+    return strtok(NULL, tokenDelimiters);
+}
+
+// the position of the token, in any case, in a list of words (see
+// commandWords). The number of words in the list if the token isn't
+// one of them, or if there is no token
+static uint8_t wordIndex (
+    const char* token,
+    PGM_P words)
+{
+    uint8_t index = 0;
+    while ((pgm_read_byte_near(words) != 0) &&
+           ((token == NULL) || (strcasecmp_P(token, words) != 0))) {
+        words += strlen_P(words) + 1;
+        ++index;
+    }
+
+    return index;
+}
+
+static uint16_t calChannelCounts (
+    const CalibrationManager_channel channel)
+{
+    return (channel == cc_battery)
+        ? BatteryMonitor_currentCounts()
+        : InternalTemperatureMonitor_currentCounts();
+}
+
+// cal <channel> <point> <value>    the channel should read <value>
+//                                  now (point is 1 or 2)
+// where <channel> is batt or temp. <cmdToken> is the one after "cal".
+// The status message shows the readings the calibration gives
+static Reply calibrationCommand (
+    const char* cmdToken)
+{
+    Reply reply = r_error;
+
+    const uint8_t channel = wordIndex(cmdToken, calChannelWords);
+    cmdToken = nextToken();
+    const char* valueToken = nextToken();
+    if ((channel < cc_numChannels) && (valueToken != NULL)) {
+        const uint16_t counts = calChannelCounts(channel);
+        if ((counts != 0) &&
+            CalibrationManager_setPoint(channel, atoi(cmdToken),
+                counts, atoi(valueToken))) {
+            reply = r_ok;
+        }
+    }
+
+    return reply;
+}
+
+void CommandProcessor_processCommand (
+    const char* command)
+{
+#if 0
+    char msgbuf[80];
+    sprintf(msgbuf, "cmd: '%s'", command);
+    Console_print(msgbuf);
+#endif
+    Reply reply = r_ok;
+    char cmdTokenBuf[CMD_TOKEN_BUFFER_LEN];
+    strncpy(cmdTokenBuf, command, CMD_TOKEN_BUFFER_LEN-1);
+    cmdTokenBuf[CMD_TOKEN_BUFFER_LEN-1] = 0;
+    const char* cmdToken = strtok(cmdTokenBuf, tokenDelimiters);
+    if (cmdToken != NULL) {
+        // the word after the command, if any
+        const uint8_t command = wordIndex(cmdToken, commandWords);
+        cmdToken = nextToken();
+        switch (command) {
+            case c_status :
+                StatusIndicators_sendStatusMesssage();
+                reply = r_none;
+                break;
+#if STATUS_FRAMES
+            case c_telemetry : {
+                // the format of status messages, or "key" for a full
+                // frame next (delta format)
+                const uint8_t word = wordIndex(cmdToken, telemetryWords);
+                if (word == TELEMETRY_KEY) {
+                    StatusIndicators_requestKeyframe();
+                } else if (word < TELEMETRY_KEY) {
+                    StatusIndicators_setFormat((StatusIndicators_format)word);
+                } else {
+                    reply = r_error;
+                }
+                }
+                break;
+#endif
+#if STATUS_STREAM
+            case c_stream :
+                // stream <period in seconds> or stream off
+                if (wordIndex(cmdToken, PSTR("off")) == 0) {
+                    StatusIndicators_stream(0);
+                } else {
+                    const int period = (cmdToken != NULL) ? atoi(cmdToken) : 0;
+                    if (period > 0) {
+                        StatusIndicators_stream((uint16_t)period);
+                    } else {
+                        reply = r_error;
+                    }
+                }
+                break;
+#endif
+            case c_leds :
+                switch (wordIndex(cmdToken, onOffWords)) {
+                    case 0 :
+                        PowerCommand_turnOn();
+                        break;
+                    case 1 :
+                        PowerCommand_turnOff(AUTO_ON_LOCKOUT_TIME);
+                        break;
+                    default :
+                        reply = r_error;
+                        break;
+                }
+                break;
+            case c_settings : {
+                CharString_define(16, settingStr);
+                reply = r_none;
+                Console_printP(PSTR("{"));
+                CharString_copyP(PSTR("\"ID\":"), &settingStr);
+                StringUtils_appendDecimal(EEPROMStorage_deviceID, 0, &settingStr);
+                Console_printCS(&settingStr);
+                CharString_copyP(PSTR(",\"Mode\":\""), &settingStr);
+                CharString_appendC((char)EEPROMStorage_mode, &settingStr);
+                Console_printCS(&settingStr);
+                CharString_copyP(PSTR("\",\"Dark\":"), &settingStr);
+                StringUtils_appendDecimal(EEPROMStorage_darkLevel, 0, &settingStr);
+                Console_printCS(&settingStr);
+                CharString_copyP(PSTR(",\"Auto\":"), &settingStr);
+                StringUtils_appendDecimal(EEPROMStorage_autoTime, 0, &settingStr);
+                Console_printCS(&settingStr);
+                CharString_copyP(PSTR(",\"Manual\":"), &settingStr);
+                StringUtils_appendDecimal(EEPROMStorage_manualTime, 0, &settingStr);
+                Console_printCS(&settingStr);
+                CharString_copyP(PSTR("}"), &settingStr);
+                Console_printLineCS(&settingStr);
+                }
+                break;
+            case c_set : {
+                // set <setting> <value>
+                const char* valueToken = nextToken();
+                if (valueToken == NULL) {
+                    reply = r_error;
+                } else {
+                    const int value = atoi(valueToken);
+                    switch (wordIndex(cmdToken, settingWords)) {
+                        case s_id :
+                            EEPROMStorage_setDeviceId((uint8_t)value);
+                            break;
+                        case s_mode : {
+                            const char mode = valueToken[0];
+                            if ((mode == 'P') ||
+                                (mode == 'B') ||
+                                (mode == 'S')) {
+                                EEPROMStorage_setMode((uint8_t)mode);
+                            } else {
+                                reply = r_error;
+                            }
+                            }
+                            break;
+                        case s_dark :
+                            EEPROMStorage_setDarkLevel((uint8_t)value);
+                            break;
+                        case s_auto :
+                            EEPROMStorage_setAutoTime((uint16_t)value);
+                            break;
+                        case s_manual :
+                            EEPROMStorage_setManualTime((uint16_t)value);
+                            break;
+                        case s_tCalOffset :
+                            EEPROMStorage_setTempCalOffset((int16_t)value);
+                            break;
+                        default :
+                            reply = r_error;
+                            break;
+                    }
+                }
+                }
+                break;
+            case c_get :
+                if (wordIndex(cmdToken, PSTR("tCalOffset")) == 0) {
+                    CharString_define(16, offsetStr);
+                    reply = r_none;
+                    CharString_copyP(PSTR("tCalOffset: "), &offsetStr);
+                    StringUtils_appendDecimal(EEPROMStorage_tempCalOffset, 0, &offsetStr);
+                    Console_printLineCS(&offsetStr);
+                } else {
+                    reply = r_error;
+                }
+                break;
+            case c_cal :
+                reply = calibrationCommand(cmdToken);
+                break;
+            case c_echo :
+                switch (wordIndex(cmdToken, onOffWords)) {
+                    case 0 :
+                        Console_setEcho(true);
+                        break;
+                    case 1 :
+                        Console_setEcho(false);
+                        break;
+                    default :
+                        reply = r_error;
+                        break;
+                }
+                break;
+            case c_serial : {
+                // receive errors since the last time: framing, noise
+                // and overrun, and the bit time in CPU clocks
+                SoftwareSerialRx_Errors rxErrors;
+                SoftwareSerialRx_takeErrors(&rxErrors);
+                CharString_define(32, serialStr);
+                reply = r_none;
+                CharString_copyP(PSTR("Serial: F"), &serialStr);
+                StringUtils_appendUnsigned(rxErrors.framingErrors, &serialStr);
+                CharString_appendP(PSTR(" N"), &serialStr);
+                StringUtils_appendUnsigned(rxErrors.noisyBytes, &serialStr);
+                CharString_appendP(PSTR(" O"), &serialStr);
+                StringUtils_appendUnsigned(rxErrors.overruns, &serialStr);
+                CharString_appendP(PSTR(" B"), &serialStr);
+                StringUtils_appendUnsigned(SoftwareSerialRx_bitTime(), &serialStr);
+                Console_printLineCS(&serialStr);
+                }
+                break;
+#if SYSTEMTIME_HOOK_USAGE
+            case c_isr : {
+                // tick hook usage of the tick interrupt, in
+                // microseconds, by priority
+                CharString_define(24, hookStr);
+                reply = r_none;
+                for (uint8_t p = 0; p < SYSTEMTIME_MAX_TICK_HOOKS; ++p) {
+                    uint8_t divider;
+                    uint32_t totalUs;
+                    uint16_t maxUs;
+                    if (SystemTime_getTickHookUsage(p,
+                            &divider, &totalUs, &maxUs)) {
+                        CharString_copyP(PSTR("P"), &hookStr);
+                        StringUtils_appendDecimal(p, 0, &hookStr);
+                        CharString_appendP(PSTR(" D"), &hookStr);
+                        StringUtils_appendDecimal(divider, 0, &hookStr);
+                        CharString_appendP(PSTR(" T"), &hookStr);
+                        StringUtils_appendDecimal32(totalUs, &hookStr);
+                        CharString_appendP(PSTR(" M"), &hookStr);
+                        StringUtils_appendDecimal32(maxUs, &hookStr);
+                        Console_printLineCS(&hookStr);
+                    }
+                }
+                }
+                break;
+#endif
+#if PROFILE_TASKS
+            case c_prof :
+                // prof, prof <task> or prof reset
+                reply = r_none;
+                if (cmdToken == NULL) {
+                    TaskProfiler_startReport();
+                } else if (wordIndex(cmdToken, PSTR("reset")) == 0) {
+                    TaskProfiler_reset();
+                    reply = r_ok;
+                } else {
+                    CharString_define(64, profStr);
+                    if (TaskProfiler_appendProfile(atoi(cmdToken), &profStr)) {
+                        Console_printLineCS(&profStr);
+                    } else {
+                        reply = r_error;
+                    }
+                }
+                break;
+#endif
+            case c_ver :
+                Console_printLineP(swver);
+                reply = r_none;
+                break;
+            default :
+                reply = r_error;
+                break;
+        }
+    }
+    switch (reply) {
+        case r_none :
+            break;
+        case r_ok :
+            Console_printLineP(PSTR("OK"));
+            break;
+        case r_error :
+            Console_printLineP(PSTR("ERROR"));
+            break;
+    }
+}
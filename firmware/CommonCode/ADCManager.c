@@ -1,194 +1,396 @@
-//
-//  Analog to Digital Converter Manager
-//
-
-#include "ADCManager.h"
-
-#include "../SystemTime.h"
-#include <stdlib.h>
-
-#include <avr/pgmspace.h>
-
-// Analog to Digital converter - AtTiny84
-// ADC single-ended input channels (use one only)
-#define ADC_SINGLE_ENDED_INPUT_ADC0 0   // PA0
-#define ADC_SINGLE_ENDED_INPUT_ADC1 1   // PA1
-#define ADC_SINGLE_ENDED_INPUT_ADC2 2   // PA2
-#define ADC_SINGLE_ENDED_INPUT_ADC3 3   // PA3
-#define ADC_SINGLE_ENDED_INPUT_ADC4 4   // PA4
-#define ADC_SINGLE_ENDED_INPUT_ADC5 5   // PA5
-#define ADC_SINGLE_ENDED_INPUT_ADC6 6   // PA6
-#define ADC_SINGLE_ENDED_INPUT_ADC7 7   // PA7
-#define ADC_SINGLE_ENDED_INPUT_0V   32  // AGND
-#define ADC_SINGLE_ENDED_INPUT_1_1V 33  // I Ref
-#define ADC_SINGLE_ENDED_INPUT_ADC8 34  // ADC8
-#define ADC_MUX_MASK 0x1F
-// ADC clock prescaler
-#define ADC_PRESCALER_2     1
-#define ADC_PRESCALER_4     2
-#define ADC_PRESCALER_8     3
-#define ADC_PRESCALER_16    4
-#define ADC_PRESCALER_32    5
-#define ADC_PRESCALER_64    6
-#define ADC_PRESCALER_128   7
-// ADC Control and Status
-#define ADC_ENABLE              (1 << ADEN)
-#define ADC_START               (1 << ADSC)
-#define ADC_AUTO_TRIGGER_ENABLE (1 << ADATE)
-#define ADC_INTERRUPT_FLAG      (1 << ADIF)
-#define ADC_INTERRUPT_ENABLE    (1 << ADIE)
-#define ADC_LEFT_ADJUST_RESULT  (1 << ADLAR)
-#define ADC_RIGHT_ADJUST_RESULT (0)
-
-// ADC channel-to-mask table
-const prog_uint8_t channelMasks[] = {
-    ADC_SINGLE_ENDED_INPUT_ADC0,
-    ADC_SINGLE_ENDED_INPUT_ADC1,
-    ADC_SINGLE_ENDED_INPUT_ADC2,
-    ADC_SINGLE_ENDED_INPUT_ADC3,
-    ADC_SINGLE_ENDED_INPUT_ADC4,
-    ADC_SINGLE_ENDED_INPUT_ADC5,
-    ADC_SINGLE_ENDED_INPUT_ADC6,
-    ADC_SINGLE_ENDED_INPUT_ADC7,
-    ADC_SINGLE_ENDED_INPUT_ADC8
-};
-
-typedef struct {
-    uint8_t admux;  // reference selection and channel selection
-    bool leftAdjustResult;
-} ADCChannelSetup;
-
-// controller states
-typedef enum ADCManagerState_enum {
-    adcms_idle,
-    adcms_waitingForADCFirstSample,
-    adcms_waitingForADCSecondSample,
-    adcms_conversionComplete
-} ADCManagerState;
-// state variables
-static ADCManagerState adcmsState = adcms_idle;
-static ADCChannelSetup currentChannelSetup;
-static ADCChannelSetup adcChannels[9];
-
-static void ADC_Init (
-    const uint8_t prescale)
-{
-    ADCSRA = (ADCSRA & 0xF8) | prescale;
-    ADCSRA |= ADC_ENABLE;
-}
-
-// admux consists of voltage reference selection and  input channel selection
-static void ADC_StartConversion (
-    const ADCChannelSetup *chanSetup)
-{
-    ADMUX = chanSetup->admux;
-    if (chanSetup->leftAdjustResult) {
-        ADCSRB |= ADC_LEFT_ADJUST_RESULT;
-    } else {
-        ADCSRB &= ~ADC_LEFT_ADJUST_RESULT;
-    }
-   
-    ADCSRA |= ADC_START;
-}
-
-static bool ADC_ConversionIsFinished (void)
-{
-    return ((ADCSRA & ADC_INTERRUPT_FLAG) != 0);
-}
-
-// right-adjusted result
-static uint16_t ADC_Result (void)
-{
-    ADCSRA |= ADC_INTERRUPT_FLAG;
-    if (currentChannelSetup.leftAdjustResult) {
-        return (uint16_t)ADCH;
-    } else {
-        return ADC;
-    }
-}
-
-void ADCManager_Initialize (void)
-{
-    // set ADC for single-conversion, clock/16 prescaler
-    ADC_Init(ADC_PRESCALER_16);
-
-    adcmsState = adcms_idle;
-}
-
-void ADCManager_setupChannel (
-    const uint8_t channelIndex,
-    const uint8_t adcRef,
-    const bool leftAdjustResult)
-{
-    if (channelIndex <= 7) {
-        // pin number is same as channel number on AtTiny84
-        DDRA  &= ~(1 << channelIndex);   // make the channel an input
-        DIDR0 |=  (1 << channelIndex);   // turn off digital input
-    }
-
-    ADCChannelSetup chanSetup;
-    chanSetup.admux = adcRef | pgm_read_byte_near(&channelMasks[channelIndex]);
-    chanSetup.leftAdjustResult = leftAdjustResult;
-    adcChannels[channelIndex] = chanSetup;
-}
-
-void ADCManager_task (void)
-{
-    switch (adcmsState) {
-        case adcms_idle : {
-            }
-            break;
-        case adcms_waitingForADCFirstSample : {
-            if (ADC_ConversionIsFinished()) {
-                // start a second conversion (allows S/H time to settle)
-                ADC_StartConversion(&currentChannelSetup);
-                adcmsState = adcms_waitingForADCSecondSample;
-            }
-            }
-            break;
-        case adcms_waitingForADCSecondSample : {
-            if (ADC_ConversionIsFinished()) {
-                adcmsState = adcms_conversionComplete;
-            }
-            }
-            break;
-        case adcms_conversionComplete : {
-            }
-            break;
-		default :
-			// unknown state. reboot
-			SystemTime_commenceShutdown();
-			break;
-    }
-}
-
-bool ADCManager_StartConversion (
-    const uint8_t channelIndex)
-{
-    bool started = false;
-
-    if (adcmsState == adcms_idle) {
-        // nobody currently using ADC
-        currentChannelSetup = adcChannels[channelIndex];
-        ADC_StartConversion(&currentChannelSetup);
-        adcmsState = adcms_waitingForADCFirstSample;
-        started = true;
-    }
-
-    return started;
-}
-
-bool ADCManager_ConversionIsComplete (
-    uint16_t* analogValue)
-{
-    bool completed = false;
-    
-    if (adcmsState == adcms_conversionComplete) {
-        completed = true;
-        *analogValue = ADC_Result();
-        adcmsState = adcms_idle;
-    }
-
-    return completed;
-}
-
+//
+//  Analog to Digital Converter Manager
+//
+//  How it works:
+//      The ADC is auto triggered by the timer compare match that is
+//      the SystemTime tick (Timer 0's compare A, or Timer 1's compare
+//      B). A SystemTime tick hook counts down each
+//      channel's interval and marks the channel due. The due channel
+//      is selected, and any settling conversions are run right away
+//      (started by writing ADSC, and thrown away by the ADC interrupt).
+//      Then the auto trigger is turned on, and the next tick's compare
+//      match starts the conversion that is kept. So a channel's results
+//      are taken at the compare match, an exact number of ticks apart,
+//      however late the tick interrupt or the main loop runs.
+//
+//      With ADCMANAGER_OVERSAMPLING, an oversampling channel's tick
+//      starts the first of its 4^n conversions, and the ADC interrupt
+//      starts each of the others as the one before it finishes, adding
+//      them up. The sum, shifted down by n, is the channel's result.
+//
+//      When a result is complete the ADC interrupt stores it and
+//      selects the next due channel for the next tick. Due channels
+//      are taken in round-robin order, so a channel with a short
+//      interval can't keep the others out; one that has to wait a tick
+//      goes back on its own schedule for its next result. When nothing
+//      is due the auto trigger is turned off until the tick hook finds
+//      something. Channels are first due on different ticks (see
+//      ADCManager_setupChannel), so channels with the same interval
+//      don't collide.
+//
+//      With ADCMANAGER_SLEEP, a noise reduction channel's conversion
+//      isn't auto triggered, because the timers stop in the noise
+//      reduction sleep mode.
+//      Instead the scan waits, with the channel selected, until the
+//      main loop asks for its sleep mode. It gets SLEEP_MODE_ADC, and
+//      going to sleep in that mode starts the conversion. The ADC
+//      interrupt wakes the CPU when the conversion is done. These
+//      results are taken on the main loop's first sleep after the
+//      tick, rather than at the tick itself.
+//
+//      Each channel keeps its latest result and a count of its results.
+//      Clients keep their own count of the results they have taken, so
+//      any number of clients can read a channel, and none of them has
+//      to wait for the ADC.
+//
+
+#include "ADCManager.h"
+
+#include "../SystemTime.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+// Analog to Digital converter - AtTiny84
+// ADC single-ended input channels (use one only)
+#define ADC_SINGLE_ENDED_INPUT_ADC0 0   // PA0
+#define ADC_SINGLE_ENDED_INPUT_ADC1 1   // PA1
+#define ADC_SINGLE_ENDED_INPUT_ADC2 2   // PA2
+#define ADC_SINGLE_ENDED_INPUT_ADC3 3   // PA3
+#define ADC_SINGLE_ENDED_INPUT_ADC4 4   // PA4
+#define ADC_SINGLE_ENDED_INPUT_ADC5 5   // PA5
+#define ADC_SINGLE_ENDED_INPUT_ADC6 6   // PA6
+#define ADC_SINGLE_ENDED_INPUT_ADC7 7   // PA7
+#define ADC_SINGLE_ENDED_INPUT_0V   32  // AGND
+#define ADC_SINGLE_ENDED_INPUT_1_1V 33  // I Ref
+#define ADC_SINGLE_ENDED_INPUT_ADC8 34  // ADC8
+#define ADC_MUX_MASK 0x1F
+// ADC clock prescaler
+#define ADC_PRESCALER_2     1
+#define ADC_PRESCALER_4     2
+#define ADC_PRESCALER_8     3
+#define ADC_PRESCALER_16    4
+#define ADC_PRESCALER_32    5
+#define ADC_PRESCALER_64    6
+#define ADC_PRESCALER_128   7
+// ADC Control and Status
+#define ADC_ENABLE              (1 << ADEN)
+#define ADC_START               (1 << ADSC)
+#define ADC_AUTO_TRIGGER_ENABLE (1 << ADATE)
+#define ADC_INTERRUPT_FLAG      (1 << ADIF)
+#define ADC_INTERRUPT_ENABLE    (1 << ADIE)
+#define ADC_LEFT_ADJUST_RESULT  (1 << ADLAR)
+#define ADC_RIGHT_ADJUST_RESULT (0)
+// ADC auto trigger source
+#define ADC_TRIGGER_SOURCE_MASK         0x07
+#define ADC_TRIGGER_TIMER0_COMPARE_A    3
+#define ADC_TRIGGER_TIMER1_COMPARE_B    5
+#if SYSTEMTIME_TICK_ON_TIMER1
+#define ADC_TRIGGER_TICK ADC_TRIGGER_TIMER1_COMPARE_B
+#else
+#define ADC_TRIGGER_TICK ADC_TRIGGER_TIMER0_COMPARE_A
+#endif
+
+#define NO_ADMUX 0xFF
+#define TICK_HOOK_PRIORITY 3
+
+typedef struct {
+    uint8_t channelIndex;
+    uint8_t admux;              // reference selection and channel selection
+    uint8_t settleConversions;
+    uint8_t options;            // ADCMANAGER_xxx
+    uint8_t interval;           // ticks between conversions
+    uint8_t countdown;          // ticks until the next one is due
+    bool due;
+    volatile uint8_t resultCount;
+    volatile uint16_t result;
+    ADCManager_Notification notification;
+} ScanEntry;
+
+// state variables
+static ScanEntry scanList[ADCMANAGER_MAX_CHANNELS];
+static uint8_t numScanEntries;
+static volatile bool converting;        // a channel is selected
+static ScanEntry* currentEntry;         // entry being converted (or last)
+static uint8_t conversionsToDiscard;    // ...before its result is kept
+#if ADCMANAGER_OVERSAMPLING
+static uint8_t oversampleBits;          // extra bits in its result
+static uint8_t samplesTaken;            // conversions in its result so far
+static uint16_t sampleSum;
+#endif
+static uint8_t lastADMUX;               // setting of the last conversion
+#if ADCMANAGER_SLEEP
+static volatile bool waitingForSleep;   // noise reduction conversion is next
+#endif
+
+static void ADC_Init (
+    const uint8_t prescale)
+{
+    ADCSRA = (ADCSRA & 0xF8) | prescale;
+    ADCSRB = (ADCSRB & ~ADC_TRIGGER_SOURCE_MASK) | ADC_TRIGGER_TICK;
+    ADCSRA |= ADC_ENABLE;
+}
+
+// sets up the current entry's next conversion: a settling conversion
+// (or the rest of an oversampled result) now, the first (or only)
+// conversion of a result on the next tick, or a noise reduction
+// conversion in the main loop's sleep.
+// interrupts must be disabled when calling this
+static void convert (void)
+{
+#if ADCMANAGER_SLEEP
+    if ((conversionsToDiscard == 0) &&
+        ((currentEntry->options & ADCMANAGER_NOISE_REDUCTION) != 0)) {
+        // going to sleep starts it
+        ADCSRA = (ADCSRA & ~ADC_AUTO_TRIGGER_ENABLE) | ADC_INTERRUPT_ENABLE;
+        waitingForSleep = true;
+        return;
+    }
+#endif
+#if ADCMANAGER_OVERSAMPLING
+    if ((conversionsToDiscard == 0) && (samplesTaken == 0)) {
+#else
+    if (conversionsToDiscard == 0) {
+#endif
+        ADCSRA |= (ADC_AUTO_TRIGGER_ENABLE | ADC_INTERRUPT_ENABLE);
+    } else {
+        ADCSRA = (ADCSRA & ~ADC_AUTO_TRIGGER_ENABLE) |
+            (ADC_START | ADC_INTERRUPT_ENABLE);
+    }
+}
+
+// interrupts must be disabled when calling this
+static void startConversion (
+    ScanEntry* entry)
+{
+    conversionsToDiscard = (entry->admux != lastADMUX)
+        ? entry->settleConversions
+        : 0;
+    lastADMUX = entry->admux;
+#if ADCMANAGER_OVERSAMPLING
+    oversampleBits = (entry->options & ADCMANAGER_OVERSAMPLE_MASK) >> 1;
+    samplesTaken = 0;
+    sampleSum = 0;
+#endif
+    currentEntry = entry;
+    converting = true;
+
+    ADMUX = entry->admux;
+    convert();
+}
+
+// starts the first due channel after the current one, or stops
+// the ADC if none are due. interrupts must be disabled when calling this
+static void startNextDueChannel (void)
+{
+    converting = false;
+    ADCSRA &= ~ADC_AUTO_TRIGGER_ENABLE;
+
+    ScanEntry* entry = currentEntry;
+    for (uint8_t e = 0; e < numScanEntries; ++e) {
+        ++entry;
+        if (entry >= &scanList[numScanEntries]) {
+            entry = scanList;
+        }
+        if (entry->due) {
+            entry->due = false;
+            startConversion(entry);
+            break;
+        }
+    }
+}
+
+// called from the SystemTime tick interrupt
+static void scanTick (void)
+{
+    ScanEntry* entry = scanList;
+    for (uint8_t e = 0; e < numScanEntries; ++e, ++entry) {
+        if (--entry->countdown == 0) {
+            entry->countdown = entry->interval;
+            entry->due = true;
+        }
+    }
+
+    if (!converting) {
+        startNextDueChannel();
+    }
+}
+
+void ADCManager_Initialize (void)
+{
+    // set ADC for conversions triggered by the tick, clock/16 prescaler
+    ADC_Init(ADC_PRESCALER_16);
+
+    memset(scanList, 0, sizeof(scanList));
+    numScanEntries = 0;
+    converting = false;
+    currentEntry = scanList;
+    conversionsToDiscard = 0;
+#if ADCMANAGER_OVERSAMPLING
+    oversampleBits = 0;
+    samplesTaken = 0;
+    sampleSum = 0;
+#endif
+    lastADMUX = NO_ADMUX;
+#if ADCMANAGER_SLEEP
+    waitingForSleep = false;
+#endif
+
+    SystemTime_registerTickHook(scanTick, TICK_HOOK_PRIORITY, 1);
+}
+
+// the channel's scan list entry, or NULL if it hasn't been set up
+static ScanEntry* findEntry (
+    const uint8_t channelIndex)
+{
+    ScanEntry* entry = scanList;
+    for (uint8_t e = 0; e < numScanEntries; ++e, ++entry) {
+        if (entry->channelIndex == channelIndex) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+bool ADCManager_setupChannel (
+    const uint8_t channelIndex,
+    const uint8_t adcRef,
+    const uint8_t options,
+    const uint8_t interval,
+    const uint8_t settleConversions,
+    ADCManager_Notification notification)
+{
+    if (numScanEntries >= ADCMANAGER_MAX_CHANNELS) {
+        return false;
+    }
+
+    if (channelIndex <= 7) {
+        // pin number is same as channel number on AtTiny84
+        DDRA  &= ~(1 << channelIndex);   // make the channel an input
+        DIDR0 |=  (1 << channelIndex);   // turn off digital input
+    }
+
+    // channels are set up before interrupts are enabled, and the rest
+    // of the entry was cleared by ADCManager_Initialize
+    ScanEntry* entry = &scanList[numScanEntries];
+    entry->channelIndex = channelIndex;
+    entry->admux = adcRef | ((channelIndex == 8)
+        ? ADC_SINGLE_ENDED_INPUT_ADC8
+        : channelIndex);
+    entry->settleConversions = settleConversions;
+    entry->options = options;
+    entry->interval = interval;
+    entry->countdown = numScanEntries + 1;
+    entry->notification = notification;
+    ++numScanEntries;
+
+    return true;
+}
+
+void ADCManager_setChannelInterval (
+    const uint8_t channelIndex,
+    const uint8_t interval)
+{
+    ScanEntry* entry = findEntry(channelIndex);
+    if (entry != NULL) {
+        char SREGSave;
+        SREGSave = SREG;
+        cli();
+        entry->interval = interval;
+        if (entry->countdown > interval) {
+            entry->countdown = interval;
+        }
+        SREG = SREGSave;
+    }
+}
+
+#if ADCMANAGER_SLEEP
+uint8_t ADCManager_sleepMode (
+    const bool timersMustRun)
+{
+    uint8_t sleepMode = SLEEP_MODE_IDLE;
+
+    if (waitingForSleep) {
+        if (timersMustRun) {
+            // convert in idle mode, without the noise reduction
+            waitingForSleep = false;
+            ADCSRA |= ADC_START;
+        } else {
+            // still waiting until the conversion's interrupt, in case
+            // the main loop doesn't go to sleep after all
+            sleepMode = SLEEP_MODE_ADC;
+        }
+    }
+
+    return sleepMode;
+}
+#endif
+
+bool ADCManager_takeResult (
+    const uint8_t channelIndex,
+    uint8_t* resultsTaken,
+    uint16_t* result)
+{
+    bool taken = false;
+
+    const ScanEntry* entry = findEntry(channelIndex);
+    if (entry != NULL) {
+        char SREGSave;
+        SREGSave = SREG;
+        cli();
+        const uint8_t resultCount = entry->resultCount;
+        if (resultCount != *resultsTaken) {
+            *result = entry->result;
+            *resultsTaken = resultCount;
+            taken = true;
+        }
+        SREG = SREGSave;
+    }
+
+    return taken;
+}
+
+// stores the current channel's result and moves on to the next one.
+// called from the ADC interrupt handler
+static void storeResult (
+    const uint16_t result)
+{
+    ScanEntry* entry = currentEntry;
+    entry->result = result;
+    ++entry->resultCount;
+    if (entry->notification != NULL) {
+        entry->notification();
+    }
+
+    startNextDueChannel();
+}
+
+ISR(SIG_ADC, ISR_BLOCK)
+{
+#if ADCMANAGER_SLEEP
+    // a noise reduction conversion has been done, if one was waiting
+    waitingForSleep = false;
+#endif
+
+    if (conversionsToDiscard > 0) {
+        // still settling
+        --conversionsToDiscard;
+        convert();
+    } else {
+#if ADCMANAGER_OVERSAMPLING
+        sampleSum += ADC;
+        ++samplesTaken;
+        if (samplesTaken < (uint8_t)(1 << (oversampleBits * 2))) {
+            // oversampling. convert again
+            convert();
+        } else {
+            storeResult(sampleSum >> oversampleBits);
+        }
+#else
+        storeResult(ADC);
+#endif
+    }
+}
@@ -1,47 +1,115 @@
-//
-//  Analog to Digital Converter Manager
-//
-//  Used to reserve the ADC and do conversions
-//
-#ifndef ADCMANAGER_H
-#define ADCMANAGER_H
-
-#include <stdint.h>
-#include <stdbool.h>
-#include <avr/io.h>
-
-// ADC voltage reference selection (use one only)
-#define ADC_REF_VCC         0
-#define ADC_REF_AREF        (1 << REFS0)
-#define ADC_REF_INTERNAL    (1 << REFS1)
-
-#define COUNTS_PER_VOLT 205
-
-// called once at power-up
-extern void ADCManager_Initialize (void);
-
-// call once at the beginning of program after power-up for
-// each channel you intend to use
-extern void ADCManager_setupChannel (
-    const uint8_t channelIndex,
-    const uint8_t adcRef,   // one of ADC_REF_xxx
-    const bool leftAdjustResult);
-
-// schedules and reads the requested channel
-// called in each iteration of the mainloop
-extern void ADCManager_task (void);
-
-// returns true and starts a conversion if the ADC is
-// available (not in use by another caller).
-// channel must be one of ADC_CHANNELn as defined in
-// LUFA/Drivers/Peripheral/ADC.h
-extern bool ADCManager_StartConversion (
-    const uint8_t channelIndex);
-
-// returns true when the conversion is complete and
-// returns the analog value. only passes the value
-// to the caller the first time it returns true
-extern bool ADCManager_ConversionIsComplete (
-    uint16_t* analogValue);
-
-#endif  // ADCMANAGER_H
+//
+//  Analog to Digital Converter Manager
+//
+//  Scans a list of ADC channels from the ADC interrupt. Each channel
+//  is converted at its own interval, and its latest result is kept for
+//  clients to read without reserving the ADC.
+//  Conversions are started by the SystemTime tick's timer compare
+//  match, so a channel's results are evenly spaced in time
+//
+//  With ADCMANAGER_SLEEP, channels can be converted in the ADC Noise
+//  Reduction sleep mode, with the CPU and the I/O clock stopped. The
+//  conversion waits for the main loop to go to sleep (see
+//  ADCManager_sleepMode). Timer 0 and Timer 1 stop while it runs
+//  (about 210uS), which stretches the SystemTime tick that it lands
+//  in. The serial port's bit times can't stretch, so the scheduler
+//  asks for idle mode while it is busy
+//
+#ifndef ADCMANAGER_H
+#define ADCMANAGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+
+// ADC voltage reference selection (use one only)
+#define ADC_REF_VCC         0
+#define ADC_REF_AREF        (1 << REFS0)
+#define ADC_REF_INTERNAL    (1 << REFS1)
+
+#define COUNTS_PER_VOLT 205
+
+// the noise reduction sleep mode conversions. They don't fit in the
+// flash with the rest of the firmware, so they are only built on
+// request. Without them ADCMANAGER_NOISE_REDUCTION is ignored
+#ifndef ADCMANAGER_SLEEP
+#define ADCMANAGER_SLEEP false
+#endif
+
+// oversampled channels (see ADCMANAGER_OVERSAMPLE). They don't fit in
+// the flash with the rest of the firmware either, so they are only
+// built on request. Without them the option is ignored, and every
+// result is a single 10-bit conversion
+#ifndef ADCMANAGER_OVERSAMPLING
+#define ADCMANAGER_OVERSAMPLING false
+#endif
+
+// number of channels the scan list can hold
+#define ADCMANAGER_MAX_CHANNELS 3
+
+// channel options
+#define ADCMANAGER_NOISE_REDUCTION 0x01 // convert with the CPU asleep
+// each result is the sum of 4^n conversions scaled down by 2^n, which
+// gives it n more bits (n is 1 to 3, so results are 11 to 13 bits).
+// The conversions run back to back, 4^n times as long as one.
+// Oversampling needs a count or so of noise on the input to add
+// resolution, so it doesn't go well with ADCMANAGER_NOISE_REDUCTION
+#define ADCMANAGER_OVERSAMPLE(n) ((n) << 1)
+#define ADCMANAGER_OVERSAMPLE_MASK 0x06
+
+// prototype for a function that is told when a channel has a new
+// result. It is called from the ADC interrupt handler
+typedef void (*ADCManager_Notification)(void);
+
+// called once at power-up, after SystemTime_Initialize
+extern void ADCManager_Initialize (void);
+
+// adds a channel to the scan list. Call once at power-up, before
+// interrupts are enabled, for each channel you intend to use. The
+// channel comes due every <interval> (1..255) ticks, and is converted
+// at the start of the tick after that. The first time it comes due is
+// n+1 ticks after power-up, where n is the number of channels set up
+// before it, so that channels with the same interval take turns. A
+// channel that has to wait for another one is converted a tick late,
+// and then goes back to its schedule.
+// When the ADC switches to the channel from a different channel or
+// reference, the first <settleConversions> conversions are thrown
+// away to give the sample-and-hold (and the reference) time to settle.
+// <notification> (which may be NULL) is told about each result.
+// Returns false if the scan list is full
+extern bool ADCManager_setupChannel (
+    const uint8_t channelIndex,
+    const uint8_t adcRef,   // one of ADC_REF_xxx
+    const uint8_t options,  // ADCMANAGER_xxx, or'ed together
+    const uint8_t interval,
+    const uint8_t settleConversions,
+    ADCManager_Notification notification);
+
+// changes the channel's interval (1..255). If the channel was due later than
+// <interval> ticks from now, it comes due then instead
+extern void ADCManager_setChannelInterval (
+    const uint8_t channelIndex,
+    const uint8_t interval);
+
+#if ADCMANAGER_SLEEP
+// the sleep mode for the main loop's next sleep: SLEEP_MODE_ADC if a
+// noise reduction channel is waiting to be converted (the conversion
+// starts as the CPU goes to sleep), otherwise SLEEP_MODE_IDLE. If the
+// timers can't be stopped just now, the waiting conversion is started
+// and the mode is SLEEP_MODE_IDLE. If the main loop doesn't go to
+// sleep after asking, the conversion waits for the next time it does
+extern uint8_t ADCManager_sleepMode (
+    const bool timersMustRun);
+#endif
+
+// takes the channel's latest result if the caller hasn't seen it yet.
+// <resultsTaken> is the caller's count of the channel's results, which
+// starts at 0. Results that came and went while the caller wasn't
+// looking are skipped. Returns false when the caller has seen the
+// latest one
+extern bool ADCManager_takeResult (
+    const uint8_t channelIndex,
+    uint8_t* resultsTaken,
+    uint16_t* result);
+
+#endif  // ADCMANAGER_H
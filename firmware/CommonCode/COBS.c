@@ -0,0 +1,36 @@
+//
+//  Consistent Overhead Byte Stuffing
+//
+//  How it works:
+//    Each zero in the data is replaced by a code byte that gives the
+//    distance to the next one, and an extra code byte at the start
+//    gives the distance to the first. The last code byte points just
+//    past the end of the data. Decoding follows the chain of codes,
+//    putting a zero back at each but the last.
+//
+
+#include "COBS.h"
+
+uint8_t COBS_encode (
+    const uint8_t* data,
+    const uint8_t length,
+    uint8_t* encoded)
+{
+    uint8_t codeIndex = 0;  // where the current code byte goes
+    uint8_t code = 1;       // distance from it so far
+    uint8_t encodedLength = 1;
+
+    for (uint8_t i = 0; i < length; ++i) {
+        if (data[i] == 0) {
+            encoded[codeIndex] = code;
+            codeIndex = encodedLength++;
+            code = 1;
+        } else {
+            encoded[encodedLength++] = data[i];
+            ++code;
+        }
+    }
+    encoded[codeIndex] = code;
+
+    return encodedLength;
+}
@@ -0,0 +1,24 @@
+//
+//  Consistent Overhead Byte Stuffing
+//
+//  Encodes a block of bytes so that it contains no zeros, which frees
+//  zero up to mark the ends of frames on a byte stream. The encoding
+//  is one byte longer than the data, whatever the data is.
+//
+#ifndef COBS_H
+#define COBS_H
+
+#include <stdint.h>
+
+// data this long or shorter is encoded as a single block
+#define COBS_MAX_DATA_LENGTH 253
+
+// encodes <length> bytes of <data> (at most COBS_MAX_DATA_LENGTH) into
+// <encoded>, which must have room for <length> + 1 bytes. Returns the
+// length of the encoding
+extern uint8_t COBS_encode (
+    const uint8_t* data,
+    const uint8_t length,
+    uint8_t* encoded);
+
+#endif  // COBS_H
@@ -1,77 +1,129 @@
-//
-//  Data History
-//
-
-#include "DataHistory.h"
-
-
-void DataHistory_insertValue (
-	const uint16_t value,
-	DataHistory_t* dataHistory)
-{
-    // put data in buffer
-    dataHistory->dataBuffer[dataHistory->tail] = value;
-	
-    // advance tail
-    if (dataHistory->tail >= (dataHistory->capacity - 1)) {
-        // wrap around
-        dataHistory->tail = 0;
-    } else {
-        ++dataHistory->tail;
-    }
-
-    // increment length
-    if (dataHistory->length < dataHistory->capacity) {
-        ++dataHistory->length;
-    }
-}
-
-uint16_t DataHistory_getLatest (
-    const DataHistory_t* dataHistory)
-{
-    uint16_t latest = 0;
-
-    if (dataHistory->length > 0) {
-        uint8_t dataIndex = ((dataHistory->tail == 0)
-            ? dataHistory->capacity
-            : dataHistory->tail) - 1;
-        latest = dataHistory->dataBuffer[dataIndex];
-    }
-
-    return latest;
-}
-
-void DataHistory_getStatistics (
-    const DataHistory_t* dataHistory,
-    const uint8_t numSamples,
-    uint16_t* min,
-    uint16_t* max,
-    uint16_t* avg)
-{
-    *min = 65535;
-    *max = 0;
-    *avg = 0;
-
-    if (dataHistory->length > 0) {
-        uint32_t sum = 0;
-        uint8_t dataIndex = ((dataHistory->tail == 0)
-            ? dataHistory->capacity
-            : dataHistory->tail) - 1;
-        for (int i = 0; i < numSamples; ++i) {
-            const uint16_t sample = dataHistory->dataBuffer[dataIndex];
-            if (sample < *min) {
-                *min = sample;
-            }
-            if (sample > *max) {
-                *max = sample;
-            }
-            sum += sample;
-
-            dataIndex = (
-                (dataIndex == 0)
-                    ? dataHistory->capacity
-                    : dataIndex) - 1;
-        }
-        *avg = (uint16_t)(sum / numSamples);
-    }
-}
+//
+//  Data History
+//
+
+#include "DataHistory.h"
+
+
+// the position after <position> in a ring of <capacity>
+static uint8_t nextPosition (
+    const uint8_t position,
+    const uint8_t capacity)
+{
+    return (position >= (capacity - 1))
+        ? 0
+        : (position + 1);
+}
+
+// the queue position <offset> entries after the oldest
+static uint8_t queuePosition (
+    const DataHistory_extremes* queue,
+    const uint8_t offset,
+    const uint8_t capacity)
+{
+    const uint16_t position = (uint16_t)queue->head + offset;
+    return (position >= capacity)
+        ? (uint8_t)(position - capacity)
+        : (uint8_t)position;
+}
+
+// drops the queue's oldest entry if it is in <slot>, which is about
+// to be overwritten. Only the oldest entry can be
+static void expireSlot (
+    const uint8_t slot,
+    const uint8_t capacity,
+    DataHistory_extremes* queue)
+{
+    if ((queue->length > 0) && (queue->slots[queue->head] == slot)) {
+        queue->head = nextPosition(queue->head, capacity);
+        --queue->length;
+    }
+}
+
+// drops the newest entries that can no longer be the min (or max)
+// now that <slot> holds a smaller (larger) value, then adds <slot>
+static void addSlot (
+    const uint8_t slot,
+    const bool forMax,
+    const DataHistory_t* dataHistory,
+    DataHistory_extremes* queue)
+{
+    const uint16_t value = dataHistory->dataBuffer[slot];
+    while (queue->length > 0) {
+        const uint8_t newest =
+            queuePosition(queue, queue->length - 1, dataHistory->capacity);
+        const uint16_t newestValue = dataHistory->dataBuffer[queue->slots[newest]];
+        if (forMax ? (newestValue > value) : (newestValue < value)) {
+            break;
+        }
+        --queue->length;
+    }
+
+    queue->slots[queuePosition(queue, queue->length, dataHistory->capacity)] = slot;
+    ++queue->length;
+}
+
+void DataHistory_insertValue (
+	const uint16_t value,
+	DataHistory_t* dataHistory)
+{
+    const uint8_t slot = dataHistory->tail;
+
+    // drop the oldest value if the buffer is full
+    if (dataHistory->length >= dataHistory->capacity) {
+        dataHistory->sum -= dataHistory->dataBuffer[slot];
+        expireSlot(slot, dataHistory->capacity, &dataHistory->minQueue);
+        expireSlot(slot, dataHistory->capacity, &dataHistory->maxQueue);
+    } else {
+        // increment length
+        ++dataHistory->length;
+    }
+
+    // put data in buffer
+    dataHistory->dataBuffer[slot] = value;
+    dataHistory->sum += value;
+    addSlot(slot, false, dataHistory, &dataHistory->minQueue);
+    addSlot(slot, true, dataHistory, &dataHistory->maxQueue);
+
+    // advance tail
+    dataHistory->tail = nextPosition(slot, dataHistory->capacity);
+}
+
+uint16_t DataHistory_getLatest (
+    const DataHistory_t* dataHistory)
+{
+    uint16_t latest = 0;
+
+    if (dataHistory->length > 0) {
+        uint8_t dataIndex = ((dataHistory->tail == 0)
+            ? dataHistory->capacity
+            : dataHistory->tail) - 1;
+        latest = dataHistory->dataBuffer[dataIndex];
+    }
+
+    return latest;
+}
+
+void DataHistory_getStatistics (
+    const DataHistory_t* dataHistory,
+    uint16_t* min,
+    uint16_t* max,
+    uint16_t* avg)
+{
+    *min = 65535;
+    *max = 0;
+    *avg = 0;
+
+    if (dataHistory->length > 0) {
+        const DataHistory_extremes* minQueue = &dataHistory->minQueue;
+        const DataHistory_extremes* maxQueue = &dataHistory->maxQueue;
+        *min = dataHistory->dataBuffer[minQueue->slots[minQueue->head]];
+        *max = dataHistory->dataBuffer[maxQueue->slots[maxQueue->head]];
+        if ((dataHistory->length == dataHistory->capacity) &&
+            (dataHistory->capacityShift != DATAHISTORY_NOT_POW2)) {
+            *avg = (uint16_t)(dataHistory->sum >> dataHistory->capacityShift);
+        } else {
+            *avg = (uint16_t)(dataHistory->sum / dataHistory->length);
+        }
+    }
+}
@@ -1,53 +1,198 @@
-//
-//  Data History
-//
-//  The object defined here is used to retain the latest
-//  n data readings, and provide a min, max, and
-//  average value over the readings
-//
-#ifndef DATAHISTORY_H
-#define DATAHISTORY_H
-
-#include <stdint.h>
-#include <stdbool.h>
-
-typedef struct {
-    uint8_t tail;
-    uint8_t length;
-    uint8_t capacity;
-    uint16_t* dataBuffer;
-} DataHistory_t;
-
-#define DataHistory_define(capacity, name) \
-    uint16_t name##_buf[capacity] = {0}; \
-    DataHistory_t name = {0, 0, capacity, name##_buf};
-
-inline void DataHistory_clear (
-    DataHistory_t* dataHistory)
-{
-    dataHistory->tail = 0;
-    dataHistory->length = 0;
-}
-
-extern void DataHistory_insertValue (
-    const uint16_t value,
-    DataHistory_t* dataHistory);
-
-inline uint8_t DataHistory_length (
-    DataHistory_t* dataHistory)
-{
-    return dataHistory->length;
-}
-
-extern uint16_t DataHistory_getLatest (
-    const DataHistory_t* dataHistory);
-
-// computes statistics on the latest numSamples data
-extern void DataHistory_getStatistics (
-    const DataHistory_t* dataHistory,
-    const uint8_t numSamples,
-    uint16_t* min,
-    uint16_t* max,
-    uint16_t* avg);
-
-#endif		// DATAHISTORY_H
\ No newline at end of file
+//
+//  Data History
+//
+//  The object defined here is used to retain the latest
+//  n data readings, and provide a min, max, and
+//  average value over the readings
+//
+//  The statistics are kept up to date as values are inserted, so
+//  getting them takes the same short time however many readings
+//  there are. The sum of the readings is kept for the average, and
+//  the min and max each have a queue of the readings that could
+//  still become the min (or max) as older readings drop out
+//
+#ifndef DATAHISTORY_H
+#define DATAHISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// readings that are, or could become, the min (or max). Oldest first,
+// and each one smaller (larger) than the ones before it
+typedef struct {
+    uint8_t head;           // position of the oldest entry
+    uint8_t length;
+    uint8_t* slots;         // dataBuffer indices, <capacity> of them
+} DataHistory_extremes;
+
+typedef struct {
+    uint8_t tail;
+    uint8_t length;
+    uint8_t capacity;
+    uint8_t capacityShift;  // log2(capacity), or DATAHISTORY_NOT_POW2
+    uint32_t sum;
+    uint16_t* dataBuffer;
+    DataHistory_extremes minQueue;
+    DataHistory_extremes maxQueue;
+} DataHistory_t;
+
+#define DATAHISTORY_NOT_POW2 0xFF
+
+// log2 of capacities that are a power of two, so that the average of
+// a full history is a shift rather than a divide
+#define DataHistory_capacityShift(capacity) \
+    (((capacity) == 1)   ? 0 : \
+     ((capacity) == 2)   ? 1 : \
+     ((capacity) == 4)   ? 2 : \
+     ((capacity) == 8)   ? 3 : \
+     ((capacity) == 16)  ? 4 : \
+     ((capacity) == 32)  ? 5 : \
+     ((capacity) == 64)  ? 6 : \
+     ((capacity) == 128) ? 7 : \
+     DATAHISTORY_NOT_POW2)
+
+#define DataHistory_define(capacity, name) \
+    uint16_t name##_buf[capacity] = {0}; \
+    uint8_t name##_minSlots[capacity]; \
+    uint8_t name##_maxSlots[capacity]; \
+    DataHistory_t name = {0, 0, capacity, DataHistory_capacityShift(capacity), 0, name##_buf, \
+        {0, 0, name##_minSlots}, {0, 0, name##_maxSlots}};
+
+// Defines a history whose capacity is a power of two (up to 128) as
+// a set of inline functions specialized for it, so the index masks and
+// the averaging shift are constants:
+//      name_clear, name_insert, name_length, name_latest, name_stats
+// They work like the DataHistory_xxx functions of the same name. The
+// sum of the values is kept in a <sumType>, which must hold <capacity>
+// of the largest value inserted (uint16_t is enough for up to 64
+// 10-bit values, or 16 12-bit values). The history is static, so the
+// functions can only be used in the file that defines it
+#define DataHistory_define_pow2_sum(capacity, sumType, name) \
+    typedef char name##_capacityIsPow2 \
+        [(DataHistory_capacityShift(capacity) == DATAHISTORY_NOT_POW2) ? -1 : 1]; \
+    typedef struct { \
+        uint8_t head; \
+        uint8_t length; \
+        uint8_t slots[capacity]; \
+    } name##_extremes; \
+    static struct { \
+        uint8_t count;      /* values inserted, mod 256 */ \
+        uint8_t length; \
+        sumType sum; \
+        uint16_t values[capacity]; \
+        name##_extremes minQueue; \
+        name##_extremes maxQueue; \
+    } name; \
+    static inline void name##_clear (void) \
+    { \
+        name.count = 0; \
+        name.length = 0; \
+        name.sum = 0; \
+        name.minQueue.length = 0; \
+        name.maxQueue.length = 0; \
+    } \
+    static inline void name##_addSlot ( \
+        const uint8_t slot, \
+        const bool forMax, \
+        name##_extremes* queue) \
+    { \
+        const uint16_t value = name.values[slot]; \
+        while (queue->length > 0) { \
+            const uint8_t newest = \
+                (queue->head + queue->length - 1) & ((capacity) - 1); \
+            const uint16_t newestValue = name.values[queue->slots[newest]]; \
+            if (forMax ? (newestValue > value) : (newestValue < value)) { \
+                break; \
+            } \
+            --queue->length; \
+        } \
+        queue->slots[(queue->head + queue->length) & ((capacity) - 1)] = slot; \
+        ++queue->length; \
+    } \
+    static inline void name##_insert ( \
+        const uint16_t value) \
+    { \
+        const uint8_t slot = name.count & ((capacity) - 1); \
+        if (name.length >= (capacity)) { \
+            name.sum -= name.values[slot]; \
+            if (name.minQueue.slots[name.minQueue.head] == slot) { \
+                name.minQueue.head = (name.minQueue.head + 1) & ((capacity) - 1); \
+                --name.minQueue.length; \
+            } \
+            if (name.maxQueue.slots[name.maxQueue.head] == slot) { \
+                name.maxQueue.head = (name.maxQueue.head + 1) & ((capacity) - 1); \
+                --name.maxQueue.length; \
+            } \
+        } else { \
+            ++name.length; \
+        } \
+        name.values[slot] = value; \
+        name.sum += value; \
+        name##_addSlot(slot, false, &name.minQueue); \
+        name##_addSlot(slot, true, &name.maxQueue); \
+        ++name.count; \
+    } \
+    static inline uint8_t name##_length (void) \
+    { \
+        return name.length; \
+    } \
+    static inline uint16_t name##_latest (void) \
+    { \
+        return (name.length > 0) \
+            ? name.values[(uint8_t)(name.count - 1) & ((capacity) - 1)] \
+            : 0; \
+    } \
+    static inline void name##_stats ( \
+        uint16_t* min, \
+        uint16_t* max, \
+        uint16_t* avg) \
+    { \
+        *min = 65535; \
+        *max = 0; \
+        *avg = 0; \
+        if (name.length >= (capacity)) { \
+            *min = name.values[name.minQueue.slots[name.minQueue.head]]; \
+            *max = name.values[name.maxQueue.slots[name.maxQueue.head]]; \
+            *avg = (uint16_t)(name.sum >> DataHistory_capacityShift(capacity)); \
+        } else if (name.length > 0) { \
+            *min = name.values[name.minQueue.slots[name.minQueue.head]]; \
+            *max = name.values[name.maxQueue.slots[name.maxQueue.head]]; \
+            *avg = (uint16_t)(name.sum / name.length); \
+        } \
+    }
+
+#define DataHistory_define_pow2(capacity, name) \
+    DataHistory_define_pow2_sum(capacity, uint32_t, name)
+
+inline void DataHistory_clear (
+    DataHistory_t* dataHistory)
+{
+    dataHistory->tail = 0;
+    dataHistory->length = 0;
+    dataHistory->sum = 0;
+    dataHistory->minQueue.length = 0;
+    dataHistory->maxQueue.length = 0;
+}
+
+extern void DataHistory_insertValue (
+    const uint16_t value,
+    DataHistory_t* dataHistory);
+
+inline uint8_t DataHistory_length (
+    DataHistory_t* dataHistory)
+{
+    return dataHistory->length;
+}
+
+extern uint16_t DataHistory_getLatest (
+    const DataHistory_t* dataHistory);
+
+// gets the statistics of the data in the history. If it's empty
+// they are 65535, 0 and 0
+extern void DataHistory_getStatistics (
+    const DataHistory_t* dataHistory,
+    uint16_t* min,
+    uint16_t* max,
+    uint16_t* avg);
+
+#endif		// DATAHISTORY_H
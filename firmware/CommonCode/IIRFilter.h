@@ -0,0 +1,61 @@
+//
+//  IIR Filter
+//
+//  A single-pole (exponential) low pass filter over a stream of
+//  readings, for when a running average is wanted but a window of
+//  readings to average over isn't
+//
+//  Each reading moves the output 1/2^shift of the way to it, so the
+//  time constant is about 2^shift readings. Three bytes of state, and an
+//  update is a subtract, a shift and an add (no multiply, which the
+//  AtTiny84 doesn't have). The filter takes the first reading as its
+//  value, so it is valid from then on rather than after a window
+//  fills up
+//
+#ifndef IIRFILTER_H
+#define IIRFILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Defines a filter with a constant shift as a set of inline functions
+// specialized for it:
+//      name_clear          forget all readings
+//      name_insert         add a reading
+//      name_isValid        true once there has been a reading
+//      name_value          the filtered value (0 until there is one)
+// The filter keeps readings scaled up by 2^shift in 16 bits, so
+// readings must fit in 16 - <shift> bits (a shift of up to 4 for
+// 12-bit readings, or 6 for 10-bit ones). The filter is static, so the
+// functions can only be used in the file that defines it
+#define IIRFilter_define(shift, name) \
+    typedef char name##_shiftFits[((shift) > 0 && (shift) < 8) ? 1 : -1]; \
+    static struct { \
+        bool valid; \
+        uint16_t scaledValue;   /* value << shift */ \
+    } name; \
+    static inline void name##_clear (void) \
+    { \
+        name.valid = false; \
+        name.scaledValue = 0; \
+    } \
+    static inline void name##_insert ( \
+        const uint16_t value) \
+    { \
+        if (name.valid) { \
+            name.scaledValue += value - (name.scaledValue >> (shift)); \
+        } else { \
+            name.scaledValue = value << (shift); \
+            name.valid = true; \
+        } \
+    } \
+    static inline bool name##_isValid (void) \
+    { \
+        return name.valid; \
+    } \
+    static inline uint16_t name##_value (void) \
+    { \
+        return (name.scaledValue + (1 << ((shift) - 1))) >> (shift); \
+    }
+
+#endif      // IIRFILTER_H
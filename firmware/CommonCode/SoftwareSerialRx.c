@@ -1,148 +1,349 @@
-//
-//  Software Serial Receiver
-//
-//   Uses AtTiny84 16-bit Timer 1
-//
-//  Pin usage:
-//      PA5 - serial data in
-//
-//  How it works:
-//    Upon initializaation it sets a pin change interrupt on the serial
-//    data input pin. When the interrupt fires a timer is used to clock
-//    a state machine to read each bit and push the resulting byte into
-//    the queue.
-//
-
-#include "SoftwareSerialRx.h"
-
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <stdlib.h>
-
-#define SERIAL_RX_DDR      DDRA
-#define SERIAL_RX_PORT     PORTA
-#define SERIAL_RX_INPORT   PINA
-#define SERIAL_RX_PIN      PA5
-
-// with 1MHz clock and 64 prescale this 1/300 second
-#define BIT_CLOCK_TIME 52
-
-typedef enum RxState_enum {
-    rs_idle,
-    rs_waitingForStartBit,
-    rs_readingDataBits,
-    rs_waitingForStopBit
-} RxState;
-// state variables
-static volatile bool isEnabled;
-static volatile RxState rxState;
-static ByteQueueElement dataByte;
-static uint8_t bitMask;
-ByteQueue_define(16, rxQueue);
-
-static bool rxBit (void)
-{
-    return (SERIAL_RX_INPORT & (1 << SERIAL_RX_PIN)) != 0;
-}
-
-void SoftwareSerialRx_Initialize (void)
-{
-    // make rx pin an input and enable pullup
-    SERIAL_RX_DDR &= (~(1 << SERIAL_RX_PIN));
-    SERIAL_RX_PORT |= (1 << SERIAL_RX_PIN);
-
-    // set up timer1 to fire interrupt 300 Hz (baud clock)
-    TCCR1A &= 0xFC;                         // set CTC mode (WGM11:10)
-    TCCR1B = (TCCR1B & 0xE7) | (1 << 3);    // set CTC mode (WGM13:12)
-    TCCR1B = (TCCR1B & 0xF8) | 3; // prescale by 64
-    OCR1A = BIT_CLOCK_TIME;  // with 1MHz clock and 64 prescale this is 1/300 second
-    TCNT1 = 0;  // start the time counter at 0
-    TIFR1 |= (1 << OCF1A);  // "clear" the timer compare flag
-
-    // enable pin change interrupts
-    GIMSK |= (1 << PCIE0);
-
-    SoftwareSerialRx_enable();
-}
-
-void SoftwareSerialRx_enable (void)
-{
-    if (!isEnabled) {
-        rxState = rs_idle;
-        // set up pin change interrupt to detect start bit
-        PCMSK0 |= (1 << PCINT5);
-        isEnabled = true;
-    }
-}
-
-void SoftwareSerialRx_disable (void)
-{
-    if (isEnabled) {
-        TIMSK1 &= ~(1 << OCIE1A);   // disable timer compare match interrupt
-        PCMSK0 &= ~(1 << PCINT5);
-        isEnabled = false;
-    }
-}
-
-ByteQueue* SoftwareSerial_rxQueue (void)
-{
-    return &rxQueue;
-}
-
-ISR(PCINT0_vect, ISR_BLOCK)
-{
-    if (!rxBit()) {
-        TIFR1 |= (1 << OCF1A);  // "clear" the timer compare flag
-        TIMSK1 |= (1 << OCIE1A);// enable timer compare match interrupt
-        TCNT1 = 0;  // start the time counter at 0
-        // set timer for 1/2 bit time to get in the middle of the start bit
-        OCR1A = BIT_CLOCK_TIME / 2;
-
-        // disable this interrupt
-        PCMSK0 &= ~(1 << PCINT5);
-        rxState = rs_waitingForStartBit;
-    }
-}
-
-ISR(SIG_OUTPUT_COMPARE1A, ISR_BLOCK)
-{
-    switch (rxState) {
-        case rs_waitingForStartBit :
-            if (!rxBit()) {
-                // rx bit is low - got start bit
-                dataByte = 0;
-                bitMask = 1;
-                OCR1A = BIT_CLOCK_TIME;
-                rxState = rs_readingDataBits;
-            } else {
-                // expected low for start bit but didn't get it
-                TIMSK1 &= ~(1 << OCIE1A);// disable timer compare match interrupt
-                // re-enable pin change interrupt
-                PCMSK0 |= (1 << PCINT5);
-            }
-            break;
-        case rs_readingDataBits :
-            if (rxBit()) {
-                dataByte |= bitMask;
-            }
-            if (bitMask == 0x80) {
-                rxState = rs_waitingForStopBit;
-            } else {
-                bitMask <<= 1;
-            }
-            break;
-        case rs_waitingForStopBit :
-            if (rxBit()) {
-                // got stop bit.
-                ByteQueue_push(dataByte, &rxQueue);
-            }
-            TIMSK1 &= ~(1 << OCIE1A);// disable timer compare match interrupt
-            rxState = rs_idle;
-
-            // re-enable pin change interrupt
-            PCMSK0 |= (1 << PCINT5);
-            break;
-        default :
-            break;
-    }
-}
+//
+//  Software Serial Receiver
+//
+//   Uses AtTiny84 16-bit Timer 1
+//
+//  Pin usage:
+//      PA5 - serial data in
+//
+//  How it works:
+//    Upon initializaation it sets a pin change interrupt on the serial
+//    data input pin. When the interrupt fires a timer is used to clock
+//    a state machine to read each bit and push the resulting byte into
+//    the queue.
+//    Timer 1 runs free (normal mode, no prescaling) and is never reset.
+//    Bit times are scheduled by advancing the compare register, which
+//    leaves the counter usable as a timestamp by other modules.
+//
+//    Without SOFTWARESERIALRX_OVERSAMPLE each bit is sampled once, in
+//    its middle, at the nominal bit time. A start bit that comes out
+//    high was a glitch, and counts as noise.
+//
+//    With it, each bit is sampled three times, an eighth of a bit
+//    apart around its middle, and takes the value of the majority of
+//    the samples.
+//    A spike on the line changes one sample, not the bit. A bit whose
+//    samples disagree marks its byte as noisy. A start bit whose
+//    samples come out high was a glitch, and counts as noise too.
+//
+//    The RC oscillator can be a few percent off the sender's clock, so
+//    the bit time isn't taken as given. The pin change interrupt stays
+//    on after the start bit's edge to time the first rising edge. When
+//    data bit 0 is a 1 that is the end of the start bit, and otherwise
+//    it is at least two bit times out, so a rising edge within an
+//    eighth of the nominal bit time can only be the end of the start
+//    bit. That holds whether or not the byte came through, which lets
+//    the receiver find its way back after the sender's clock moves
+//    too far for bytes to come through. Both edges come in through
+//    the same interrupt, so its latency cancels out. Each measurement
+//    moves the bit time half of the way to it. The sampling
+//    starts over from each start bit's edge, so the error only builds
+//    up across one byte.
+//
+//    A byte whose stop bit is low is dropped as a framing error, and a
+//    byte that finds the queue full is dropped as an overrun. Both are
+//    counted, along with the noisy bytes, for the console to report.
+//
+
+#include "SoftwareSerialRx.h"
+#include "SoftwareSerialTx.h"
+
+// otherwise USISerial.c takes the port's place
+#if !SOFTWARESERIAL_USI
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SERIAL_RX_DDR      DDRA
+#define SERIAL_RX_PORT     PORTA
+#define SERIAL_RX_INPORT   PINA
+#define SERIAL_RX_PIN      PA5
+
+#define BAUD_RATE SOFTWARESERIAL_BAUD_RATE
+// timer 1 counts at the CPU clock
+#define BIT_CLOCK_TIME ((uint16_t)(F_CPU / BAUD_RATE))
+// the measured bit time is trusted this far from nominal
+#define BIT_TIME_TOLERANCE (BIT_CLOCK_TIME / 8)
+// the bit time moves 1/2 of the way to each measurement
+#define BIT_TIME_FILTER_SHIFT 1
+// CPU clocks from the start bit's edge until the pin change interrupt
+// reads the timer
+#define START_EDGE_LATENCY 40
+
+#if SOFTWARESERIALRX_OVERSAMPLE
+#define SAMPLES_PER_BIT 3
+#define MAJORITY_HIGH 2
+// samples are 1/8 bit time apart
+#define SAMPLE_SPACING_SHIFT 3
+// the compare interrupt has to be in and out between samples
+#define MIN_SAMPLE_SPACING 100
+#if ((F_CPU / BAUD_RATE) >> SAMPLE_SPACING_SHIFT) < MIN_SAMPLE_SPACING
+#error "SOFTWARESERIAL_BAUD_RATE is too fast for the software receiver"
+#endif
+#endif
+
+typedef enum RxState_enum {
+    rs_idle,
+    rs_waitingForStartBit,
+    rs_readingDataBits,
+    rs_waitingForStopBit
+} RxState;
+// state variables
+static volatile bool isEnabled;
+static volatile RxState rxState;
+static ByteQueueElement dataByte;
+static uint8_t bitMask;
+#if SOFTWARESERIALRX_OVERSAMPLE
+static uint8_t sampleNumber;        // within the bit
+static uint8_t highSamples;         // ...that were high
+static bool noiseSeen;              // in the current byte
+static uint16_t startEdgeTime;      // Timer 1 count
+static uint16_t startBitTime;       // to the first rising edge (0 if none)
+static uint16_t bitTime;            // CPU clocks, as measured
+static uint16_t sampleSpacing;
+static uint16_t lastSampleToNextBit;
+#endif
+static SoftwareSerialRx_Errors errors;
+ByteQueue_define(16, rxQueue);
+static SoftwareSerialRx_Notification notification;
+
+static bool rxBit (void)
+{
+    return (SERIAL_RX_INPORT & (1 << SERIAL_RX_PIN)) != 0;
+}
+
+#if SOFTWARESERIALRX_OVERSAMPLE
+static void setBitTime (
+    const uint16_t clocks)
+{
+    bitTime = clocks;
+    sampleSpacing = clocks >> SAMPLE_SPACING_SHIFT;
+    lastSampleToNextBit = clocks - ((SAMPLES_PER_BIT - 1) * sampleSpacing);
+}
+#endif
+
+// interrupts must be disabled when calling this
+static void listenForStartBit (void)
+{
+    TIMSK1 &= ~(1 << OCIE1A);   // disable timer compare match interrupt
+    rxState = rs_idle;
+    if (isEnabled) {
+        // re-enable pin change interrupt
+        PCMSK0 |= (1 << PCINT5);
+    }
+}
+
+#if SOFTWARESERIALRX_OVERSAMPLE
+// interrupts must be disabled when calling this
+static void measureBitTime (void)
+{
+    if ((startBitTime > (BIT_CLOCK_TIME - BIT_TIME_TOLERANCE)) &&
+        (startBitTime < (BIT_CLOCK_TIME + BIT_TIME_TOLERANCE))) {
+        // the first rising edge ended the start bit
+        setBitTime(bitTime +
+            (((int16_t)(startBitTime - bitTime)) >> BIT_TIME_FILTER_SHIFT));
+    }
+}
+#endif
+
+void SoftwareSerialRx_Initialize (void)
+{
+    // make rx pin an input and enable pullup
+    SERIAL_RX_DDR &= (~(1 << SERIAL_RX_PIN));
+    SERIAL_RX_PORT |= (1 << SERIAL_RX_PIN);
+
+    // set up timer1 to run free at the CPU clock
+    TCCR1A &= 0xFC;                 // set normal mode (WGM11:10)
+    TCCR1B &= 0xE7;                 // set normal mode (WGM13:12)
+    TCCR1B = (TCCR1B & 0xF8) | 1;   // no prescaling
+    TIFR1 = (1 << OCF1A);   // "clear" the timer compare flag
+                            // (|= would clear the others too)
+
+#if SOFTWARESERIALRX_OVERSAMPLE
+    setBitTime(BIT_CLOCK_TIME);
+#endif
+    // enable pin change interrupts
+    GIMSK |= (1 << PCIE0);
+
+    SoftwareSerialRx_enable();
+}
+
+void SoftwareSerialRx_enable (void)
+{
+    if (!isEnabled) {
+        rxState = rs_idle;
+        // set up pin change interrupt to detect start bit
+        PCMSK0 |= (1 << PCINT5);
+        isEnabled = true;
+    }
+}
+
+void SoftwareSerialRx_disable (void)
+{
+    if (isEnabled) {
+        TIMSK1 &= ~(1 << OCIE1A);   // disable timer compare match interrupt
+        PCMSK0 &= ~(1 << PCINT5);
+        isEnabled = false;
+    }
+}
+
+bool SoftwareSerialRx_isIdle (void)
+{
+    return rxState == rs_idle;
+}
+
+ByteQueue* SoftwareSerial_rxQueue (void)
+{
+    return &rxQueue;
+}
+
+void SoftwareSerialRx_setNotification (
+    SoftwareSerialRx_Notification notificationFunction)
+{
+    notification = notificationFunction;
+}
+
+void SoftwareSerialRx_takeErrors (
+    SoftwareSerialRx_Errors* rxErrors)
+{
+    char SREGSave;
+    SREGSave = SREG;
+    cli();
+    *rxErrors = errors;
+    memset(&errors, 0, sizeof(errors));
+    SREG = SREGSave;
+}
+
+uint16_t SoftwareSerialRx_bitTime (void)
+{
+#if !SOFTWARESERIALRX_OVERSAMPLE
+    return BIT_CLOCK_TIME;
+#else
+    char SREGSave;
+    SREGSave = SREG;
+    cli();
+    const uint16_t clocks = bitTime;
+    SREG = SREGSave;
+
+    return clocks;
+#endif
+}
+
+ISR(PCINT0_vect, ISR_BLOCK)
+{
+    const uint16_t edgeTime = TCNT1;
+
+    if (rxState == rs_idle) {
+        if (!rxBit()) {
+            TIFR1 = (1 << OCF1A);   // "clear" the timer compare flag
+            TIMSK1 |= (1 << OCIE1A);// enable timer compare match interrupt
+            rxState = rs_waitingForStartBit;
+#if SOFTWARESERIALRX_OVERSAMPLE
+            // set timer for the first of the start bit's samples
+            startEdgeTime = edgeTime;
+            OCR1A = edgeTime + ((bitTime / 2) - sampleSpacing - START_EDGE_LATENCY);
+
+            // this interrupt stays on to time the first rising edge
+            sampleNumber = 0;
+            highSamples = 0;
+            noiseSeen = false;
+            startBitTime = 0;
+        }
+    } else if (rxBit()) {
+        startBitTime = edgeTime - startEdgeTime;
+
+        // disable this interrupt
+        PCMSK0 &= ~(1 << PCINT5);
+    }
+#else
+            // set timer for the middle of the start bit
+            OCR1A = edgeTime + ((BIT_CLOCK_TIME / 2) - START_EDGE_LATENCY);
+
+            // disable this interrupt
+            PCMSK0 &= ~(1 << PCINT5);
+        }
+    }
+#endif
+}
+
+ISR(SIG_OUTPUT_COMPARE1A, ISR_BLOCK)
+{
+#if SOFTWARESERIALRX_OVERSAMPLE
+    if (rxBit()) {
+        ++highSamples;
+    }
+
+    if (++sampleNumber < SAMPLES_PER_BIT) {
+        // schedule the next sample
+        OCR1A += sampleSpacing;
+        return;
+    }
+
+    // schedule the next bit's first sample
+    OCR1A += lastSampleToNextBit;
+
+    const bool bitIsHigh = (highSamples >= MAJORITY_HIGH);
+    if ((highSamples != 0) && (highSamples != SAMPLES_PER_BIT)) {
+        noiseSeen = true;
+    }
+    sampleNumber = 0;
+    highSamples = 0;
+#else
+    // schedule the next bit's sample
+    OCR1A += BIT_CLOCK_TIME;
+
+    const bool bitIsHigh = rxBit();
+#endif
+
+    switch (rxState) {
+        case rs_waitingForStartBit :
+            if (!bitIsHigh) {
+                // rx bit is low - got start bit
+                dataByte = 0;
+                bitMask = 1;
+                rxState = rs_readingDataBits;
+            } else {
+                // expected low for start bit but didn't get it
+                ++errors.noisyBytes;
+                listenForStartBit();
+            }
+            break;
+        case rs_readingDataBits :
+            if (bitIsHigh) {
+                dataByte |= bitMask;
+            }
+            if (bitMask == 0x80) {
+                rxState = rs_waitingForStopBit;
+            } else {
+                bitMask <<= 1;
+            }
+            break;
+        case rs_waitingForStopBit :
+            if (bitIsHigh) {
+                // got stop bit.
+                if (ByteQueue_push(dataByte, &rxQueue)) {
+                    if (notification != NULL) {
+                        notification();
+                    }
+                } else {
+                    ++errors.overruns;
+                }
+            } else {
+                ++errors.framingErrors;
+            }
+#if SOFTWARESERIALRX_OVERSAMPLE
+            if (noiseSeen) {
+                ++errors.noisyBytes;
+            }
+            measureBitTime();
+#endif
+            listenForStartBit();
+            break;
+        default :
+            break;
+    }
+}
+
+#endif  // !SOFTWARESERIAL_USI
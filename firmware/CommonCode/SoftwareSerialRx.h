@@ -1,37 +1,76 @@
-//
-//  Software Serial - Receiver
-//
-//  What it does:
-//      Software implementation of UART Receiver
-//      Currently hardcoded to listen for 8N1 on pin B6 at 300 baud
-//      Has a 32-byte queue.
-//
-//  How to use it:
-//     Call SoftwareSerialRx_Initialize() once at the beginning of the
-//     program (upon powerup).
-//     During the program you can get the byte queue using
-//     SoftwareSerial_rxQueue() to check for and read incoming bytes.
-//
-//  Hardware resources used:
-//    Serial data in - PA5
-//    AtTiny84 16-bit Timer 1
-//
-#ifndef SOFTWARESERIALRX_H
-#define SOFTWARESERIALRX_H
-
-#include <stdint.h>
-#include <stdbool.h>
-#include <string.h>
-#include <stddef.h>
-#include "ByteQueue.h"
-
-// comes up enabled by default
-extern void SoftwareSerialRx_Initialize (void);
-
-extern void SoftwareSerialRx_enable (void);
-extern void SoftwareSerialRx_disable (void);
-
-extern ByteQueue* SoftwareSerial_rxQueue (void);
-
-#endif  /* SOFTWARESERIALRX_H */
-
+//
+//  Software Serial - Receiver
+//
+//  What it does:
+//      Software implementation of UART Receiver
+//      Currently hardcoded to listen for 8N1 on pin B6 at
+//      SOFTWARESERIAL_BAUD_RATE (see SoftwareSerialTx.h)
+//      Has a 32-byte queue.
+//      Counts the bytes it drops or doubts, to tell a bad line from
+//      a slow reader
+//
+//  How to use it:
+//     Call SoftwareSerialRx_Initialize() once at the beginning of the
+//     program (upon powerup).
+//     During the program you can get the byte queue using
+//     SoftwareSerial_rxQueue() to check for and read incoming bytes.
+//
+//  Hardware resources used (see SoftwareSerialTx.h for the USI port):
+//    Serial data in - PA5
+//    AtTiny84 16-bit Timer 1 (free-running at the CPU clock, so it
+//    can also be read as a timestamp)
+//
+#ifndef SOFTWARESERIALRX_H
+#define SOFTWARESERIALRX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include "ByteQueue.h"
+
+// sample each bit three times and take the bit time from the start
+// bits (see SoftwareSerialRx.c). It doesn't fit in the flash with the
+// rest of the firmware, so it is only built on request. Without it
+// each bit is sampled once, in its middle, at the nominal bit time
+#ifndef SOFTWARESERIALRX_OVERSAMPLE
+#define SOFTWARESERIALRX_OVERSAMPLE false
+#endif
+
+// comes up enabled by default
+extern void SoftwareSerialRx_Initialize (void);
+
+extern void SoftwareSerialRx_enable (void);
+extern void SoftwareSerialRx_disable (void);
+
+// true unless a byte is coming in
+extern bool SoftwareSerialRx_isIdle (void);
+
+extern ByteQueue* SoftwareSerial_rxQueue (void);
+
+// prototype for a function that is told when a byte has been put in
+// the queue. It is called from an interrupt handler
+typedef void (*SoftwareSerialRx_Notification)(void);
+
+extern void SoftwareSerialRx_setNotification (
+    SoftwareSerialRx_Notification notificationFunction);
+
+typedef struct {
+    uint16_t framingErrors;     // dropped for a low stop bit
+    uint16_t noisyBytes;        // a start bit didn't hold, or (with
+                                // SOFTWARESERIALRX_OVERSAMPLE) the
+                                // samples of a bit disagreed
+    uint16_t overruns;          // dropped because the queue was full
+} SoftwareSerialRx_Errors;
+
+// the counts since power-up or the last call, which clears them
+extern void SoftwareSerialRx_takeErrors (
+    SoftwareSerialRx_Errors* rxErrors);
+
+// bit time the receiver is using, in CPU clocks. With
+// SOFTWARESERIALRX_OVERSAMPLE it is measured from the incoming start
+// bits, so it shows how far the two clocks are apart
+extern uint16_t SoftwareSerialRx_bitTime (void);
+
+#endif  /* SOFTWARESERIALRX_H */
+
@@ -1,144 +1,173 @@
-//
-//  Software Serial Transmit
-//
-//   Uses SystemTime tick as clock.
-//
-//  Pin usage:
-//      PA6 - serial data out (MOSI)
-//
-
-#include "SoftwareSerialTx.h"
-
-#include <avr/io.h>
-#include "ByteQueue.h"
-#include "../SystemTime.h"
-
-#define SERIAL_TX_DDR      DDRA
-#define SERIAL_TX_PORT     PORTA
-#define SERIAL_TX_PIN      PA6
-
-typedef enum TxState_enum {
-    ts_idle,
-    ts_sendingDataBits,
-    ts_sendingStopBit
-} TxState;
-// state variables
-static bool isEnabled;
-static SystemTime_tick lastTick;
-static TxState txState = ts_idle;
-static ByteQueueElement dataByte;
-static uint8_t bitNumber;
-ByteQueue_define(70, txQueue);
-
-static void setTxBit (
-    const uint8_t bit)
-{
-    if (bit != 0) {
-        SERIAL_TX_PORT |= (1 << SERIAL_TX_PIN);
-    } else {
-        SERIAL_TX_PORT &= ~(1 << SERIAL_TX_PIN);
-    }
-}
-
-static void systemTimeTickTask (void)
-{
-    switch (txState) {
-    case ts_idle:
-        if (!ByteQueue_is_empty(&txQueue)) {
-            // issue start bit
-            setTxBit(0);
-            dataByte = ByteQueue_pop(&txQueue);
-            bitNumber = 1;
-            txState = ts_sendingDataBits;
-        }
-        break;
-    case ts_sendingDataBits:
-        setTxBit(dataByte & 1);
-        if (bitNumber == 8) {
-            txState = ts_sendingStopBit;
-        } else {
-            ++bitNumber;
-            dataByte >>= 1;
-        }
-        break;
-    case ts_sendingStopBit:
-        setTxBit(1);
-        txState = ts_idle;
-        break;
-    }
-}
-
-void SoftwareSerialTx_Initialize (void)
-{
-    // set serial tx as output
-    SERIAL_TX_DDR      |= (1 << SERIAL_TX_PIN);
-
-    isEnabled = false;
-    lastTick = 0;
-    txState = ts_idle;
-
-    SystemTime_registerForTickNotification(systemTimeTickTask);
-}
-
-void SoftwareSerialTx_enable (void)
-{
-    isEnabled = true;
-}
-
-void SoftwareSerialTx_disable (void)
-{
-    isEnabled = false;
-}
-
-bool SoftwareSerialTx_isIdle (void)
-{
-    return ((txState == ts_idle) && ByteQueue_is_empty(&txQueue));
-}
-
-void SoftwareSerialTx_send (
-    const char* text)
-{
-    if (isEnabled) {
-        const char* cp = text;
-        char ch;
-        while ((ch = *cp++) != 0) {
-            ByteQueue_push((ByteQueueElement)ch, &txQueue);
-        }
-    }
-}
-
-bool SoftwareSerialTx_sendP (
-   PGM_P string)
-{
-    bool successful = false;
-
-    if (isEnabled) {
-        // check if there is enough space left in the tx queue
-        if (strlen_P(string) <= ByteQueue_spaceRemaining(&txQueue))
-            {  // there is enough space in the queue
-            // push all bytes onto the queue
-            PGM_P cp = string;
-            char ch = 0;
-            do {
-                ch = pgm_read_byte(cp);
-                ++cp;
-                if (ch != 0) {
-                    ByteQueue_push(ch, &txQueue);
-                }
-            } while (ch != 0);
-
-            successful = true;
-        }
-    }
-
-   return successful;
-}
-
-void SoftwareSerialTx_sendChar (
-    const char ch)
-{
-    if (isEnabled) {
-        ByteQueue_push((ByteQueueElement)ch, &txQueue);
-    }
-}
-
+//
+//  Software Serial Transmit
+//
+//   Uses AtTiny84 16-bit Timer 1 compare B as the bit clock.
+//
+//  Pin usage:
+//      PA6 - serial data out (MOSI)
+//
+//  How it works:
+//    Timer 1 runs free (see SoftwareSerialRx.c). Queueing a byte starts
+//    the compare B interrupt if it isn't running, and each interrupt
+//    sets the next bit on the pin and schedules the one after by
+//    advancing the compare register a bit time. The interrupt stops
+//    itself once the last stop bit has gone out and the queue is empty.
+//
+
+#include "SoftwareSerialTx.h"
+
+// otherwise USISerial.c takes the port's place
+#if !SOFTWARESERIAL_USI
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <string.h>
+#include "ByteQueue.h"
+
+#define SERIAL_TX_DDR      DDRA
+#define SERIAL_TX_PORT     PORTA
+#define SERIAL_TX_PIN      PA6
+
+// timer 1 counts at the CPU clock
+#define BIT_CLOCK_TIME ((uint16_t)(F_CPU / SOFTWARESERIAL_BAUD_RATE))
+// CPU clocks from queueing the first byte to its start bit, enough to
+// get the compare value ahead of the timer
+#define START_CLOCKS 64
+
+// the stop bit, and the start bit below the data bits
+#define FRAME_STOP_BIT (1 << 9)
+
+// state variables
+static bool isEnabled;
+// the bits of the byte on the line that are still to go, lowest first.
+// 0 once the stop bit has gone out
+static uint16_t frameBits;
+ByteQueue_define(70, txQueue);
+
+static void setTxBit (
+    const uint8_t bit)
+{
+    if (bit != 0) {
+        SERIAL_TX_PORT |= (1 << SERIAL_TX_PIN);
+    } else {
+        SERIAL_TX_PORT &= ~(1 << SERIAL_TX_PIN);
+    }
+}
+
+// starts the bit clock, unless it is running
+static void startBitClock (void)
+{
+    char SREGSave;
+    SREGSave = SREG;
+    cli();
+    if ((TIMSK1 & (1 << OCIE1B)) == 0) {
+        OCR1B = TCNT1 + START_CLOCKS;
+        TIFR1 = (1 << OCF1B);   // "clear" the timer compare flag
+        TIMSK1 |= (1 << OCIE1B);// enable timer compare match interrupt
+    }
+    SREG = SREGSave;
+}
+
+ISR(SIG_OUTPUT_COMPARE1B, ISR_BLOCK)
+{
+    // schedule the next bit time
+    OCR1B += BIT_CLOCK_TIME;
+
+    if (frameBits == 0) {
+        // the stop bit has had its bit time
+        if (ByteQueue_is_empty(&txQueue)) {
+            TIMSK1 &= ~(1 << OCIE1B);
+            return;
+        }
+        frameBits = ((uint16_t)ByteQueue_pop(&txQueue) << 1) | FRAME_STOP_BIT;
+    }
+    setTxBit(frameBits & 1);
+    frameBits >>= 1;
+}
+
+void SoftwareSerialTx_Initialize (void)
+{
+    // set serial tx as output, idling high (mark) so the first start
+    // bit is an edge the receiver can see
+    SERIAL_TX_PORT     |= (1 << SERIAL_TX_PIN);
+    SERIAL_TX_DDR      |= (1 << SERIAL_TX_PIN);
+
+    isEnabled = false;
+    frameBits = 0;
+
+    // set up timer1 to run free at the CPU clock
+    TCCR1A &= 0xFC;                 // set normal mode (WGM11:10)
+    TCCR1B &= 0xE7;                 // set normal mode (WGM13:12)
+    TCCR1B = (TCCR1B & 0xF8) | 1;   // no prescaling
+}
+
+void SoftwareSerialTx_enable (void)
+{
+    isEnabled = true;
+}
+
+void SoftwareSerialTx_disable (void)
+{
+    isEnabled = false;
+}
+
+// idle only once the last stop bit has had its whole bit time, which
+// is when the bit clock stops
+bool SoftwareSerialTx_isIdle (void)
+{
+    return ((TIMSK1 & (1 << OCIE1B)) == 0) && ByteQueue_is_empty(&txQueue);
+}
+
+void SoftwareSerialTx_send (
+    const char* text)
+{
+    SoftwareSerialTx_sendBytes((const uint8_t*)text, strlen(text));
+}
+
+// queues all of the bytes, from flash or RAM, or none of them if they
+// don't fit
+static bool queueBytes (
+    const uint8_t* bytes,
+    const uint16_t length,
+    const bool inFlash)
+{
+    bool successful = false;
+
+    if (isEnabled) {
+        // all of them or none of them
+        if (length <= ByteQueue_spaceRemaining(&txQueue)) {
+            for (uint8_t b = 0; b < length; ++b) {
+                ByteQueue_push(inFlash ? pgm_read_byte(&bytes[b]) : bytes[b],
+                    &txQueue);
+            }
+            startBitClock();
+            successful = true;
+        }
+    }
+
+    return successful;
+}
+
+bool SoftwareSerialTx_sendP (
+   PGM_P string)
+{
+    return queueBytes((const uint8_t*)string, strlen_P(string), true);
+}
+
+bool SoftwareSerialTx_sendBytes (
+    const uint8_t* bytes,
+    const uint8_t length)
+{
+    return queueBytes(bytes, length, false);
+}
+
+void SoftwareSerialTx_sendChar (
+    const char ch)
+{
+    if (isEnabled) {
+        ByteQueue_push((ByteQueueElement)ch, &txQueue);
+        startBitClock();
+    }
+}
+
+#endif  // !SOFTWARESERIAL_USI
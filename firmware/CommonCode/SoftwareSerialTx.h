@@ -1,32 +1,58 @@
-//
-//  Software Serial Transmit
-//
-//  Software implementation of UART
-//
-#ifndef SOFTWARESERIALTX_H
-#define SOFTWARESERIALTX_H
-
-#include <stdint.h>
-#include <stdbool.h>
-#include <string.h>
-#include <stddef.h>
-#include <avr/pgmspace.h>
-
-extern void SoftwareSerialTx_Initialize (void);
-
-extern void SoftwareSerialTx_enable (void);
-extern void SoftwareSerialTx_disable (void);
-
-extern bool SoftwareSerialTx_isIdle (void);
-
-extern void SoftwareSerialTx_send (
-    const char* text);
-
-extern bool SoftwareSerialTx_sendP (
-   PGM_P string);
-
-extern void SoftwareSerialTx_sendChar (
-    const char ch);
-
-#endif  /* SOFTWARESERIALTX_H */
-
+//
+//  Software Serial Transmit
+//
+//  Software implementation of UART
+//
+#ifndef SOFTWARESERIALTX_H
+#define SOFTWARESERIALTX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include <avr/pgmspace.h>
+
+// when true, the serial port is run by the USI, clocked by Timer 0,
+// at SOFTWARESERIAL_BAUD_RATE (see USISerial.c) instead of a bit at a
+// time in software. The USI's data pins are the other way around from
+// the software port's (data out on PA5, data in on PA6), so the board
+// has to be wired for it
+#ifndef SOFTWARESERIAL_USI
+#define SOFTWARESERIAL_USI false
+#endif
+
+// the software port's bit times are scheduled on Timer 1, and it
+// runs at up to 1200 baud (the receiver takes three samples a bit)
+#ifndef SOFTWARESERIAL_BAUD_RATE
+#if SOFTWARESERIAL_USI
+#define SOFTWARESERIAL_BAUD_RATE 9600
+#else
+#define SOFTWARESERIAL_BAUD_RATE 300
+#endif
+#endif
+
+extern void SoftwareSerialTx_Initialize (void);
+
+extern void SoftwareSerialTx_enable (void);
+extern void SoftwareSerialTx_disable (void);
+
+extern bool SoftwareSerialTx_isIdle (void);
+
+// queues all of the text, or none of it if it doesn't fit
+extern void SoftwareSerialTx_send (
+    const char* text);
+
+extern bool SoftwareSerialTx_sendP (
+   PGM_P string);
+
+// queues all of the bytes, or none of them if they don't fit.
+// returns true if they were queued
+extern bool SoftwareSerialTx_sendBytes (
+    const uint8_t* bytes,
+    const uint8_t length);
+
+extern void SoftwareSerialTx_sendChar (
+    const char ch);
+
+#endif  /* SOFTWARESERIALTX_H */
+
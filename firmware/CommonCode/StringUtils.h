@@ -1,28 +1,39 @@
-//
-//  String Utilities
-//
-//  Utility functions for operating on strings, with overrun protection
-//
-#ifndef StringUtils_H
-#define StringUtils_H
-
-#include <stdint.h>
-#include <stdbool.h>
-#include <string.h>
-#include <stddef.h>
-#include <avr/pgmspace.h>
-#include "CharString.h"
-
-// scans for " and then puts everything up to the next " in
-// quotedString. returns the updated source ptr
-extern const char* StringUtils_scanQuotedString (
-    const char* sourcePtr,
-    CharString_t* quotedString);
-
-// sets destStr to the decimal string for the given value
-extern void StringUtils_appendDecimal (
-    const int16_t value,
-    const uint8_t numDecimalDigits,
-    CharString_t* destStr);
-
+//
+//  String Utilities
+//
+//  Utility functions for operating on strings, with overrun protection
+//
+#ifndef StringUtils_H
+#define StringUtils_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include <avr/pgmspace.h>
+#include "CharString.h"
+
+// scans for " and then puts everything up to the next " in
+// quotedString. returns the updated source ptr
+extern const char* StringUtils_scanQuotedString (
+    const char* sourcePtr,
+    CharString_t* quotedString);
+
+// sets destStr to the decimal string for the given value, with up to
+// 4 digits after the point
+extern void StringUtils_appendDecimal (
+    const int16_t value,
+    const uint8_t numDecimalDigits,
+    CharString_t* destStr);
+
+// appends the decimal string for the given unsigned value
+extern void StringUtils_appendUnsigned (
+    const uint16_t value,
+    CharString_t* destStr);
+
+// appends the decimal string for the given 32-bit value (no decimal point)
+extern void StringUtils_appendDecimal32 (
+    const int32_t value,
+    CharString_t* destStr);
+
 #endif  // StringUtils_H
\ No newline at end of file
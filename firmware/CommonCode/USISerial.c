@@ -0,0 +1,440 @@
+//
+//  USI Serial
+//
+//  Half-duplex UART on the AtTiny84's Universal Serial Interface. When
+//  SOFTWARESERIAL_USI is true (see SoftwareSerialTx.h) it takes the
+//  place of SoftwareSerialTx.c and SoftwareSerialRx.c, with the same
+//  interface
+//
+//  Pin usage:
+//      PA5 (DO) - serial data out
+//      PA6 (DI) - serial data in
+//
+//  Uses the USI and 8-bit Timer 0. The SystemTime tick moves to Timer 1
+//  to make way for it
+//
+//  How it works:
+//      The USI runs in three-wire mode, clocked by Timer 0 compare
+//      match. Timer 0 runs in CTC mode with a period of one bit, so the
+//      USI shifts a bit out on DO (the top bit of its data register)
+//      and a bit in from DI once a bit time, and its 4-bit counter
+//      raises the overflow interrupt after the number of bits it was
+//      preset for. The hardware times the bits, and the interrupt only
+//      has to come within a bit time to set up the next ones. The USI
+//      shifts the most significant bit first and the line sends the
+//      least significant first, so bytes are bit reversed on the way
+//      in and out.
+//
+//      There is only one shift register, so the port either sends or
+//      receives. Receiving comes first: the console is command and
+//      response, and a transmission only starts (from the SystemTime
+//      tick) once the line has been quiet for QUIET_TICKS, so it won't
+//      cut into a command that is coming in. Bytes that arrive while
+//      the port is sending are lost.
+//
+//      Receiving: a pin change interrupt on DI catches the start bit's
+//      falling edge. It starts Timer 0 so that the first compare match
+//      is in the middle of the start bit, allowing for the time it
+//      took to get into the interrupt, and the USI takes nine bits,
+//      the start bit and the eight data bits. The overflow interrupt
+//      keeps the data bits, lets the USI take one more, the stop bit,
+//      and already listens for the next start bit: back to back bytes
+//      leave only half a bit time after the middle of the stop bit.
+//      The second overflow, in the middle of the stop bit, queues the
+//      byte if the stop bit is high and stops the USI and Timer 0. If
+//      the next start bit's interrupt gets in first it does that
+//      itself before starting on the next byte. DO is an input while
+//      receiving (its pull-up holds the line high) so the bits passing
+//      through the register don't go out on it. Framing errors and
+//      overruns are counted as in SoftwareSerialRx.c. Each bit is
+//      sampled once, so there is no noise count, and the bit time is
+//      the nominal one.
+//
+//      Sending: a byte is loaded with the start bit at the top of the
+//      data register and data bits 0 to 6 behind it, and Timer 0 is
+//      restarted so the start bit gets a whole bit time. The overflow
+//      after 7 shifts comes as bit 6 goes out. The interrupt reloads the
+//      register with bit 6 on top (so DO doesn't change), then bit 7,
+//      the stop bit, and 1s. The overflow after 3 more shifts comes at
+//      the end of the stop bit, and either loads the next byte the same
+//      way or stops the USI, which leaves DO at its port level, high.
+//
+
+#include "SoftwareSerialTx.h"
+#include "SoftwareSerialRx.h"
+
+#if SOFTWARESERIAL_USI
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "ByteQueue.h"
+#include "../SystemTime.h"
+
+#define SERIAL_DDR      DDRA
+#define SERIAL_PORT     PORTA
+#define SERIAL_INPORT   PINA
+#define SERIAL_TX_PIN   PA5     // DO
+#define SERIAL_RX_PIN   PA6     // DI
+#define SERIAL_RX_PCINT PCINT6
+
+// starting transmissions takes the tick hook slot that the software
+// port uses for bit clocking
+#define TICK_HOOK_PRIORITY 0
+// ticks the line has to be quiet before sending
+#define QUIET_TICKS 2
+
+// Timer 0 counts bit times at the CPU clock, or at 1/8 of it for
+// slower baud rates
+#if (F_CPU / SOFTWARESERIAL_BAUD_RATE) <= 256
+#define TIMER0_PRESCALE 1
+#define TIMER0_CLOCK_SELECT 1
+#else
+#define TIMER0_PRESCALE 8
+#define TIMER0_CLOCK_SELECT 2
+#endif
+#define TIMER0_STOPPED 0
+#define BIT_COUNTS ((uint8_t)(((F_CPU / TIMER0_PRESCALE) + \
+    (SOFTWARESERIAL_BAUD_RATE / 2)) / SOFTWARESERIAL_BAUD_RATE))
+// CPU clocks from the start bit's edge until the pin change interrupt
+// starts Timer 0
+#define START_BIT_LATENCY 30
+// Timer 0 count that puts the first compare match in the middle of
+// the start bit
+#define START_BIT_COUNT (BIT_COUNTS - \
+    ((BIT_COUNTS / 2) - (START_BIT_LATENCY / TIMER0_PRESCALE)))
+
+// USI control: three-wire mode, clocked by Timer 0 compare match,
+// with the counter overflow interrupt
+#define USI_OFF 0
+#define USI_ON ((1 << USIWM0) | (1 << USICS0) | (1 << USIOIE))
+// USI status: clears the overflow flag, and presets the counter to
+// overflow after <n> more bits
+#define USI_BITS(n) ((1 << USIOIF) | (16 - (n)))
+
+// bits in each part of a frame (see above)
+#define RX_FIRST_BITS 9
+#define RX_LAST_BITS 1
+#define TX_FIRST_BITS 7
+#define TX_LAST_BITS 3
+
+typedef enum UsiState_enum {
+    us_idle,
+    us_receivingData,
+    us_receivingStopBit,
+    us_sendingFirstBits,
+    us_sendingLastBits
+} UsiState;
+
+// nibbles with their bits in the opposite order
+static const uint8_t reversedNibbles[16] PROGMEM = {
+    0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+    0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF
+};
+
+// state variables
+static bool isTxEnabled;
+static volatile bool isRxEnabled;
+static volatile UsiState usiState = us_idle;
+static uint8_t quietTicks;
+static uint8_t txByte;          // bit reversed
+static uint8_t rxByte;
+static SoftwareSerialRx_Errors errors;
+ByteQueue_define(70, txQueue);
+ByteQueue_define(16, rxQueue);
+static SoftwareSerialRx_Notification notification;
+
+static uint8_t reverseBits (
+    const uint8_t byte)
+{
+    return (pgm_read_byte_near(&reversedNibbles[byte & 0x0F]) << 4) |
+        pgm_read_byte_near(&reversedNibbles[byte >> 4]);
+}
+
+static bool rxBit (void)
+{
+    return (SERIAL_INPORT & (1 << SERIAL_RX_PIN)) != 0;
+}
+
+// interrupts must be disabled when calling this
+static void stopUSI (void)
+{
+    USICR = USI_OFF;
+    TCCR0B = TIMER0_STOPPED;
+}
+
+// interrupts must be disabled when calling this
+static void listenForStartBit (void)
+{
+    usiState = us_idle;
+    if (isRxEnabled) {
+        GIFR = (1 << PCIF0);    // forget edges from while we were busy
+        PCMSK0 |= (1 << SERIAL_RX_PCINT);
+    }
+}
+
+// interrupts must be disabled when calling this
+static void sendByte (
+    const uint8_t byte)
+{
+    txByte = reverseBits(byte);
+    TCCR0B = TIMER0_STOPPED;
+    TCNT0 = 0;
+    USIDR = txByte >> 1;        // start bit, then data bits 0-6
+    USISR = USI_BITS(TX_FIRST_BITS);
+    USICR = USI_ON;
+    TCCR0B = TIMER0_CLOCK_SELECT;
+    usiState = us_sendingFirstBits;
+}
+
+static void systemTimeTickTask (void)
+{
+    if (usiState == us_idle) {
+        if (quietTicks < QUIET_TICKS) {
+            ++quietTicks;
+        } else if (!ByteQueue_is_empty(&txQueue) && rxBit()) {
+            // (a low line is a start bit that the pin change
+            // interrupt hasn't seen yet)
+            PCMSK0 &= ~(1 << SERIAL_RX_PCINT);
+            sendByte(ByteQueue_pop(&txQueue));
+        }
+    }
+}
+
+void SoftwareSerialTx_Initialize (void)
+{
+    // set serial tx as output, idling high (mark)
+    SERIAL_PORT |= (1 << SERIAL_TX_PIN);
+    SERIAL_DDR |= (1 << SERIAL_TX_PIN);
+
+    isTxEnabled = false;
+    quietTicks = 0;
+    usiState = us_idle;
+
+    // set up timer0 to count bit times in CTC mode, stopped until
+    // the USI needs it
+    TCCR0B = TIMER0_STOPPED;
+    TCCR0A = (TCCR0A & 0xFC) | 2;   // set CTC mode
+    OCR0A = BIT_COUNTS - 1;
+    USICR = USI_OFF;
+
+    SystemTime_registerTickHook(systemTimeTickTask, TICK_HOOK_PRIORITY, 1);
+}
+
+void SoftwareSerialTx_enable (void)
+{
+    isTxEnabled = true;
+}
+
+void SoftwareSerialTx_disable (void)
+{
+    isTxEnabled = false;
+}
+
+bool SoftwareSerialTx_isIdle (void)
+{
+    const UsiState state = usiState;
+    return (state != us_sendingFirstBits) &&
+        (state != us_sendingLastBits) &&
+        ByteQueue_is_empty(&txQueue);
+}
+
+void SoftwareSerialTx_send (
+    const char* text)
+{
+    SoftwareSerialTx_sendBytes((const uint8_t*)text, strlen(text));
+}
+
+bool SoftwareSerialTx_sendP (
+   PGM_P string)
+{
+    bool successful = false;
+
+    if (isTxEnabled) {
+        // check if there is enough space left in the tx queue
+        if (strlen_P(string) <= ByteQueue_spaceRemaining(&txQueue)) {
+            PGM_P cp = string;
+            char ch;
+            while ((ch = pgm_read_byte(cp++)) != 0) {
+                ByteQueue_push(ch, &txQueue);
+            }
+            successful = true;
+        }
+    }
+
+    return successful;
+}
+
+bool SoftwareSerialTx_sendBytes (
+    const uint8_t* bytes,
+    const uint8_t length)
+{
+    bool successful = false;
+
+    if (isTxEnabled) {
+        // all of them or none of them
+        if (length <= ByteQueue_spaceRemaining(&txQueue)) {
+            for (uint8_t b = 0; b < length; ++b) {
+                ByteQueue_push(bytes[b], &txQueue);
+            }
+            successful = true;
+        }
+    }
+
+    return successful;
+}
+
+void SoftwareSerialTx_sendChar (
+    const char ch)
+{
+    if (isTxEnabled) {
+        ByteQueue_push((ByteQueueElement)ch, &txQueue);
+    }
+}
+
+void SoftwareSerialRx_Initialize (void)
+{
+    // make rx pin an input and enable pullup
+    SERIAL_DDR &= ~(1 << SERIAL_RX_PIN);
+    SERIAL_PORT |= (1 << SERIAL_RX_PIN);
+
+    // enable pin change interrupts
+    GIMSK |= (1 << PCIE0);
+
+    SoftwareSerialRx_enable();
+}
+
+void SoftwareSerialRx_enable (void)
+{
+    if (!isRxEnabled) {
+        isRxEnabled = true;
+        char SREGSave;
+        SREGSave = SREG;
+        cli();
+        if (usiState == us_idle) {
+            listenForStartBit();
+        }
+        SREG = SREGSave;
+    }
+}
+
+void SoftwareSerialRx_disable (void)
+{
+    if (isRxEnabled) {
+        // a byte that is coming in is finished
+        PCMSK0 &= ~(1 << SERIAL_RX_PCINT);
+        isRxEnabled = false;
+    }
+}
+
+bool SoftwareSerialRx_isIdle (void)
+{
+    const UsiState state = usiState;
+    return (state != us_receivingData) && (state != us_receivingStopBit);
+}
+
+ByteQueue* SoftwareSerial_rxQueue (void)
+{
+    return &rxQueue;
+}
+
+void SoftwareSerialRx_setNotification (
+    SoftwareSerialRx_Notification notificationFunction)
+{
+    notification = notificationFunction;
+}
+
+void SoftwareSerialRx_takeErrors (
+    SoftwareSerialRx_Errors* rxErrors)
+{
+    char SREGSave;
+    SREGSave = SREG;
+    cli();
+    *rxErrors = errors;
+    memset(&errors, 0, sizeof(errors));
+    SREG = SREGSave;
+}
+
+uint16_t SoftwareSerialRx_bitTime (void)
+{
+    return (uint16_t)BIT_COUNTS * TIMER0_PRESCALE;
+}
+
+// interrupts must be disabled when calling this
+static void receiveStopBit (void)
+{
+    stopUSI();
+    SERIAL_DDR |= (1 << SERIAL_TX_PIN);
+    if ((USIBR & 1) != 0) {
+        // got stop bit
+        if (ByteQueue_push(rxByte, &rxQueue)) {
+            if (notification != NULL) {
+                notification();
+            }
+        } else {
+            ++errors.overruns;
+        }
+    } else {
+        ++errors.framingErrors;
+    }
+    quietTicks = 0;
+    usiState = us_idle;
+}
+
+ISR(PCINT0_vect, ISR_BLOCK)
+{
+    if ((usiState == us_receivingStopBit) && !rxBit()) {
+        // the next start bit came before the last stop bit's overflow
+        // interrupt
+        receiveStopBit();
+    }
+    if ((usiState == us_idle) && !rxBit()) {
+        TCNT0 = START_BIT_COUNT;
+        TCCR0B = TIMER0_CLOCK_SELECT;
+        // keep the register's bits off the tx line
+        SERIAL_DDR &= ~(1 << SERIAL_TX_PIN);
+        USISR = USI_BITS(RX_FIRST_BITS);
+        USICR = USI_ON;
+
+        // disable this interrupt
+        PCMSK0 &= ~(1 << SERIAL_RX_PCINT);
+        usiState = us_receivingData;
+        quietTicks = 0;
+    }
+}
+
+ISR(SIG_USI_OVERFLOW, ISR_BLOCK)
+{
+    switch (usiState) {
+        case us_receivingData :
+            // the start bit has been shifted out the top
+            rxByte = reverseBits(USIBR);
+            USISR = USI_BITS(RX_LAST_BITS);
+            usiState = us_receivingStopBit;
+            if (isRxEnabled) {
+                // the line only falls again at the next start bit
+                PCMSK0 |= (1 << SERIAL_RX_PCINT);
+            }
+            break;
+        case us_receivingStopBit :
+            receiveStopBit();
+            break;
+        case us_sendingFirstBits :
+            // bit 6 (going out now), bit 7, then the stop bit
+            USIDR = (txByte << 6) | 0x3F;
+            USISR = USI_BITS(TX_LAST_BITS);
+            usiState = us_sendingLastBits;
+            break;
+        case us_sendingLastBits :
+            if (!ByteQueue_is_empty(&txQueue)) {
+                sendByte(ByteQueue_pop(&txQueue));
+            } else {
+                stopUSI();
+                listenForStartBit();
+            }
+            break;
+        default :
+            break;
+    }
+}
+
+#endif  // SOFTWARESERIAL_USI
@@ -1,12 +1,12 @@
-//
-// boolean data type
-//
-#ifndef BOOLTYPE_LOADED
-#define BOOLTYPE_LOADED
-
-typedef enum {
-   false,
-   true
-   } Bool;
-
-#endif   // BOOLTYPE_LOADED
+//
+// boolean data type
+//
+#ifndef BOOLTYPE_LOADED
+#define BOOLTYPE_LOADED
+
+typedef enum {
+   false,
+   true
+   } Bool;
+
+#endif   // BOOLTYPE_LOADED
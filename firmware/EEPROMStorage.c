@@ -1,32 +1,53 @@
-//
-// EEPROM Storage
-//
-
-#include "EEPROMStorage.h"
-#include "SystemMode.h"
-
-void EEPROMStorage_Initialize (void)
-{
-    // check if EE has been initialized
-    const uint8_t initFlag = EEPROM_read(0);
-    const uint8_t initLevel = (initFlag == 0xFF) ? 0 : initFlag;
-
-    if (initLevel < 1) {
-        // EE has not been initialized. Initialize to default settings now.
-
-        EEPROMStorage_setDeviceId(0);       // undefined device id
-        EEPROMStorage_setMode(m_switch);    // get mode from mode switch
-        EEPROMStorage_setEcho(false);       // echo off
-        EEPROMStorage_setDarkLevel(15);     // 15% or less is dark
-        EEPROMStorage_setAutoTime(30);      // stay on for 30 minutes
-                                            // when it comes on automatically
-        EEPROMStorage_setManualTime(360);   // stay on no more than 6 hours
-                                            // when turned on manually
-
-        EEPROMStorage_setTempCalOffset(-266);
-
-        // register that EEPROM is initialized
-        EEPROM_write(0, 1);
-    }
-}
-
+//
+// EEPROM Storage
+//
+
+#include "EEPROMStorage.h"
+#include "SystemMode.h"
+#include "BatteryMonitor.h"
+#include "InternalTemperatureMonitor.h"
+
+#include <avr/pgmspace.h>
+
+// a word's bytes, in the order EEPROM_writeWord stores them
+#define WORD_BYTES(word) ((uint8_t)(word)), ((uint8_t)((uint16_t)(word) >> 8))
+
+// the default settings, byte by byte from ADDR_ID
+static const uint8_t defaults[] PROGMEM = {
+    0,                  // undefined device id
+    m_switch,           // get mode from mode switch
+    false,              // echo off
+    15,                 // 15% or less is dark
+    WORD_BYTES(30),     // stay on for 30 minutes
+                        // when it comes on automatically
+    WORD_BYTES(360),    // stay on no more than 6 hours
+                        // when turned on manually
+    WORD_BYTES(INTERNALTEMPMONITOR_NOMINAL_OFFSET),
+    // level 2 (calibration gains) from here
+    WORD_BYTES(INTERNALTEMPMONITOR_NOMINAL_GAIN),
+    WORD_BYTES(BATTERYMONITOR_NOMINAL_OFFSET),
+    WORD_BYTES(BATTERYMONITOR_NOMINAL_GAIN)
+};
+// one default for each byte of the settings
+typedef char defaultsFit[(sizeof(defaults) ==
+    (ADDR_BATTERY_CAL_GAIN + LENGTH_BATTERY_CAL_GAIN - ADDR_ID)) ? 1 : -1];
+
+void EEPROMStorage_Initialize (void)
+{
+    // check if EE has been initialized
+    const uint8_t initFlag = EEPROM_read(0);
+    const uint8_t initLevel = (initFlag == 0xFF) ? 0 : initFlag;
+
+    if (initLevel < 2) {
+        // EE has not been initialized. Initialize to default settings
+        // now. If it is at level 1, only the calibration gains are
+        // missing (the temperature offset is already there)
+        uint8_t address = (initLevel < 1) ? ADDR_ID : ADDR_TEMP_CAL_GAIN;
+        for (; address < (ADDR_ID + sizeof(defaults)); ++address) {
+            EEPROM_write(address, pgm_read_byte_near(&defaults[address - ADDR_ID]));
+        }
+
+        // register that EEPROM is initialized
+        EEPROM_write(0, 2);
+    }
+}
@@ -1,96 +1,85 @@
-//
-//  Internal Temperature Monitor
-//
-//  Reads the AtTiny84's internal temperature sensor through the ADC
-//
-
-#include "InternalTemperatureMonitor.h"
-
-#include "ADCManager.h"
-#include "SystemTime.h"
-#include "DataHistory.h"
-#include "EEPROMStorage.h"
-
-#define SENSOR_ADC_CHANNEL 8
-
-#define REFERENCE_VOLTAGE 1.1
-
-// at 20 deg C we got 349 counts from the AtTiny84
-#define ESTIMATED_ZERO_C_COUNTS 286
-
-#define SENSOR_POWERUP_DELAY SYSTEMTIME_TICKS_PER_SECOND / 5
-#define SENSOR_SAMPLE_TIME SYSTEMTIME_TICKS_PER_SECOND / 10
-#define SENSOR_SAMPLES 10
-
-typedef enum {
-    tms_idle,
-    tms_waitingForADCStart,
-    tms_waitingForADCCompletion
-} TemperatureMonitor_state;
-
-static TemperatureMonitor_state tmState = tms_idle;
-static SystemTime_Timer sampleTimer;
-DataHistory_define(SENSOR_SAMPLES, temperatureHistory);
-
-void InternalTemperatureMonitor_Initialize (void)
-{
-    tmState = tms_idle;
-    // start sampling in 1/50 second (20ms, to let power stabilize)
-    SystemTime_startTimer(SYSTEMTIME_TICKS_PER_SECOND, &sampleTimer);
-    DataHistory_clear(&temperatureHistory);
-
-    // set up the ADC channel for measuring battery voltage
-    ADCManager_setupChannel(SENSOR_ADC_CHANNEL, ADC_REF_INTERNAL, false);
-}
-
-bool InternalTemperatureMonitor_haveValidSample (void)
-{
-    return DataHistory_length(&temperatureHistory) >= SENSOR_SAMPLES;
-}
-
-int16_t InternalTemperatureMonitor_currentTemperature (void)
-{
-    int16_t curTempC = 0;
-
-    uint16_t avgTemperature = 0;
-    if (DataHistory_length(&temperatureHistory) >= SENSOR_SAMPLES) {
-        uint16_t minTemmp;
-        uint16_t maxTemp;
-        DataHistory_getStatistics(
-            &temperatureHistory, SENSOR_SAMPLES,
-            &minTemmp, &maxTemp, &avgTemperature);
-
-        // counts to degrees C
-        curTempC = avgTemperature + EEPROMStorage_tempCalOffset;
-    }
-
-    return curTempC;
-}
-
-void InternalTemperatureMonitor_task (void)
-{
-    switch (tmState) {
-        case tms_idle :
-            if (SystemTime_timerHasExpired(&sampleTimer)) {
-                SystemTime_startTimer(SENSOR_SAMPLE_TIME, &sampleTimer);
-                tmState = tms_waitingForADCStart;
-            }
-            break;
-        case tms_waitingForADCStart :
-            if (ADCManager_StartConversion(SENSOR_ADC_CHANNEL)) {
-                // successfully started conversion
-                tmState = tms_waitingForADCCompletion;
-            }
-            break;    
-        case tms_waitingForADCCompletion : {
-            uint16_t temperature;
-            if (ADCManager_ConversionIsComplete(&temperature)) {
-                DataHistory_insertValue(temperature, &temperatureHistory);
-
-                tmState = tms_idle;
-            }
-            }
-            break;
-    }
-}
-
+//
+//  Internal Temperature Monitor
+//
+//  Reads the AtTiny84's internal temperature sensor through the ADC
+//
+
+#include "InternalTemperatureMonitor.h"
+
+#include "ADCManager.h"
+#include "TaskScheduler.h"
+#include "SystemTime.h"
+#include "IIRFilter.h"
+#include "CalibrationManager.h"
+
+#define SENSOR_ADC_CHANNEL 8
+
+#define REFERENCE_VOLTAGE 1.1
+
+// at 20 deg C we got 349 counts from the AtTiny84
+#define ESTIMATED_ZERO_C_COUNTS 286
+
+#define SENSOR_POWERUP_DELAY SYSTEMTIME_TICKS_PER_SECOND / 5
+#define SENSOR_SAMPLE_TIME SYSTEMTIME_TICKS_PER_SECOND / 10
+// the filter's time constant is 2^shift samples (0.8 seconds)
+#define SENSOR_FILTER_SHIFT 3
+// conversions to discard after the ADC switches to the sensor (and
+// the internal reference)
+#define SENSOR_SETTLE_CONVERSIONS 1
+
+static SystemTime_Timer powerupTimer;
+static uint8_t resultsTaken;
+IIRFilter_define(SENSOR_FILTER_SHIFT, temperatureFilter);
+
+// called from the ADC interrupt handler
+static void resultReady (void)
+{
+    TaskScheduler_wakeTask(InternalTemperatureMonitor_task);
+}
+
+void InternalTemperatureMonitor_Initialize (void)
+{
+    // ignore samples for the first second, to let power stabilize
+    SystemTime_startTimer(SYSTEMTIME_TICKS_PER_SECOND, &powerupTimer);
+    resultsTaken = 0;
+    temperatureFilter_clear();
+
+    // set up the ADC channel for measuring the temperature
+    ADCManager_setupChannel(SENSOR_ADC_CHANNEL, ADC_REF_INTERNAL,
+        ADCMANAGER_NOISE_REDUCTION,
+        SENSOR_SAMPLE_TIME, SENSOR_SETTLE_CONVERSIONS, resultReady);
+}
+
+bool InternalTemperatureMonitor_haveValidSample (void)
+{
+    return temperatureFilter_isValid();
+}
+
+uint16_t InternalTemperatureMonitor_currentCounts (void)
+{
+    return temperatureFilter_value();
+}
+
+int16_t InternalTemperatureMonitor_currentTemperature (void)
+{
+    int16_t curTempC = 0;
+
+    if (temperatureFilter_isValid()) {
+        // counts to degrees C
+        curTempC = CalibrationManager_convert(cc_temperature,
+            InternalTemperatureMonitor_currentCounts());
+    }
+
+    return curTempC;
+}
+
+void InternalTemperatureMonitor_task (void)
+{
+    uint16_t temperature;
+    if (ADCManager_takeResult(SENSOR_ADC_CHANNEL, &resultsTaken, &temperature)) {
+        if (SystemTime_timerHasExpired(&powerupTimer)) {
+            temperatureFilter_insert(temperature);
+        }
+    }
+}
+
@@ -1,22 +1,30 @@
-//
-//  Internal Temperature Monitor
-//
-//  Monitors the temperature of the AtTiny84 using its internal
-//  temperature sensor
-//
-#ifndef INTERNALTEMPMONITOR_H
-#define INTERNALTEMPMONITOR_H
-
-#include <stdint.h>
-#include <stdbool.h>
-
-extern void InternalTemperatureMonitor_Initialize (void);
-
-extern bool InternalTemperatureMonitor_haveValidSample (void);
-
-// temperature in units of degree C
-extern int16_t InternalTemperatureMonitor_currentTemperature (void);
-
-extern void InternalTemperatureMonitor_task (void);
-
+//
+//  Internal Temperature Monitor
+//
+//  Monitors the temperature of the AtTiny84 using its internal
+//  temperature sensor
+//
+#ifndef INTERNALTEMPMONITOR_H
+#define INTERNALTEMPMONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// sensor counts to degrees C before calibration (see
+// CalibrationManager.h): a degree per count, less 266
+#define INTERNALTEMPMONITOR_NOMINAL_GAIN 32768
+#define INTERNALTEMPMONITOR_NOMINAL_OFFSET (-266)
+
+extern void InternalTemperatureMonitor_Initialize (void);
+
+extern bool InternalTemperatureMonitor_haveValidSample (void);
+
+// temperature in units of degree C
+extern int16_t InternalTemperatureMonitor_currentTemperature (void);
+
+// filtered readings, in ADC counts (0 until the first one)
+extern uint16_t InternalTemperatureMonitor_currentCounts (void);
+
+extern void InternalTemperatureMonitor_task (void);
+
 #endif      // INTERNALTEMPMONITOR_H
\ No newline at end of file
@@ -1,79 +1,196 @@
-//
-//  AC Mains Monitor
-//
-//  Monitors the state of mains power.
-//
-//  How it works:
-//      This is done using an AC optoisolator. We sample the input pin
-//      every iteration and count when it is low (AC driving LEDs in
-//      optoisolator). If the mains are on we expect the input pin to be
-//      low at least twice during the sample period (50mS).
-//
-//  Pin usage:
-//     PA7 - input from optoisolator
-//
-#include "MainsMonitor.h"
-
-#include "SystemTime.h"
-#include <avr/io.h>
-#include <avr/interrupt.h>
-
-#define SAMPLE_INTERVAL (SYSTEMTIME_TICKS_PER_SECOND / 15)
-
-#define OPTOISOLATOR_DDR    DDRA
-#define OPTOISOLATOR_INPORT PINA
-#define OPTOISOLATOR_PORT   PORTA
-#define OPTOISOLATOR_PIN    PA7
-
-static bool mainsOn = false;
-static uint16_t numSamples;
-static uint16_t numAssertedSamples;
-static SystemTime_Timer sampleTimer;
-static MainsMonitor_Notification notification = NULL;
-
-void MainsMonitor_Initialize (void)
-{
-    mainsOn = false;
-    numSamples = 0;
-    numAssertedSamples = 0;
-    notification = NULL;
-
-    // set up pin as input, turn on pull-up
-    OPTOISOLATOR_DDR &= (~(1 << OPTOISOLATOR_PIN));
-    OPTOISOLATOR_PORT |= (1 << OPTOISOLATOR_PIN);
-
-    // start sample interval timer
-    SystemTime_startTimer(SAMPLE_INTERVAL, &sampleTimer);
-}
-
-void MainsMonitor_registerForNotification (
-    MainsMonitor_Notification notificationFunction)
-{
-    notification = notificationFunction;
-}
-
-bool MainsMonitor_mainsOn (void)
-{
-    return mainsOn;
-}
-
-void MainsMonitor_task (void)
-{
-    if (SystemTime_timerHasExpired(&sampleTimer)) {
-        SystemTime_startTimer(SAMPLE_INTERVAL, &sampleTimer);
-
-        if (numSamples >= 8) {
-            // check for at least 2 samples asserted
-            mainsOn = (numAssertedSamples >= 2);
-        }
-
-        numSamples = 0;
-        numAssertedSamples = 0;
-    } else {
-        ++numSamples;
-        if ((OPTOISOLATOR_INPORT & (1 << OPTOISOLATOR_PIN)) == 0) {
-            ++numAssertedSamples;
-        }
-    }
-}
-
+//
+//  AC Mains Monitor
+//
+//  Monitors the state of mains power.
+//
+//  How it works:
+//      This is done using an AC optoisolator, which pulls the input pin
+//      low while the mains voltage is high enough to light its LED, in
+//      both half cycles. So the pin falls once at the start of each
+//      half cycle.
+//
+//      With MAINSMONITOR_EDGE_TIMED:
+//      The pin is Timer 1's input capture pin, and Timer 1 runs free at
+//      the CPU clock (see SoftwareSerialRx), so the hardware timestamps
+//      each falling edge. The capture interrupt measures the time from
+//      the last edge: edges too soon after it are noise and are ignored,
+//      and a few in a row a plausible half cycle apart mean the mains
+//      are on.
+//
+//      A SystemTime tick hook looks at how long it has been since the
+//      last edge. Once MAINSMONITOR_MISSED_HALF_CYCLES half cycles
+//      (as long as the last one measured) have gone by without one,
+//      the mains are off. That is within about 20mS (plus a tick) of
+//      the mains failing.
+//
+//      Timer 1 stops during ADC noise reduction sleep, so now and then
+//      a half cycle reads a little short. That only brings the dropout
+//      time in by a fraction of a millisecond.
+//
+//      Otherwise:
+//      A SystemTime tick hook samples the pin on every tick. The pin is
+//      low for more than a tick in each half cycle, so while the mains
+//      are on it is never seen high on two ticks in a row. A few low
+//      samples turn the mains on, and DROPOUT_TICKS without one (the
+//      missed half cycles of 50Hz mains, plus a tick) turn them off.
+//      That is within about 23mS of the mains failing.
+//
+//  Pin usage:
+//     PA7 (ICP1) - input from optoisolator
+//
+#include "MainsMonitor.h"
+
+#include "SystemTime.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define TICK_HOOK_PRIORITY 1
+
+// edges in a row, a half cycle apart, (or low samples) for the mains
+// to be on
+#define EDGES_FOR_MAINS_ON 3
+
+#if MAINSMONITOR_EDGE_TIMED
+// Timer 1 counts at the CPU clock. Half cycles of 40 to 70 Hz mains
+#define MIN_HALF_CYCLE ((uint16_t)(F_CPU / 140))
+#define MAX_HALF_CYCLE ((uint16_t)(F_CPU / 80))
+
+// time from the last edge to declaring the mains off: the missed half
+// cycles plus half of one, for jitter
+#define dropoutTimeFor(halfCycle) \
+    (((halfCycle) * MAINSMONITOR_MISSED_HALF_CYCLES) + ((halfCycle) / 2))
+#else
+#define DROPOUT_TICKS \
+    (((MAINSMONITOR_MISSED_HALF_CYCLES * SYSTEMTIME_TICKS_PER_SECOND) / 100) + 1)
+#endif
+
+#define OPTOISOLATOR_DDR    DDRA
+#define OPTOISOLATOR_INPORT PINA
+#define OPTOISOLATOR_PORT   PORTA
+#define OPTOISOLATOR_PIN    PA7
+
+static volatile bool mainsOn = false;
+#if MAINSMONITOR_EDGE_TIMED
+static uint16_t lastEdge;           // Timer 1 count at the last edge
+static uint8_t edgesInRow;          // 0 when waiting for the first edge
+static uint16_t dropoutTime;
+#else
+static uint8_t lowSamples;          // since the mains were last off
+static uint8_t ticksSinceLow;
+#endif
+static MainsMonitor_Notification notifications[MAINSMONITOR_MAX_NOTIFICATIONS];
+static uint8_t numNotifications;
+
+// interrupts must be disabled when calling this
+static void notifyClients (
+    const bool on)
+{
+    for (uint8_t n = 0; n < numNotifications; ++n) {
+        notifications[n](on);
+    }
+}
+
+#if MAINSMONITOR_EDGE_TIMED
+ISR(SIG_INPUT_CAPTURE1, ISR_BLOCK)
+{
+    const uint16_t edge = ICR1;
+    const uint16_t period = edge - lastEdge;
+
+    // edges too soon after the last one are noise on the line - keep
+    // timing from the last real edge
+    if ((edgesInRow == 0) || (period >= MIN_HALF_CYCLE)) {
+        if ((edgesInRow == 0) || (period > MAX_HALF_CYCLE)) {
+            // first edge, or not a half cycle after the last one. A
+            // missed edge or two doesn't turn the mains off - that's
+            // up to checkForDropout
+            edgesInRow = 1;
+        } else if (edgesInRow < EDGES_FOR_MAINS_ON) {
+            ++edgesInRow;
+        }
+        if (edgesInRow == EDGES_FOR_MAINS_ON) {
+            dropoutTime = dropoutTimeFor(period);
+            if (!mainsOn) {
+                mainsOn = true;
+                notifyClients(true);
+            }
+        }
+        lastEdge = edge;
+    }
+}
+
+// called from the SystemTime tick interrupt
+static void checkForDropout (void)
+{
+    if ((edgesInRow != 0) &&
+        ((uint16_t)(TCNT1 - lastEdge) > dropoutTime)) {
+        edgesInRow = 0;
+        dropoutTime = dropoutTimeFor(MAX_HALF_CYCLE);
+        if (mainsOn) {
+            mainsOn = false;
+            notifyClients(false);
+        }
+    }
+}
+#else
+// called from the SystemTime tick interrupt
+static void checkForDropout (void)
+{
+    if ((OPTOISOLATOR_INPORT & (1 << OPTOISOLATOR_PIN)) == 0) {
+        ticksSinceLow = 0;
+        if ((lowSamples < EDGES_FOR_MAINS_ON) &&
+            (++lowSamples == EDGES_FOR_MAINS_ON)) {
+            mainsOn = true;
+            notifyClients(true);
+        }
+    } else if ((lowSamples != 0) && (++ticksSinceLow >= DROPOUT_TICKS)) {
+        lowSamples = 0;
+        if (mainsOn) {
+            mainsOn = false;
+            notifyClients(false);
+        }
+    }
+}
+#endif
+
+void MainsMonitor_Initialize (void)
+{
+    mainsOn = false;
+#if MAINSMONITOR_EDGE_TIMED
+    lastEdge = 0;
+    edgesInRow = 0;
+    dropoutTime = dropoutTimeFor(MAX_HALF_CYCLE);
+#else
+    lowSamples = 0;
+    ticksSinceLow = 0;
+#endif
+    numNotifications = 0;
+
+    // set up pin as input, turn on pull-up
+    OPTOISOLATOR_DDR &= (~(1 << OPTOISOLATOR_PIN));
+    OPTOISOLATOR_PORT |= (1 << OPTOISOLATOR_PIN);
+
+#if MAINSMONITOR_EDGE_TIMED
+    // capture falling edges on ICP1, with the noise canceler. Timer 1
+    // itself is started by SoftwareSerialRx
+    ACSR &= ~(1 << ACIC);               // capture from the pin, not the comparator
+    TCCR1B = (TCCR1B & ~(1 << ICES1)) | (1 << ICNC1);
+    TIFR1 = (1 << ICF1);    // "clear" the input capture flag
+    TIMSK1 |= (1 << ICIE1); // enable input capture interrupt
+#endif
+
+    SystemTime_registerTickHook(checkForDropout, TICK_HOOK_PRIORITY, 1);
+}
+
+void MainsMonitor_registerForNotification (
+    MainsMonitor_Notification notificationFunction)
+{
+    if (numNotifications < MAINSMONITOR_MAX_NOTIFICATIONS) {
+        notifications[numNotifications] = notificationFunction;
+        ++numNotifications;
+    }
+}
+
+bool MainsMonitor_mainsOn (void)
+{
+    return mainsOn;
+}
@@ -1,25 +1,41 @@
-//
-//  AC Mains Monitor
-//
-//  Monitors the state of the AC Mains (to detect power failure)
-//
-#ifndef MAINSMONITOR_H
-#define MAINSMONITOR_H
-
-#include <stdint.h>
-#include <stdbool.h>
-
-// prototypes for functions that clients supply to
-// get notification of mains state change event
-typedef void (*MainsMonitor_Notification)(bool mainsOn);
-
-extern void MainsMonitor_Initialize (void);
-
-extern void MainsMonitor_registerForNotification (
-    MainsMonitor_Notification notificationFunction);
-
-extern bool MainsMonitor_mainsOn (void);
-
-extern void MainsMonitor_task (void);
-
-#endif      // MAINSMONITOR_H
\ No newline at end of file
+//
+//  AC Mains Monitor
+//
+//  Monitors the state of the AC Mains (to detect power failure)
+//
+#ifndef MAINSMONITOR_H
+#define MAINSMONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// the mains are taken to have failed when this many half cycles go by
+// without one starting. Up to 4
+// time the optoisolator's edges with Timer 1's input capture, rather
+// than sample it on each tick. That sees a dropout a few milliseconds
+// sooner, but it doesn't fit in the flash with the rest of the
+// firmware, so it is only built on request
+#ifndef MAINSMONITOR_EDGE_TIMED
+#define MAINSMONITOR_EDGE_TIMED false
+#endif
+
+#ifndef MAINSMONITOR_MISSED_HALF_CYCLES
+#define MAINSMONITOR_MISSED_HALF_CYCLES 2
+#endif
+
+// prototypes for functions that clients supply to
+// get notification of mains state change event. It is called from
+// an interrupt handler, as soon as the change is seen
+typedef void (*MainsMonitor_Notification)(bool mainsOn);
+
+// number of clients that can register for notification
+#define MAINSMONITOR_MAX_NOTIFICATIONS 2
+
+extern void MainsMonitor_Initialize (void);
+
+extern void MainsMonitor_registerForNotification (
+    MainsMonitor_Notification notificationFunction);
+
+extern bool MainsMonitor_mainsOn (void);
+
+#endif      // MAINSMONITOR_H
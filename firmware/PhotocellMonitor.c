@@ -1,108 +1,260 @@
-//
-//  Photocell Monitor
-//
-//  Monitors the photocell and provides ambient light level
-//  The photocell has fairly slow response. Tests show it takes
-//  about 100mS to settle at a new higher light level, and a
-//  little more going to a lower light level.
-//
-//  Pin usage:
-//     ADC3 (PA3) - input from photocell voltage divider
-//
-
-#include "PhotocellMonitor.h"
-
-#include "ADCManager.h"
-#include "SystemTime.h"
-#include "DataHistory.h"
-
-#define PHOTOCELL_ADC_CHANNEL 3
-
-#define SAMPLE_INTERVAL (SYSTEMTIME_TICKS_PER_SECOND / 20)
-#define PHOTOCELL_SAMPLES 5
-
-typedef enum {
-    pms_idle,
-    pms_waitingForADCStart,
-    pms_waitingForADCCompletion
-} PhotocellMonitor_state;
-
-static PhotocellMonitor_state pmState = pms_idle;
-static SystemTime_Timer sampleTimer;
-static uint16_t photocellVoltage;
-DataHistory_define(PHOTOCELL_SAMPLES, lightLevelHistory);
-
-// ADC counts to percent (1023 counts is 100%)
-static inline uint8_t countsToPercent (
-    const uint16_t counts)
-{
-    // counts to percent
-    const int32_t c32 = counts;
-    return (uint8_t)((c32 * 100) / 1024);
-}
-
-void PhotocellMonitor_Initialize (void)
-{
-    pmState = pms_idle;
-    SystemTime_startTimer(0, &sampleTimer); // start sampling immediately
-    DataHistory_clear(&lightLevelHistory);
-
-    // set up the ADC channel for measuring photocell voltage
-    ADCManager_setupChannel(PHOTOCELL_ADC_CHANNEL, ADC_REF_VCC, false);
-}
-
-bool PhotocellMonitor_haveValidSample (void)
-{
-    return (DataHistory_length(&lightLevelHistory) >= PHOTOCELL_SAMPLES);
-}
-
-uint8_t PhotocellMonitor_currentLightLevel (void)
-{
-    const uint16_t latestVoltage = DataHistory_getLatest(&lightLevelHistory);
-    return countsToPercent(latestVoltage);
-}
-
-uint8_t PhotocellMonitor_averageLightLevel (void)
-{
-    uint16_t photocellVoltage = 0;
-    if (PhotocellMonitor_haveValidSample()) {
-        uint16_t minVoltage;
-        uint16_t maxVoltage;
-        DataHistory_getStatistics(
-            &lightLevelHistory, PHOTOCELL_SAMPLES,
-            &minVoltage, &maxVoltage, &photocellVoltage);
-    }
-
-    return countsToPercent(photocellVoltage);
-}
-
-void PhotocellMonitor_clearStatistics (void)
-{
-    DataHistory_clear(&lightLevelHistory);
-}
-
-void PhotocellMonitor_task (void)
-{
-    switch (pmState) {
-        case pms_idle : {
-            if (SystemTime_timerHasExpired(&sampleTimer)) {
-                SystemTime_startTimer(SAMPLE_INTERVAL, &sampleTimer);
-                pmState = pms_waitingForADCStart;
-            }
-            break;
-        case pms_waitingForADCStart :
-            if (ADCManager_StartConversion(PHOTOCELL_ADC_CHANNEL)) {
-                // successfully started conversion
-                pmState = pms_waitingForADCCompletion;
-            }
-            break;
-        case pms_waitingForADCCompletion :
-            if (ADCManager_ConversionIsComplete(&photocellVoltage)) {
-                DataHistory_insertValue(photocellVoltage, &lightLevelHistory);
-                pmState = pms_idle;
-            }
-            }
-            break;
-    }
-}
-
+//
+//  Photocell Monitor
+//
+//  Monitors the photocell and provides ambient light level
+//  The photocell has fairly slow response. Tests show it takes
+//  about 100mS to settle at a new higher light level, and a
+//  little more going to a lower light level.
+//
+//  How it works:
+//      The history holds light levels in percent, which is all the
+//      resolution the clients use, so it is all 8-bit arithmetic.
+//      Without PHOTOCELL_ADAPTIVE the photocell is sampled at
+//      SAMPLE_INTERVAL all the time. With it: most of the time the
+//      light level doesn't change, so the photocell is sampled at
+//      SLOW_INTERVAL. A sample that differs from the one before by
+//      more than CHANGE_THRESHOLD starts a burst at
+//      BURST_INTERVAL, and so does a client watching for a change. The
+//      burst lasts until the history is all burst samples and they
+//      are within SETTLED_BAND of each other (or MAX_BURST_SAMPLES
+//      have been taken, for light that never settles). Entering the
+//      burst on a bigger change than the one that ends it keeps the
+//      rate from flapping on noise.
+//
+//      A client watching for a change gets the result as soon as the
+//      level crosses the hysteresis around the reference, or (with
+//      PHOTOCELL_ADAPTIVE) settles inside it, instead of waiting out
+//      the photocell's worst case response time. Starting a watch first takes the results that
+//      are waiting, so the reference is the latest average and none of
+//      the samples from before the watch end up in the new history. A
+//      watch isn't started until the history is full (just after
+//      power-up, or after the statistics were cleared), since there is
+//      no reference level to compare with.
+//
+//  Pin usage:
+//     ADC3 (PA3) - input from photocell voltage divider
+//
+
+#include "PhotocellMonitor.h"
+
+#include "ADCManager.h"
+#include "TaskScheduler.h"
+#include "SystemTime.h"
+
+#define PHOTOCELL_ADC_CHANNEL 3
+
+#if PHOTOCELL_ADAPTIVE
+#define SLOW_INTERVAL (SYSTEMTIME_TICKS_PER_SECOND / 4)
+#define BURST_INTERVAL 2
+#else
+#define SAMPLE_INTERVAL (SYSTEMTIME_TICKS_PER_SECOND / 20)
+#endif
+// a power of two, for indexing the history
+#define PHOTOCELL_SAMPLES 4
+// conversions to discard after the ADC switches to the photocell
+#define PHOTOCELL_SETTLE_CONVERSIONS 1
+
+#if PHOTOCELL_ADAPTIVE
+// in percent
+#define CHANGE_THRESHOLD 2
+#define SETTLED_BAND 1
+// a second at BURST_INTERVAL
+#define MAX_BURST_SAMPLES (SYSTEMTIME_TICKS_PER_SECOND / BURST_INTERVAL)
+#endif
+
+static uint8_t resultsTaken;
+// the latest light levels, oldest overwritten first
+static uint8_t lightLevelHistory[PHOTOCELL_SAMPLES];
+static uint8_t historyLength;
+static uint8_t historyNext;
+#if PHOTOCELL_ADAPTIVE
+static bool bursting;
+static uint8_t burstSamples;
+#endif
+static uint8_t referenceLevel;
+static bool watching;               // referenceLevel is valid
+
+// ADC counts to percent (1023 counts is 100%)
+static inline uint8_t countsToPercent (
+    const uint16_t counts)
+{
+    // counts * 100 / 1024, kept in 16 bits (1023 * 25 fits)
+    return (uint8_t)((counts * 25) >> 8);
+}
+
+static void clearHistory (void)
+{
+    historyLength = 0;
+    historyNext = 0;
+}
+
+static void insertIntoHistory (
+    const uint8_t level)
+{
+    lightLevelHistory[historyNext] = level;
+    historyNext = (historyNext + 1) & (PHOTOCELL_SAMPLES - 1);
+    if (historyLength < PHOTOCELL_SAMPLES) {
+        ++historyLength;
+    }
+}
+
+static uint8_t latestInHistory (void)
+{
+    return lightLevelHistory[(historyNext - 1) & (PHOTOCELL_SAMPLES - 1)];
+}
+
+#if PHOTOCELL_ADAPTIVE
+static void startBurst (void)
+{
+    bursting = true;
+    burstSamples = 0;
+    ADCManager_setChannelInterval(PHOTOCELL_ADC_CHANNEL, BURST_INTERVAL);
+}
+
+// the samples in the history are always the first historyLength
+// entries, since the history only wraps once it is full
+static bool levelHasSettled (void)
+{
+    uint8_t minLevel = 0xFF;
+    uint8_t maxLevel = 0;
+    for (uint8_t i = 0; i < historyLength; i++) {
+        const uint8_t level = lightLevelHistory[i];
+        if (level < minLevel) {
+            minLevel = level;
+        }
+        if (level > maxLevel) {
+            maxLevel = level;
+        }
+    }
+
+    return (burstSamples >= PHOTOCELL_SAMPLES) &&
+        ((uint8_t)(maxLevel - minLevel) <= SETTLED_BAND);
+}
+#endif
+
+// takes the ADC's latest result into the history
+static void takeResults (void)
+{
+    uint16_t photocellVoltage;
+    if (ADCManager_takeResult(PHOTOCELL_ADC_CHANNEL, &resultsTaken, &photocellVoltage)) {
+        const uint8_t level = countsToPercent(photocellVoltage);
+#if PHOTOCELL_ADAPTIVE
+        if (!bursting && (historyLength > 0)) {
+            const uint8_t latestLevel = latestInHistory();
+            const uint8_t difference = (level > latestLevel)
+                ? (level - latestLevel)
+                : (latestLevel - level);
+            if (difference > CHANGE_THRESHOLD) {
+                startBurst();
+            }
+        }
+
+#endif
+
+        insertIntoHistory(level);
+
+#if PHOTOCELL_ADAPTIVE
+        if (bursting) {
+            ++burstSamples;
+            if (levelHasSettled() || (burstSamples >= MAX_BURST_SAMPLES)) {
+                bursting = false;
+                ADCManager_setChannelInterval(PHOTOCELL_ADC_CHANNEL, SLOW_INTERVAL);
+            }
+        }
+#endif
+    }
+}
+
+// called from the ADC interrupt handler
+static void resultReady (void)
+{
+    TaskScheduler_wakeTask(PhotocellMonitor_task);
+}
+
+void PhotocellMonitor_Initialize (void)
+{
+    resultsTaken = 0;
+    clearHistory();
+    referenceLevel = 0;
+    watching = false;
+
+    // set up the ADC channel for measuring photocell voltage
+#if PHOTOCELL_ADAPTIVE
+    ADCManager_setupChannel(PHOTOCELL_ADC_CHANNEL, ADC_REF_VCC, 0,
+        SLOW_INTERVAL, PHOTOCELL_SETTLE_CONVERSIONS, resultReady);
+    // get the first level quickly
+    startBurst();
+#else
+    ADCManager_setupChannel(PHOTOCELL_ADC_CHANNEL, ADC_REF_VCC, 0,
+        SAMPLE_INTERVAL, PHOTOCELL_SETTLE_CONVERSIONS, resultReady);
+#endif
+}
+
+bool PhotocellMonitor_haveValidSample (void)
+{
+    return (historyLength >= PHOTOCELL_SAMPLES);
+}
+
+uint8_t PhotocellMonitor_currentLightLevel (void)
+{
+    return latestInHistory();
+}
+
+// only meaningful once the history is full
+uint8_t PhotocellMonitor_averageLightLevel (void)
+{
+    uint16_t sum = 0;
+    if (PhotocellMonitor_haveValidSample()) {
+        for (uint8_t i = 0; i < PHOTOCELL_SAMPLES; i++) {
+            sum += lightLevelHistory[i];
+        }
+    }
+
+    return (uint8_t)(sum / PHOTOCELL_SAMPLES);
+}
+
+void PhotocellMonitor_clearStatistics (void)
+{
+    clearHistory();
+}
+
+bool PhotocellMonitor_watchForChange (void)
+{
+    takeResults();
+
+    watching = PhotocellMonitor_haveValidSample();
+    if (watching) {
+        referenceLevel = PhotocellMonitor_averageLightLevel();
+        clearHistory();
+#if PHOTOCELL_ADAPTIVE
+        startBurst();
+#endif
+    }
+
+    return watching;
+}
+
+PhotocellMonitor_lightChange PhotocellMonitor_levelChange (void)
+{
+    PhotocellMonitor_lightChange change = lc_none;
+
+    if (watching && (historyLength > 0)) {
+        const uint8_t level = PhotocellMonitor_currentLightLevel();
+        if (level < (referenceLevel - (referenceLevel / 4))) {
+            change = lc_darker;
+        } else if (level > (referenceLevel + (referenceLevel / 4))) {
+            change = lc_brighter;
+#if PHOTOCELL_ADAPTIVE
+        } else if (!bursting) {
+            change = lc_settled;
+#endif
+        }
+    }
+
+    return change;
+}
+
+void PhotocellMonitor_task (void)
+{
+    takeResults();
+}
@@ -1,26 +1,59 @@
-//
-//  Photocell Monitor
-//
-//  Monitors the photocell and provides ambient light level
-//
-#ifndef PHOTOCELLMONITOR_H
-#define PHOTOCELLMONITOR_H
-
-#include <stdint.h>
-#include <stdbool.h>
-#include <string.h>
-#include <stddef.h>
-
-extern void PhotocellMonitor_Initialize (void);
-
-extern bool PhotocellMonitor_haveValidSample (void);
-
-// light levels in units of percent (higher means brighter)
-extern uint8_t PhotocellMonitor_currentLightLevel (void);
-extern uint8_t PhotocellMonitor_averageLightLevel (void);
-
-extern void PhotocellMonitor_clearStatistics (void);
-
-extern void PhotocellMonitor_task (void);
-
-#endif      // PHOTOCELLMONITOR_H
+//
+//  Photocell Monitor
+//
+//  Monitors the photocell and provides ambient light level
+//
+//  With PHOTOCELL_ADAPTIVE, the photocell is sampled slowly while the
+//  light level is steady, and in a burst while it is changing, or
+//  while a client is watching for it to change (see
+//  PhotocellMonitor_watchForChange). Otherwise it is sampled at a
+//  fixed rate
+//
+#ifndef PHOTOCELLMONITOR_H
+#define PHOTOCELLMONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+
+// the adaptive sampling rate. It doesn't fit in the flash with the
+// rest of the firmware, so it is only built on request
+#ifndef PHOTOCELL_ADAPTIVE
+#define PHOTOCELL_ADAPTIVE false
+#endif
+
+typedef enum {
+    lc_none,        // still changing, within the hysteresis
+    lc_settled,     // steady again, within the hysteresis (only with
+                    // PHOTOCELL_ADAPTIVE)
+    lc_darker,      // below the reference, by more than the hysteresis
+    lc_brighter     // above the reference, by more than the hysteresis
+} PhotocellMonitor_lightChange;
+
+extern void PhotocellMonitor_Initialize (void);
+
+extern bool PhotocellMonitor_haveValidSample (void);
+
+// light levels in units of percent (higher means brighter)
+extern uint8_t PhotocellMonitor_currentLightLevel (void);
+extern uint8_t PhotocellMonitor_averageLightLevel (void);
+
+extern void PhotocellMonitor_clearStatistics (void);
+
+// takes the average light level as the reference level, clears the
+// statistics and (with PHOTOCELL_ADAPTIVE) samples in a burst until
+// the level settles. Call when
+// something is about to change the light (the mains coming or going,
+// the LEDs switching). Returns false, and doesn't watch, if there
+// aren't enough samples yet for a reference level
+extern bool PhotocellMonitor_watchForChange (void);
+
+// the light level since the last PhotocellMonitor_watchForChange,
+// compared to the reference level. The hysteresis is a quarter of the
+// reference level. lc_none if the watch wasn't started
+extern PhotocellMonitor_lightChange PhotocellMonitor_levelChange (void);
+
+extern void PhotocellMonitor_task (void);
+
+#endif      // PHOTOCELLMONITOR_H
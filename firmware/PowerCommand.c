@@ -1,199 +1,230 @@
-//
-//  Power Command
-//
-#include "PowerCommand.h"
-
-#include "PushbuttonMonitor.h"
-#include "PhotocellMonitor.h"
-#include "MainsMonitor.h"
-#include "MotionMonitor.h"
-#include "PowerSwitches.h"
-#include "SystemMode.h"
-#include "SystemTime.h"
-#include "EEPROMStorage.h"
-
-#define PHOTOCELL_RESPONSE_DELAY (SYSTEMTIME_TICKS_PER_SECOND / 8)
-
-typedef enum PushbuttonTransition_enum {
-    pt_none,
-    pt_pressed,
-    pt_released
-} PushbuttonTransition;
-
-typedef enum MainsTransition_enum {
-    mt_none,
-    mt_cameOn,
-    mt_wentOff
-} MainsTransition;
-
-static PowerCommand_CommandState cmdState = cs_off;
-static bool pushbuttonWasPressed = false;
-static bool mainsWereOn = false;
-static SystemTime_Timer onOffTimer; // used for auto on, manual on, and manual off
-static uint8_t prevLightLevel = 0;
-static SystemTime_Timer photocellTimer;
-
-static void turnOnAutomatic (void)
-{
-    SystemTime_startTimer(
-        ((int32_t)SYSTEMTIME_TICKS_PER_SECOND) * 60 * EEPROMStorage_autoTime,
-        &onOffTimer);
-    PowerSwitches_command(true);
-    cmdState = cs_onAutomatic;
-}
-
-void PowerCommand_Initialize (void)
-{
-    cmdState = cs_off;
-    pushbuttonWasPressed = false;
-    mainsWereOn = false;
-    prevLightLevel = 0;
-}
-
-void PowerCommand_task (void)
-{
-    // check for a transition in the pushbutton
-    const bool pushbuttonNowPressed = PushbuttonMonitor_buttonIsPressed();
-    const PushbuttonTransition pbTransition =
-        (pushbuttonNowPressed && !pushbuttonWasPressed)
-        ? pt_pressed
-        : ((!pushbuttonNowPressed) && pushbuttonWasPressed)
-            ? pt_released
-            : pt_none;
-    pushbuttonWasPressed = pushbuttonNowPressed;
-
-    // check for a transition in the mains
-    const bool mainsAreOn = MainsMonitor_mainsOn();
-    const MainsTransition mTransition =
-        (mainsAreOn && !mainsWereOn)
-        ? mt_cameOn
-        : ((!mainsAreOn) && mainsWereOn)
-            ? mt_wentOff
-            : mt_none;
-    mainsWereOn = mainsAreOn;
-
-    switch (cmdState) {
-        case cs_off: 
-            if (pbTransition == pt_pressed) {
-                PowerCommand_turnOn();
-            } else if (mTransition == mt_wentOff) {
-                // capture light level before mains went off
-                prevLightLevel = PhotocellMonitor_averageLightLevel();
-                PhotocellMonitor_clearStatistics();
-                SystemTime_startTimer(PHOTOCELL_RESPONSE_DELAY, &photocellTimer);
-                cmdState = cs_waitingForPhotocellAfterMainsOff;
-            } else if (SystemTime_timerHasExpired(&onOffTimer) && // lockout time expired - must check
-                                                                  // first so timer updates properly
-                       ((!MainsMonitor_mainsOn()) || 
-                        (SystemMode_currentMode() == m_primary)) && // mains off or in primary mode
-                       PhotocellMonitor_haveValidSample() &&
-                       (PhotocellMonitor_averageLightLevel() <= EEPROMStorage_darkLevel)  && // it's dark
-                       MotionMonitor_motionDetected()) { // motion in room                       
-                turnOnAutomatic();
-            }
-            break;
-        case cs_waitingForPhotocellAfterMainsOff :
-            if (SystemTime_timerHasExpired(&photocellTimer)) {
-                // response delay time has passed
-                const uint8_t currLightLevel = PhotocellMonitor_currentLightLevel();
-                if (currLightLevel < (prevLightLevel - (prevLightLevel / 4))) {
-                    turnOnAutomatic();
-                } else {
-                    cmdState = cs_off;
-                }
-            }
-            break;
-        case cs_onManual:
-            if (pbTransition == pt_pressed) {
-                // lockout automatic turn-on briefly
-                PowerCommand_turnOff(AUTO_ON_LOCKOUT_TIME);
-            } else if (SystemTime_timerHasExpired(&onOffTimer)) {
-                PowerCommand_turnOff(0);
-            }
-            break;
-        case cs_onAutomatic:
-            if (pbTransition == pt_pressed) {
-                // lockout automatic turn-on briefly
-                PowerCommand_turnOff(AUTO_ON_LOCKOUT_TIME);
-            } else if (mTransition == mt_cameOn) {
-                prevLightLevel = PhotocellMonitor_averageLightLevel();
-                PhotocellMonitor_clearStatistics();
-                SystemTime_startTimer(PHOTOCELL_RESPONSE_DELAY, &photocellTimer);
-                if (PowerSwitches_currentState() > pss_undervoltage) {
-                    // power just came on. turn off LEDs, but re-check light level
-                    // in cs_waitingForPhotocellAfterMainsOn
-                    PowerSwitches_command(false);
-                    cmdState = cs_waitingForPhotocellAfterMainsOn;
-                } else {
-                    // power just came on, but we are in undervoltage condition
-                    PowerSwitches_command(false);
-                    cmdState = cs_waitingForPhotocellAfterMainsOnUndervoltage;
-                }
-            } else if (MotionMonitor_motionDetected()) { // motion in room
-                // extend auto period
-                SystemTime_startTimer(
-                    ((int32_t)SYSTEMTIME_TICKS_PER_SECOND) * 60 * EEPROMStorage_autoTime,
-                    &onOffTimer);
-            } else {
-                if (SystemTime_timerHasExpired(&onOffTimer)) {
-                    PowerCommand_turnOff(0);
-                }
-            }
-            break;
-        case cs_waitingForPhotocellAfterMainsOn :
-            if (SystemTime_timerHasExpired(&photocellTimer)) {
-                // response delay time has passed
-                const uint8_t currLightLevel = PhotocellMonitor_currentLightLevel();
-                if (currLightLevel < (prevLightLevel - (prevLightLevel / 4))) {
-                    // power came back on, but light level dropped when we
-                    // turned LEDs off. Turn LEDs back on
-                    turnOnAutomatic();
-                } else {
-                    PowerCommand_turnOff(0);
-                }
-            }
-            break;
-        case cs_waitingForPhotocellAfterMainsOnUndervoltage :
-            if (SystemTime_timerHasExpired(&photocellTimer)) {
-                // response delay time has passed
-                const uint8_t currLightLevel = PhotocellMonitor_currentLightLevel();
-                if (currLightLevel <= (prevLightLevel + (prevLightLevel / 4))) {
-                    // power came back on, but light level did not increase
-                    // Turn LEDs back on
-                    turnOnAutomatic();
-                } else {
-                    PowerCommand_turnOff(0);
-                }
-            }
-            break;
-    }
-}
-
-void PowerCommand_turnOn (void)
-{
-    SystemTime_startTimer(
-        ((int32_t)SYSTEMTIME_TICKS_PER_SECOND) * 60 * EEPROMStorage_manualTime,
-        &onOffTimer);
-    PowerSwitches_command(true);
-    cmdState = cs_onManual;
-}
-
-void PowerCommand_turnOff (
-    const uint8_t autoOnLockoutTime)
-{
-    if (autoOnLockoutTime > 0) {
-        SystemTime_startTimer(
-            ((int32_t)SYSTEMTIME_TICKS_PER_SECOND) * autoOnLockoutTime,
-            &onOffTimer);
-    } else {
-        SystemTime_cancelTimer(&onOffTimer);
-    }
-    PowerSwitches_command(false);
-    cmdState = cs_off;
-}
-
-PowerCommand_CommandState PowerCommand_current (void)
-{
-    return cmdState;
-}
-
+//
+//  Power Command
+//
+#include "PowerCommand.h"
+
+#include "PushbuttonMonitor.h"
+#include "PhotocellMonitor.h"
+#include "MainsMonitor.h"
+#include "MotionMonitor.h"
+#include "PowerSwitches.h"
+#include "SystemMode.h"
+#include "SystemTime.h"
+#include "TaskScheduler.h"
+#include "EEPROMStorage.h"
+
+// longest wait for the light level to respond to the mains or the LEDs
+#define PHOTOCELL_RESPONSE_DELAY (SYSTEMTIME_TICKS_PER_SECOND / 8)
+// the task is woken when the mains change. otherwise it looks at the
+// pushbutton and the timers every POLL_INTERVAL, and at the light
+// level at the photocell's burst rate while it waits on it
+#define POLL_INTERVAL (SYSTEMTIME_TICKS_PER_SECOND / 20)
+#define PHOTOCELL_POLL_INTERVAL 2
+
+typedef enum PushbuttonTransition_enum {
+    pt_none,
+    pt_pressed,
+    pt_released
+} PushbuttonTransition;
+
+typedef enum MainsTransition_enum {
+    mt_none,
+    mt_cameOn,
+    mt_wentOff
+} MainsTransition;
+
+static PowerCommand_CommandState cmdState = cs_off;
+static bool pushbuttonWasPressed = false;
+static bool mainsWereOn = false;
+static SystemTime_Timer onOffTimer; // used for auto on, manual on, and manual off
+static SystemTime_Timer photocellTimer;
+
+static void startOnOffTimerMinutes (
+    const uint16_t minutes)
+{
+    SystemTime_startTimer(
+        ((int32_t)SYSTEMTIME_TICKS_PER_SECOND) * 60 * minutes,
+        &onOffTimer);
+}
+
+// turns the LEDs on for the given number of minutes
+static void turnOnFor (
+    const uint16_t minutes,
+    const PowerCommand_CommandState newState)
+{
+    startOnOffTimerMinutes(minutes);
+    PowerSwitches_command(true);
+    cmdState = newState;
+}
+
+static void turnOnAutomatic (void)
+{
+    turnOnFor(EEPROMStorage_autoTime, cs_onAutomatic);
+}
+
+// called from an interrupt handler
+static void mainsChanged (
+    bool mainsOn)
+{
+    TaskScheduler_wakeTask(PowerCommand_task);
+}
+
+void PowerCommand_Initialize (void)
+{
+    cmdState = cs_off;
+    pushbuttonWasPressed = false;
+    mainsWereOn = false;
+
+    MainsMonitor_registerForNotification(mainsChanged);
+}
+
+void PowerCommand_task (void)
+{
+    // check for a transition in the pushbutton
+    const bool pushbuttonNowPressed = PushbuttonMonitor_buttonIsPressed();
+    const PushbuttonTransition pbTransition =
+        (pushbuttonNowPressed && !pushbuttonWasPressed)
+        ? pt_pressed
+        : ((!pushbuttonNowPressed) && pushbuttonWasPressed)
+            ? pt_released
+            : pt_none;
+    pushbuttonWasPressed = pushbuttonNowPressed;
+
+    // check for a transition in the mains
+    const bool mainsAreOn = MainsMonitor_mainsOn();
+    const MainsTransition mTransition =
+        (mainsAreOn && !mainsWereOn)
+        ? mt_cameOn
+        : ((!mainsAreOn) && mainsWereOn)
+            ? mt_wentOff
+            : mt_none;
+    mainsWereOn = mainsAreOn;
+
+    // the light level compared with the one from before the mains or
+    // the LEDs changed. PhotocellMonitor_levelChange compares the
+    // current level on every call, so lc_none when the response delay
+    // runs out means the level is still within the hysteresis: the
+    // same decision as comparing the level at the timeout
+    PhotocellMonitor_lightChange lightChange;
+    switch (cmdState) {
+        case cs_off: 
+            if (pbTransition == pt_pressed) {
+                PowerCommand_turnOn();
+            } else if (mTransition == mt_wentOff) {
+                // compare with the light level before mains went off
+                PhotocellMonitor_watchForChange();
+                SystemTime_startTimer(PHOTOCELL_RESPONSE_DELAY, &photocellTimer);
+                cmdState = cs_waitingForPhotocellAfterMainsOff;
+            } else if (SystemTime_timerHasExpired(&onOffTimer) && // lockout time expired - must check
+                                                                  // first so timer updates properly
+                       ((!MainsMonitor_mainsOn()) || 
+                        (SystemMode_currentMode() == m_primary)) && // mains off or in primary mode
+                       PhotocellMonitor_haveValidSample() &&
+                       (PhotocellMonitor_averageLightLevel() <= EEPROMStorage_darkLevel)  && // it's dark
+                       MotionMonitor_motionDetected()) { // motion in room                       
+                turnOnAutomatic();
+            }
+            break;
+        case cs_waitingForPhotocellAfterMainsOff :
+            // decide as soon as the light level has dropped or settled,
+            // or when the response delay time has passed
+            lightChange = PhotocellMonitor_levelChange();
+            if (lightChange == lc_darker) {
+                turnOnAutomatic();
+            } else if ((lightChange != lc_none) ||
+                       SystemTime_timerHasExpired(&photocellTimer)) {
+                cmdState = cs_off;
+            }
+            break;
+        case cs_onManual:
+            if (pbTransition == pt_pressed) {
+                // lockout automatic turn-on briefly
+                PowerCommand_turnOff(AUTO_ON_LOCKOUT_TIME);
+            } else if (SystemTime_timerHasExpired(&onOffTimer)) {
+                PowerCommand_turnOff(0);
+            }
+            break;
+        case cs_onAutomatic:
+            if (pbTransition == pt_pressed) {
+                // lockout automatic turn-on briefly
+                PowerCommand_turnOff(AUTO_ON_LOCKOUT_TIME);
+            } else if (mTransition == mt_cameOn) {
+                PhotocellMonitor_watchForChange();
+                SystemTime_startTimer(PHOTOCELL_RESPONSE_DELAY, &photocellTimer);
+                // power just came on. turn off LEDs, but re-check light
+                // level in cs_waitingForPhotocellAfterMainsOn, or
+                // cs_waitingForPhotocellAfterMainsOnUndervoltage if we are in
+                // undervoltage condition
+                cmdState = (PowerSwitches_currentState() > pss_undervoltage)
+                    ? cs_waitingForPhotocellAfterMainsOn
+                    : cs_waitingForPhotocellAfterMainsOnUndervoltage;
+                PowerSwitches_command(false);
+            } else if (MotionMonitor_motionDetected()) { // motion in room
+                // extend auto period
+                startOnOffTimerMinutes(EEPROMStorage_autoTime);
+            } else {
+                if (SystemTime_timerHasExpired(&onOffTimer)) {
+                    PowerCommand_turnOff(0);
+                }
+            }
+            break;
+        case cs_waitingForPhotocellAfterMainsOn :
+            lightChange = PhotocellMonitor_levelChange();
+            if (lightChange == lc_darker) {
+                // power came back on, but light level dropped when we
+                // turned LEDs off. Turn LEDs back on
+                turnOnAutomatic();
+            } else if ((lightChange != lc_none) ||
+                       SystemTime_timerHasExpired(&photocellTimer)) {
+                PowerCommand_turnOff(0);
+            }
+            break;
+        case cs_waitingForPhotocellAfterMainsOnUndervoltage :
+            lightChange = PhotocellMonitor_levelChange();
+            if (lightChange == lc_brighter) {
+                PowerCommand_turnOff(0);
+            } else if ((lightChange != lc_none) ||
+                       SystemTime_timerHasExpired(&photocellTimer)) {
+                // power came back on, but light level did not increase
+                // Turn LEDs back on
+                turnOnAutomatic();
+            }
+            break;
+    }
+
+    switch (cmdState) {
+        case cs_waitingForPhotocellAfterMainsOff :
+        case cs_waitingForPhotocellAfterMainsOn :
+        case cs_waitingForPhotocellAfterMainsOnUndervoltage :
+            TaskScheduler_delayCurrentTask(PHOTOCELL_POLL_INTERVAL);
+            break;
+        default :
+            TaskScheduler_delayCurrentTask(POLL_INTERVAL);
+            break;
+    }
+}
+
+void PowerCommand_turnOn (void)
+{
+    turnOnFor(EEPROMStorage_manualTime, cs_onManual);
+}
+
+void PowerCommand_turnOff (
+    const uint8_t autoOnLockoutTime)
+{
+    if (autoOnLockoutTime > 0) {
+        SystemTime_startTimer(
+            ((int32_t)SYSTEMTIME_TICKS_PER_SECOND) * autoOnLockoutTime,
+            &onOffTimer);
+    } else {
+        SystemTime_cancelTimer(&onOffTimer);
+    }
+    PowerSwitches_command(false);
+    cmdState = cs_off;
+}
+
+PowerCommand_CommandState PowerCommand_current (void)
+{
+    return cmdState;
+}
+
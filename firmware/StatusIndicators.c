@@ -1,163 +1,441 @@
-//
-//  Status Indicators
-//
-//  Controls outputs that indicate the internal status of the UPS.
-//  The first set of output is connected to an LEDs and gives a
-//  visual indication of battery charge and whether AC power is present.
-//
-//  The second function of this unit is status reporting. This is a
-//  serial ASCII stream that reports the state of the UPS (e.g. on AC,
-//  on battery, undervoltage warning, etc.)
-//
-//  uses pins
-//      PB0 - battery voltage indicator - 0-4 blinks
-//
-
-#include "StatusIndicators.h"
-
-#include "SystemTime.h"
-#include "BatteryMonitor.h"
-#include "PowerCommand.h"
-#include "PowerSwitches.h"
-#include "PhotocellMonitor.h"
-#include "MainsMonitor.h"
-#include "MotionMonitor.h"
-#include "InternalTemperatureMonitor.h"
-#include "PushbuttonMonitor.h"
-#include "SystemMode.h"
-#include "SoftwareSerialTx.h"
-#include "CharString.h"
-#include "StringUtils.h"
-#include <avr/io.h>
-
-#define BATTERY_STATUS_DDR      DDRB
-#define BATTERY_STATUS_PORT     PORTB
-#define BATTERY_STATUS_PIN      PB0
-
-#define TICK_TIMER_DURATION (SYSTEMTIME_TICKS_PER_SECOND / 20)
-#define TICKS_IN_MAJOR_CYCLE 160
-
-static SystemTime_Timer tickTimer;
-static uint8_t curTick;  // zero-based (0..40, takes 2 seconds to reach 40)
-static uint8_t ticksInCurrentState;
-static BatteryMonitor_batteryStatus latestBatteryStatus;
-
-void StatusIndicators_Initialize (void)
-{
-    // set status pin to output
-    BATTERY_STATUS_DDR      |= (1 << BATTERY_STATUS_PIN);
-
-    SystemTime_startTimer(TICK_TIMER_DURATION, &tickTimer);
-    curTick = 0;
-    ticksInCurrentState = 0;
-    latestBatteryStatus = bs_unknown;
-
-    SoftwareSerialTx_enable();
-}
-
-void StatusIndicators_task (void)
-{
-    // count ticks in major cycle
-    bool tickHasElapsed = false;
-    if (SystemTime_timerHasExpired(&tickTimer)) {
-        SystemTime_startTimer(TICK_TIMER_DURATION, &tickTimer);
-        if (curTick < (TICKS_IN_MAJOR_CYCLE - 1)) {
-            ++curTick;
-        } else {
-            curTick = 0;
-        }
-        tickHasElapsed = true;
-    }
-
-    //
-    // Battery status indicator
-    //
-    // create 6 blink slots (0-5) per two seconds
-    if (curTick == 0) {
-        latestBatteryStatus = BatteryMonitor_currentStatus();
-    }
-    const uint8_t interval = curTick / 6;
-    const uint8_t subinterval = curTick % 6;
-    const bool ledOn = // blink to indicate...
-        ((interval < latestBatteryStatus) && (subinterval == 0)) || // ...battery voltage
-        (MainsMonitor_mainsOn() && (interval == 10));               // ...mains status
-    if (ledOn) {
-        BATTERY_STATUS_PORT |= 1 << BATTERY_STATUS_PIN;
-    } else {
-        BATTERY_STATUS_PORT &= ~(1 << BATTERY_STATUS_PIN);
-    }
-}
-
-void StatusIndicators_sendStatusMesssage (void)
-{
-    CharString_define(30, msg);
-
-    // UPS status
-    CharString_appendP(PSTR("U"), &msg);
-    char upsChar = ' ';
-    switch (PowerSwitches_currentState()) {
-        case pss_initial                : upsChar = 'I'; break;
-        case pss_undervoltage           : upsChar = 'U'; break;
-        case pss_undervoltageWarning    : upsChar = 'W'; break;
-        case pss_onBattery              : upsChar = 'B'; break;
-        case pss_onAdapter              : upsChar = 'A'; break;
-    }
-    CharString_appendC(upsChar, &msg);
-
-    // Battery voltage
-    CharString_appendP(PSTR(" B"), &msg);
-    StringUtils_appendDecimal(BatteryMonitor_currentVoltage(), 2, &msg);
-
-    // mains status
-    CharString_appendP(PSTR(" A"), &msg);
-    StringUtils_appendDecimal((uint16_t)MainsMonitor_mainsOn(), 0, &msg);
-
-    // Power command
-    CharString_appendP(PSTR(" C"), &msg);
-    CharString_appendC((char)SystemMode_currentMode(), &msg);
-    char cmdChar = ' ';
-    switch (PowerCommand_current()) {
-        case cs_off                              : cmdChar = '0'; break;
-        case cs_onManual                         : cmdChar = 'M'; break;
-        case cs_waitingForPhotocellAfterMainsOff : cmdChar = 'f'; break;
-        case cs_onAutomatic                      : cmdChar = 'A'; break;
-        case cs_waitingForPhotocellAfterMainsOn  : cmdChar = 'n'; break;
-        case cs_waitingForPhotocellAfterMainsOnUndervoltage  : cmdChar = 'n'; break;
-    }
-    CharString_appendC(cmdChar, &msg);
-
-    // Photocell
-    CharString_appendP(PSTR(" L"), &msg);
-    const uint8_t lightLevel = PhotocellMonitor_currentLightLevel();
-    StringUtils_appendDecimal(lightLevel, 0, &msg);
-
-    // Motion
-    CharString_appendP(PSTR(" M"), &msg);
-    StringUtils_appendDecimal((uint16_t)MotionMonitor_motionDetected(), 0, &msg);
-
-    // Temperature
-    CharString_appendP(PSTR(" T"), &msg);
-    StringUtils_appendDecimal((uint16_t)InternalTemperatureMonitor_currentTemperature(), 0, &msg);
-
-#if 0
-    // pushbutton
-    CharString_appendP(PSTR(" P"), &msg);
-    StringUtils_appendDecimal((int16_t)PushbuttonMonitor_buttonIsPressed(), 0, &msg);
-#endif
-
-#if COUNT_MAJOR_CYCLES
-    // Cycle counter
-    CharString_appendP(PSTR(" C"), &msg);
-    if (majorCycleCounter > 65535L) {
-        CharString_appendP(PSTR("oflo"), &msg);
-    } else {
-        StringUtils_appendDecimal((int16_t)majorCycleCounter, 0, &msg);
-    }
-    majorCycleCounter = 0;
-#endif
-
-    CharString_appendP(PSTR("\r\n"), &msg);
-
-    SoftwareSerialTx_send(CharString_cstr(&msg));
-}
-
+//
+//  Status Indicators
+//
+//  Controls outputs that indicate the internal status of the UPS.
+//  The first set of output is connected to an LEDs and gives a
+//  visual indication of battery charge and whether AC power is present.
+//
+//  The second function of this unit is status reporting. This is a
+//  serial ASCII stream that reports the state of the UPS (e.g. on AC,
+//  on battery, undervoltage warning, etc.)
+//
+//  uses pins
+//      PB0 - battery voltage indicator - 0-4 blinks
+//
+//  A status message that doesn't fit in the transmit queue (a reply
+//  is still going out) is held back, and the task sends it on a later
+//  tick once the queue has drained.
+//
+//  With STATUS_FRAMES, the status can be sent as a binary frame
+//  instead of a line of text. The frame is fixed-layout, with
+//  multi-byte fields little-endian:
+//      0       bits 0-3 frame type (STATUS_FRAME_FULL),
+//              bits 4-7 frame number, counting up from 0 to 15
+//      1       field 0: bits 0-3 UPS state (PowerSwitches_state),
+//              bits 4-7 power command (PowerCommand_CommandState)
+//      2       field 1: bit 0 mains on, bit 1 motion, bit 2 charge
+//              estimate valid, bits 4-5 mode (0 primary, 1 backup,
+//              2 switch)
+//      3-4     field 2: battery voltage, 1/100 V
+//      5       field 3: light level
+//      6       field 4: temperature, degrees C, signed
+//      7       field 5: state of charge, percent (0 without an
+//              estimate)
+//      8-9     field 6: runtime remaining, minutes (0 without an
+//              estimate)
+//      10      crc8 of bytes 0-9
+//  It is COBS encoded and sent between two zero bytes, so a receiver
+//  can tell it from the text around it and find the next one after a
+//  corrupted one. That's 14 bytes where the line is 30 to 40.
+//
+//  In the delta format most frames only carry the fields that changed
+//  since the frame before:
+//      0       bits 0-3 frame type (STATUS_FRAME_DELTA),
+//              bits 4-7 frame number
+//      1       bit n set if field n changed
+//      2-      the fields that changed, in order
+//      last    crc8 of the bytes before it
+//  A frame with nothing in it is 6 bytes. Every KEYFRAME_INTERVAL'th
+//  frame is a full frame (a keyframe), and so is the first one after
+//  the format is selected, after a keyframe is asked for, and after a
+//  frame that didn't fit in the transmit queue. A receiver that
+//  sees a frame number skipped, or a corrupted frame, has missed a
+//  change and should ask for a keyframe.
+//
+//  With STATUS_STREAM, status can also be streamed: sent every so many
+//  seconds without being asked for, and as soon as the UPS state,
+//  mains or motion changes. The task checks for that on each tick
+//  (every 50ms), and holds a message back while a reply is still going
+//  out so that it doesn't overflow the transmit queue.
+//
+
+#include "StatusIndicators.h"
+
+#include "SystemTime.h"
+#include "TaskScheduler.h"
+#include "BatteryMonitor.h"
+#include "ChargeEstimator.h"
+#include "PowerCommand.h"
+#include "PowerSwitches.h"
+#include "PhotocellMonitor.h"
+#include "MainsMonitor.h"
+#include "MotionMonitor.h"
+#include "InternalTemperatureMonitor.h"
+#include "PushbuttonMonitor.h"
+#include "SystemMode.h"
+#include "SoftwareSerialTx.h"
+#include "CharString.h"
+#include "StringUtils.h"
+#if STATUS_FRAMES
+#include "COBS.h"
+#include "crc8.h"
+#endif
+#include <avr/io.h>
+
+#define BATTERY_STATUS_DDR      DDRB
+#define BATTERY_STATUS_PORT     PORTB
+#define BATTERY_STATUS_PIN      PB0
+
+#define TICK_TIMER_DURATION (SYSTEMTIME_TICKS_PER_SECOND / 20)
+#define TICKS_IN_MAJOR_CYCLE 160
+
+#if STATUS_FRAMES
+#define STATUS_FRAME_FULL 1
+#define STATUS_FRAME_DELTA 2
+#define FRAME_NUMBER_SHIFT 4
+#define STATUS_FIELDS_LENGTH 9
+#define NUM_STATUS_FIELDS 7
+// with the field bitmap and the crc
+#define MAX_STATUS_FRAME_LENGTH (STATUS_FIELDS_LENGTH + 3)
+#define KEYFRAME_INTERVAL 16
+
+#define FLAG_MAINS_ON       0x01
+#define FLAG_MOTION         0x02
+#define FLAG_HAVE_ESTIMATE  0x04
+#define MODE_SHIFT          4
+#endif
+
+static uint8_t curTick;  // zero-based (0..40, takes 2 seconds to reach 40)
+static uint8_t ticksInCurrentState;
+static BatteryMonitor_batteryStatus latestBatteryStatus;
+static bool statusPending;          // waiting for room in the queue
+#if STATUS_STREAM
+static uint16_t streamPeriod;       // seconds, 0 when not streaming
+static uint32_t nextStreamTime;     // uptime seconds
+// as of the last status message
+static PowerSwitches_state sentUPSState;
+static bool sentMainsOn;
+static bool sentMotion;
+#endif
+#if STATUS_FRAMES
+static StatusIndicators_format format;
+static uint8_t sentFields[STATUS_FIELDS_LENGTH];
+static uint8_t frameNumber;
+static uint8_t framesToKeyframe;
+
+// where each field starts in the fields, and where the last one ends
+static const uint8_t fieldOffsets[NUM_STATUS_FIELDS + 1] PROGMEM = {
+    0, 1, 2, 4, 5, 6, 7, 9
+};
+#endif
+
+void StatusIndicators_Initialize (void)
+{
+    // set status pin to output
+    BATTERY_STATUS_DDR      |= (1 << BATTERY_STATUS_PIN);
+
+    curTick = 0;
+    ticksInCurrentState = 0;
+    latestBatteryStatus = bs_unknown;
+    statusPending = false;
+#if STATUS_STREAM
+    streamPeriod = 0;
+#endif
+#if STATUS_FRAMES
+    format = sf_text;
+    frameNumber = 0;
+    framesToKeyframe = 0;
+#endif
+
+    SoftwareSerialTx_enable();
+}
+
+void StatusIndicators_task (void)
+{
+    //
+    // Battery status indicator
+    //
+    // create 6 blink slots (0-5) per two seconds
+    if (curTick == 0) {
+        latestBatteryStatus = BatteryMonitor_currentStatus();
+    }
+    const uint8_t interval = curTick / 6;
+    const uint8_t subinterval = curTick % 6;
+    const bool ledOn = // blink to indicate...
+        ((interval < latestBatteryStatus) && (subinterval == 0)) || // ...battery voltage
+        (MainsMonitor_mainsOn() && (interval == 10));               // ...mains status
+    if (ledOn) {
+        BATTERY_STATUS_PORT |= 1 << BATTERY_STATUS_PIN;
+    } else {
+        BATTERY_STATUS_PORT &= ~(1 << BATTERY_STATUS_PIN);
+    }
+
+    //
+    // Status that is held back, or due to be streamed
+    //
+#if STATUS_STREAM
+    if ((statusPending ||
+         ((streamPeriod != 0) &&
+          ((SystemTime_uptimeSeconds() >= nextStreamTime) ||
+           (PowerSwitches_currentState() != sentUPSState) ||
+           (MainsMonitor_mainsOn() != sentMainsOn) ||
+           (MotionMonitor_motionDetected() != sentMotion)))) &&
+        SoftwareSerialTx_isIdle()) {
+#else
+    if (statusPending && SoftwareSerialTx_isIdle()) {
+#endif
+        StatusIndicators_sendStatusMesssage();
+    }
+
+    // count ticks in major cycle
+    if (curTick < (TICKS_IN_MAJOR_CYCLE - 1)) {
+        ++curTick;
+    } else {
+        curTick = 0;
+    }
+
+    // indicator only changes on ticks
+    TaskScheduler_delayCurrentTask(TICK_TIMER_DURATION);
+}
+
+#if STATUS_FRAMES
+void StatusIndicators_setFormat (
+    const StatusIndicators_format newFormat)
+{
+    format = newFormat;
+    framesToKeyframe = 0;
+}
+
+void StatusIndicators_requestKeyframe (void)
+{
+    framesToKeyframe = 0;
+#if STATUS_STREAM
+    // if streaming, it goes out on the next tick
+    nextStreamTime = 0;
+#endif
+}
+#endif
+
+#if STATUS_STREAM
+void StatusIndicators_stream (
+    const uint16_t period)
+{
+    streamPeriod = period;
+    // the first message goes out on the next tick
+    nextStreamTime = 0;
+}
+#endif
+
+static bool sendTextStatus (void)
+{
+    CharString_define(42, msg);
+
+    // UPS status
+    CharString_appendP(PSTR("U"), &msg);
+    char upsChar = ' ';
+    switch (PowerSwitches_currentState()) {
+        case pss_initial                : upsChar = 'I'; break;
+        case pss_undervoltage           : upsChar = 'U'; break;
+        case pss_undervoltageWarning    : upsChar = 'W'; break;
+        case pss_onBattery              : upsChar = 'B'; break;
+        case pss_onAdapter              : upsChar = 'A'; break;
+    }
+    CharString_appendC(upsChar, &msg);
+
+    // Battery voltage
+    CharString_appendP(PSTR(" B"), &msg);
+    StringUtils_appendDecimal(BatteryMonitor_currentVoltage(), 2, &msg);
+
+    // mains status
+    CharString_appendP(PSTR(" A"), &msg);
+    StringUtils_appendDecimal((uint16_t)MainsMonitor_mainsOn(), 0, &msg);
+
+    // Power command
+    CharString_appendP(PSTR(" C"), &msg);
+    CharString_appendC((char)SystemMode_currentMode(), &msg);
+    char cmdChar = ' ';
+    switch (PowerCommand_current()) {
+        case cs_off                              : cmdChar = '0'; break;
+        case cs_onManual                         : cmdChar = 'M'; break;
+        case cs_waitingForPhotocellAfterMainsOff : cmdChar = 'f'; break;
+        case cs_onAutomatic                      : cmdChar = 'A'; break;
+        case cs_waitingForPhotocellAfterMainsOn  : cmdChar = 'n'; break;
+        case cs_waitingForPhotocellAfterMainsOnUndervoltage  : cmdChar = 'n'; break;
+    }
+    CharString_appendC(cmdChar, &msg);
+
+    // Photocell
+    CharString_appendP(PSTR(" L"), &msg);
+    const uint8_t lightLevel = PhotocellMonitor_currentLightLevel();
+    StringUtils_appendDecimal(lightLevel, 0, &msg);
+
+    // Motion
+    CharString_appendP(PSTR(" M"), &msg);
+    StringUtils_appendDecimal((uint16_t)MotionMonitor_motionDetected(), 0, &msg);
+
+    // Temperature
+    CharString_appendP(PSTR(" T"), &msg);
+    StringUtils_appendDecimal((uint16_t)InternalTemperatureMonitor_currentTemperature(), 0, &msg);
+
+    if (ChargeEstimator_haveEstimate()) {
+        // state of charge and minutes of runtime left
+        CharString_appendP(PSTR(" S"), &msg);
+        StringUtils_appendDecimal(ChargeEstimator_stateOfCharge(), 0, &msg);
+        CharString_appendP(PSTR(" R"), &msg);
+        StringUtils_appendDecimal(ChargeEstimator_minutesRemaining(), 0, &msg);
+    }
+
+#if 0
+    // pushbutton
+    CharString_appendP(PSTR(" P"), &msg);
+    StringUtils_appendDecimal((int16_t)PushbuttonMonitor_buttonIsPressed(), 0, &msg);
+#endif
+
+#if COUNT_MAJOR_CYCLES
+    // Cycle counter
+    CharString_appendP(PSTR(" C"), &msg);
+    if (majorCycleCounter > 65535L) {
+        CharString_appendP(PSTR("oflo"), &msg);
+    } else {
+        StringUtils_appendDecimal((int16_t)majorCycleCounter, 0, &msg);
+    }
+    majorCycleCounter = 0;
+#endif
+
+    CharString_appendP(PSTR("\r\n"), &msg);
+
+    return SoftwareSerialTx_sendBytes(
+        (const uint8_t*)CharString_cstr(&msg), CharString_length(&msg));
+}
+
+#if STATUS_FRAMES
+static void getStatusFields (
+    uint8_t* fields)
+{
+    fields[0] = (uint8_t)PowerSwitches_currentState() |
+        ((uint8_t)PowerCommand_current() << 4);
+
+    uint8_t flags = 0;
+    if (MainsMonitor_mainsOn()) {
+        flags |= FLAG_MAINS_ON;
+    }
+    if (MotionMonitor_motionDetected()) {
+        flags |= FLAG_MOTION;
+    }
+    uint8_t stateOfCharge = 0;
+    uint16_t minutesRemaining = 0;
+    if (ChargeEstimator_haveEstimate()) {
+        flags |= FLAG_HAVE_ESTIMATE;
+        stateOfCharge = ChargeEstimator_stateOfCharge();
+        minutesRemaining = ChargeEstimator_minutesRemaining();
+    }
+    switch (SystemMode_currentMode()) {
+        case m_primary  : break;
+        case m_backup   : flags |= (1 << MODE_SHIFT); break;
+        case m_switch   : flags |= (2 << MODE_SHIFT); break;
+    }
+    fields[1] = flags;
+
+    const int16_t batteryVoltage = BatteryMonitor_currentVoltage();
+    fields[2] = (uint8_t)batteryVoltage;
+    fields[3] = (uint8_t)(batteryVoltage >> 8);
+    fields[4] = PhotocellMonitor_currentLightLevel();
+    fields[5] = (uint8_t)(int8_t)InternalTemperatureMonitor_currentTemperature();
+    fields[6] = stateOfCharge;
+    fields[7] = (uint8_t)minutesRemaining;
+    fields[8] = (uint8_t)(minutesRemaining >> 8);
+}
+
+static bool sendBinaryStatus (void)
+{
+    uint8_t frame[MAX_STATUS_FRAME_LENGTH];
+    uint8_t frameLength = 1;
+
+    uint8_t fields[STATUS_FIELDS_LENGTH];
+    getStatusFields(fields);
+
+    const bool isDelta = (format == sf_delta) && (framesToKeyframe != 0);
+    if (isDelta) {
+        frame[0] = STATUS_FRAME_DELTA;
+        uint8_t changedFields = 0;
+        frameLength = 2;
+        for (uint8_t f = 0; f < NUM_STATUS_FIELDS; ++f) {
+            const uint8_t fieldStart = pgm_read_byte_near(&fieldOffsets[f]);
+            const uint8_t fieldEnd = pgm_read_byte_near(&fieldOffsets[f + 1]);
+            bool changed = false;
+            for (uint8_t b = fieldStart; b < fieldEnd; ++b) {
+                if (fields[b] != sentFields[b]) {
+                    changed = true;
+                }
+            }
+            if (changed) {
+                changedFields |= (1 << f);
+                for (uint8_t b = fieldStart; b < fieldEnd; ++b) {
+                    frame[frameLength++] = fields[b];
+                }
+            }
+        }
+        frame[1] = changedFields;
+    } else {
+        frame[0] = STATUS_FRAME_FULL;
+        for (uint8_t b = 0; b < STATUS_FIELDS_LENGTH; ++b) {
+            frame[frameLength++] = fields[b];
+        }
+    }
+    frame[0] |= (frameNumber << FRAME_NUMBER_SHIFT);
+    frame[frameLength] = crc8(frame, frameLength);
+    ++frameLength;
+
+    // COBS encoded, between two zeros
+    uint8_t wireFrame[MAX_STATUS_FRAME_LENGTH + 4];
+    const uint8_t encodedLength = COBS_encode(frame, frameLength, &wireFrame[1]);
+    wireFrame[0] = 0;
+    wireFrame[encodedLength + 1] = 0;
+
+    const bool sent = SoftwareSerialTx_sendBytes(wireFrame, encodedLength + 2);
+    if (sent) {
+        // it's all queued, so the next delta is against it
+        frameNumber = (frameNumber + 1) & 0x0F;
+        framesToKeyframe =
+            isDelta ? (framesToKeyframe - 1) : (KEYFRAME_INTERVAL - 1);
+        for (uint8_t b = 0; b < STATUS_FIELDS_LENGTH; ++b) {
+            sentFields[b] = fields[b];
+        }
+    } else {
+        // it's lost. the receiver may see the next frame number and
+        // not know it missed anything, so make the next one a keyframe
+        framesToKeyframe = 0;
+    }
+
+    return sent;
+}
+#endif
+
+void StatusIndicators_sendStatusMesssage (void)
+{
+#if STATUS_STREAM
+    const PowerSwitches_state upsState = PowerSwitches_currentState();
+    const bool mainsOn = MainsMonitor_mainsOn();
+    const bool motion = MotionMonitor_motionDetected();
+#endif
+
+#if STATUS_FRAMES
+    const bool sent = (format != sf_text)
+        ? sendBinaryStatus()
+        : sendTextStatus();
+#else
+    const bool sent = sendTextStatus();
+#endif
+
+    // if it didn't fit in the transmit queue, the task tries again
+    // on a later tick
+    statusPending = !sent;
+#if STATUS_STREAM
+    if (sent) {
+        sentUPSState = upsState;
+        sentMainsOn = mainsOn;
+        sentMotion = motion;
+        nextStreamTime = SystemTime_uptimeSeconds() + streamPeriod;
+    }
+#endif
+}
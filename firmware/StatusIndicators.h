@@ -1,17 +1,57 @@
-//  Status Indicators
-//
-//  Controls two outputs that indicate the internal status of the UPS
-//  These outputs are connected to two LEDs and they also go to the
-//  box being powered for remote status reporting.
-//
-
-#ifndef STATUSINDICATORS_H
-#define STATUSINDICATORS_H
-
-extern void StatusIndicators_Initialize (void);
-
-extern void StatusIndicators_task (void);
-
-extern void StatusIndicators_sendStatusMesssage (void);
-
-#endif      // STATUSINDICATORS_H
+//  Status Indicators
+//
+//  Controls two outputs that indicate the internal status of the UPS
+//  These outputs are connected to two LEDs and they also go to the
+//  box being powered for remote status reporting.
+//
+
+#ifndef STATUSINDICATORS_H
+#define STATUSINDICATORS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// binary and delta status frames (the "telemetry" command). They
+// don't fit in the flash with the rest of the firmware, so they are
+// only built on request
+#ifndef STATUS_FRAMES
+#define STATUS_FRAMES false
+#endif
+
+// status streaming (the "stream" command), also only built on request
+#ifndef STATUS_STREAM
+#define STATUS_STREAM false
+#endif
+
+#if STATUS_FRAMES
+// how status messages are sent
+typedef enum StatusIndicators_format_enum {
+    sf_text,        // a line of ASCII (the default)
+    sf_binary,      // a COBS-framed binary frame (see StatusIndicators.c)
+    sf_delta        // binary frames with only the fields that changed
+} StatusIndicators_format;
+#endif
+
+extern void StatusIndicators_Initialize (void);
+
+extern void StatusIndicators_task (void);
+
+#if STATUS_FRAMES
+extern void StatusIndicators_setFormat (
+    const StatusIndicators_format newFormat);
+
+// makes the next delta format frame a full one
+extern void StatusIndicators_requestKeyframe (void);
+#endif
+
+#if STATUS_STREAM
+// sends status every <period> seconds, and whenever the UPS state,
+// mains or motion change. 0 stops it
+extern void StatusIndicators_stream (
+    const uint16_t period);
+#endif
+
+// sends status now, or on a later tick if the transmit queue is full
+extern void StatusIndicators_sendStatusMesssage (void);
+
+#endif      // STATUSINDICATORS_H
@@ -1,165 +1,238 @@
-//
-//  System Time keeper
-//
-//  Counts out ticks of time at 300Hz. This is used as the baud clock
-//  for software serial. The counter is 16 bits and rolls over at 65535.
-//
-//   Uses 8-bit Timer 0
-//
-// Two approaches considered for user-declared timers. The challenge comes
-// from the fact that the system time counter rolls over  
-//
-//  I: timer stores start time and end time
-//
-//  we need to account for the case when the future time rolls over
-//  the tick counter. future time must store start time and end time
-// if end time < start time
-//    // rollover case
-//    if current time < start time && // tick counter rolled over
-//       current time >= end time
-//       future time has arrived
-// else
-//    // normal case
-//    if current time >= end time
-//       future time has arrived
-//
-// II: timer stores time remaining and when it was last checked
-//
-//  advantage: timer duration independent of tick counter rollover time
-//  needs to be checked at least once per rollover time
-//  timer struct captures
-//   1. time remaining (32 bit)
-//   2. last check time (16 bit)
-// when we check - 
-//   if time remaining > 0
-//      if current time > last check time
-//         delta = current time - last check time
-//      else // rollover
-//         delta = twos-complement of last check time + current time
-//      if delta >= time remaining
-//         time remaining = 0L;
-//      else
-//         time remaining -= delta
-//         last check time = current time
-//   timer expired = time remaining == 0L
-
-#include "SystemTime.h"
-
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <avr/wdt.h>
-
-#if COUNT_MAJOR_CYCLES
-uint32_t majorCycleCounter;
-#endif
-
-static volatile SystemTime_tick ticksInMajorCycle = 0;
-static SystemTime_TickNotification notificationFunction;
-
-static bool shuttingDown = false;
-
-void SystemTime_Initialize (void)
-{
-    ticksInMajorCycle = 0;
-    notificationFunction = NULL;
-
-    // set up timer0 to fire interrupt 300 Hz (baud clock)
-    TCCR0A = (TCCR0A & 0xFC) | 2;   // set CTC mode
-    TCCR0B = (TCCR0B & 0xF8) | 3;   // prescale by 64
-    OCR0A = 52;  // with 1MHz clock and 64 prescale this is 1/300 second
-    TIMSK0 |= (1 << OCIE0A);// enable timer compare match interrupt
-
-}
-
-SystemTime_tick SystemTime_currentTick (void)
-{
-    // we disable interrupts during read of secondsSinceReset because
-    // it is updated in an interrupt handler
-    char SREGSave;
-    SREGSave = SREG;
-    cli();
-    const SystemTime_tick curTick = ticksInMajorCycle;
-    SREG = SREGSave;
-
-    return curTick;
-}
-
-void SystemTime_startTimer (
-    const uint32_t duration,
-    SystemTime_Timer *timer)
-{
-    timer->lastCheckTime = SystemTime_currentTick();
-    timer->timeRemaining = duration;
-}
-
-void SystemTime_cancelTimer (
-    SystemTime_Timer *timer)
-{
-    timer->timeRemaining = 0;
-}
-
-bool SystemTime_timerHasExpired (
-    SystemTime_Timer *timer)
-{
-    bool expired = false;
-
-    if (timer->timeRemaining > 0) {
-        SystemTime_tick curTime = SystemTime_currentTick();
-        if (curTime != timer->lastCheckTime) {
-            // at least one tick has elapsed since last check
-            uint16_t delta;
-            if (curTime > timer->lastCheckTime) {
-                delta = curTime - timer->lastCheckTime;
-            } else {    // curTime < lastCheckTime -> rollover
-                delta = (~(timer->lastCheckTime)) + 1 + curTime;
-            }
-            if (delta >= timer->timeRemaining) {
-                timer->timeRemaining = 0L;
-                expired = true;
-            } else {
-                timer->timeRemaining -= delta;
-                timer->lastCheckTime = curTime;
-            }
-        }
-    } else {
-        expired = true;
-    }
-
-    return expired;
-}
-
-void SystemTime_commenceShutdown (void)
-{
-    shuttingDown = true;
-    wdt_enable(WDTO_8S);
-}
-
-bool SystemTime_shuttingDown (void)
-{
-    return shuttingDown;
-}
-
-void SystemTime_task (void)
-{
-    if (shuttingDown) {
-        // LED_OUTPORT |= (1 << LED_PIN);
-    } else {
-        // reset the watchdog timer
-        wdt_reset();
-    }
-}
-
-void SystemTime_registerForTickNotification (
-    SystemTime_TickNotification notificationFcn)
-{
-    notificationFunction = notificationFcn;
-}
-
-ISR(SIG_OUTPUT_COMPARE0A, ISR_BLOCK)
-{
-    ++ticksInMajorCycle;
-
-    if (notificationFunction != NULL) {
-        notificationFunction();
-    }
-}
+//
+//  System Time keeper
+//
+//  Counts out ticks of time at 300Hz. The uptime counter is 32 bits,
+//  which is about 165 days of ticks. Seconds are worked out from it
+//  when they are asked for, which keeps the tick interrupt short.
+//
+//   Uses 8-bit Timer 0 (or 16-bit Timer 1's compare B, see
+//   SYSTEMTIME_TICK_ON_TIMER1)
+//
+// The counter is updated in the tick interrupt. Rather than disabling
+// interrupts, readers read it twice and try again if the two reads
+// differ. An interrupt can land in the middle of at most one of
+// the reads (ticks are 3.3mS apart), so two equal reads are a value
+// the counter really had.
+//
+// A timer stores the uptime it expires at. It has expired when the
+// uptime has reached the deadline, compared as a signed 32-bit
+// difference so it is right across uptime rollover. The expiry is
+// latched when it is seen, so a timer that has expired stays expired.
+// Tasks that need to run every so often delay themselves with the
+// TaskScheduler rather than use a timer.
+//
+// Other modules can run work at the tick rate by registering a tick
+// hook. The hook table is indexed by priority, so the interrupt just
+// walks it in order. Each hook has a divider (it runs every divider
+// ticks). With SYSTEMTIME_HOOK_USAGE
+// each also has a tally of the time spent inside it, which is how we
+// see what each one costs the ISR. The time is taken from Timer 1,
+// which runs free at the CPU clock for the serial port whichever timer
+// the tick is on. A Timer0 count (64uS) would be longer than most
+// hooks take.
+
+#include "SystemTime.h"
+#include "TaskScheduler.h"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/wdt.h>
+
+#if COUNT_MAJOR_CYCLES
+uint32_t majorCycleCounter;
+#endif
+
+// CPU clocks between ticks, when they are scheduled on Timer 1 (which
+// makes the tick 0.01% fast)
+#define TIMER1_TICK_CLOCKS ((uint16_t)(F_CPU / SYSTEMTIME_TICKS_PER_SECOND))
+// Timer 1 counts (CPU clocks) in a microsecond
+#define TIMER1_COUNTS_PER_US ((uint16_t)(F_CPU / 1000000UL))
+
+// the watchdog (500mS, see LightingUPS.c) is reset at least this often
+#define WATCHDOG_RESET_TICKS (SYSTEMTIME_TICKS_PER_SECOND / 10)
+
+typedef struct {
+    SystemTime_TickNotification hookFunction;   // NULL if unused
+    uint8_t divider;
+    uint8_t countdown;      // ticks until the hook runs again
+#if SYSTEMTIME_HOOK_USAGE
+    uint16_t maxUs;         // longest call, in microseconds
+    uint32_t totalUs;       // microseconds spent in the hook
+#endif
+} TickHook;
+
+static volatile SystemTime_uptime uptimeTicks = 0;
+static TickHook tickHooks[SYSTEMTIME_MAX_TICK_HOOKS];
+
+static bool shuttingDown = false;
+
+void SystemTime_Initialize (void)
+{
+    uptimeTicks = 0;
+    memset(tickHooks, 0, sizeof(tickHooks));
+
+#if SYSTEMTIME_TICK_ON_TIMER1
+    // set up timer1 to run free at the CPU clock, and schedule the
+    // first tick on compare B
+    TCCR1A &= 0xFC;                 // set normal mode (WGM11:10)
+    TCCR1B &= 0xE7;                 // set normal mode (WGM13:12)
+    TCCR1B = (TCCR1B & 0xF8) | 1;   // no prescaling
+    OCR1B = TCNT1 + TIMER1_TICK_CLOCKS;
+    TIFR1 = (1 << OCF1B);   // "clear" the timer compare flag
+    TIMSK1 |= (1 << OCIE1B);// enable timer compare match interrupt
+#else
+    // set up timer0 to fire interrupt 300 Hz
+    TCCR0A = (TCCR0A & 0xFC) | 2;   // set CTC mode
+    TCCR0B = (TCCR0B & 0xF8) | 3;   // prescale by 64
+    OCR0A = 52;  // with 1MHz clock and 64 prescale this is 1/300 second
+    TIMSK0 |= (1 << OCIE0A);// enable timer compare match interrupt
+#endif
+}
+
+SystemTime_tick SystemTime_currentTick (void)
+{
+    return (SystemTime_tick)SystemTime_uptimeTicks();
+}
+
+SystemTime_uptime SystemTime_uptimeTicks (void)
+{
+    SystemTime_uptime ticks = uptimeTicks;
+    SystemTime_uptime check;
+    while ((check = uptimeTicks) != ticks) {
+        ticks = check;
+    }
+
+    return ticks;
+}
+
+uint32_t SystemTime_uptimeSeconds (void)
+{
+    return SystemTime_uptimeTicks() / SYSTEMTIME_TICKS_PER_SECOND;
+}
+
+void SystemTime_startTimer (
+    const uint32_t duration,
+    SystemTime_Timer *timer)
+{
+    timer->deadline = SystemTime_uptimeTicks() + duration;
+    timer->running = true;
+}
+
+void SystemTime_cancelTimer (
+    SystemTime_Timer *timer)
+{
+    timer->running = false;
+}
+
+bool SystemTime_timerHasExpired (
+    SystemTime_Timer *timer)
+{
+    if (timer->running &&
+        (((int32_t)(SystemTime_uptimeTicks() - timer->deadline)) >= 0)) {
+        // latch the expiry so it can't be undone by uptime rollover
+        timer->running = false;
+    }
+
+    return !timer->running;
+}
+
+void SystemTime_commenceShutdown (void)
+{
+    shuttingDown = true;
+    wdt_enable(WDTO_8S);
+}
+
+bool SystemTime_shuttingDown (void)
+{
+    return shuttingDown;
+}
+
+void SystemTime_task (void)
+{
+    if (shuttingDown) {
+        // LED_OUTPORT |= (1 << LED_PIN);
+    } else {
+        // reset the watchdog timer
+        wdt_reset();
+    }
+
+    // in time for the watchdog
+    TaskScheduler_delayCurrentTask(WATCHDOG_RESET_TICKS);
+}
+
+bool SystemTime_registerTickHook (
+    SystemTime_TickNotification hookFunction,
+    const uint8_t priority,
+    const uint8_t divider)
+{
+    bool registered = false;
+
+    if ((priority < SYSTEMTIME_MAX_TICK_HOOKS) &&
+        (tickHooks[priority].hookFunction == NULL)) {
+        // hooks are registered before interrupts are enabled
+        TickHook* hook = &tickHooks[priority];
+        hook->hookFunction = hookFunction;
+        hook->divider = divider;
+        hook->countdown = divider;
+        registered = true;
+    }
+
+    return registered;
+}
+
+#if SYSTEMTIME_HOOK_USAGE
+bool SystemTime_getTickHookUsage (
+    const uint8_t priority,
+    uint8_t* divider,
+    uint32_t* totalUs,
+    uint16_t* maxUs)
+{
+    const TickHook* hook = &tickHooks[priority];
+    *divider = hook->divider;
+
+    // usage is updated in the tick interrupt handler
+    char SREGSave;
+    SREGSave = SREG;
+    cli();
+    *totalUs = hook->totalUs;
+    *maxUs = hook->maxUs;
+    SREG = SREGSave;
+
+    return (hook->hookFunction != NULL);
+}
+#endif
+
+#if SYSTEMTIME_TICK_ON_TIMER1
+ISR(SIG_OUTPUT_COMPARE1B, ISR_BLOCK)
+{
+    // schedule the next tick
+    OCR1B += TIMER1_TICK_CLOCKS;
+#else
+ISR(SIG_OUTPUT_COMPARE0A, ISR_BLOCK)
+{
+#endif
+    ++uptimeTicks;
+
+    for (uint8_t h = 0; h < SYSTEMTIME_MAX_TICK_HOOKS; ++h) {
+        TickHook* hook = &tickHooks[h];
+        if ((hook->hookFunction != NULL) && (--hook->countdown == 0)) {
+            hook->countdown = hook->divider;
+
+#if SYSTEMTIME_HOOK_USAGE
+            const uint16_t startCount = TCNT1;
+            hook->hookFunction();
+            const uint16_t endCount = TCNT1;
+
+            // Timer 1 runs free, so the difference is right across a wrap
+            const uint16_t us =
+                (uint16_t)(endCount - startCount) / TIMER1_COUNTS_PER_US;
+            hook->totalUs += us;
+            if (us > hook->maxUs) {
+                hook->maxUs = us;
+            }
+#else
+            hook->hookFunction();
+#endif
+        }
+    }
+}
@@ -1,55 +1,110 @@
-//
-//  SystemTime
-//
-//  Counts out ticks of time at 300Hz. This is used as the baud clock
-//  for software serial tx.
-//  Resets the watchdog timer
-//
-#ifndef SYSTEMTIME_H
-#define SYSTEMTIME_H
-
-#include <stdint.h>
-#include <stdbool.h>
-#include <string.h>
-#include <stddef.h>
-
-#define SYSTEMTIME_TICKS_PER_SECOND 300
-
-#define COUNT_MAJOR_CYCLES false
-
-typedef uint16_t SystemTime_tick;
-
-typedef struct Timer_struct {
-    uint32_t timeRemaining;
-    uint16_t lastCheckTime;
-} SystemTime_Timer;
-
-// prototype for functions that clients supply to
-// get notification when a tick occurs
-typedef void (*SystemTime_TickNotification)(void);
-
-extern void SystemTime_Initialize (void);
-
-extern void SystemTime_task (void);
-
-extern void SystemTime_registerForTickNotification (
-    SystemTime_TickNotification notificationFcn);
-
-extern SystemTime_tick SystemTime_currentTick (void);
-
-extern void SystemTime_startTimer (
-    const uint32_t duration,
-    SystemTime_Timer *timer);
-extern void SystemTime_cancelTimer (
-    SystemTime_Timer *timer);
-extern bool SystemTime_timerHasExpired (
-    SystemTime_Timer *timer);
-
-extern void SystemTime_commenceShutdown (void);
-extern bool SystemTime_shuttingDown (void);
-
-#if COUNT_MAJOR_CYCLES
-extern uint32_t majorCycleCounter;
-#endif
-
-#endif  // SYSTEMTIME_H
+//
+//  SystemTime
+//
+//  Counts out ticks of time at 300Hz. This is used to start ADC
+//  conversions.
+//  Keeps a 32-bit uptime (ticks since reset) that can be read without
+//  disabling interrupts
+//  Provides polled timers
+//  Resets the watchdog timer
+//
+#ifndef SYSTEMTIME_H
+#define SYSTEMTIME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include "SoftwareSerialTx.h"
+
+#define SYSTEMTIME_TICKS_PER_SECOND 300
+
+// the tick is Timer 0's compare match A, unless the USI serial port
+// needs Timer 0 for its bit clock. Then it is Timer 1's compare match
+// B, scheduled on the free-running Timer 1
+#define SYSTEMTIME_TICK_ON_TIMER1 SOFTWARESERIAL_USI
+
+#define COUNT_MAJOR_CYCLES false
+
+// number of entries in the tick hook table. A hook's priority is its
+// place in the table, so there is room for one hook at each priority
+// from 0 to SYSTEMTIME_MAX_TICK_HOOKS - 1
+#define SYSTEMTIME_MAX_TICK_HOOKS 4
+
+// time the tick hooks (for the "isr" command). A diagnostic: it is
+// off in the shipped firmware, to save flash, RAM and tick interrupt
+// time
+#ifndef SYSTEMTIME_HOOK_USAGE
+#define SYSTEMTIME_HOOK_USAGE false
+#endif
+
+// short tick count, for intervals under TASKSCHEDULER_MAX_DELAY.
+// this is the low 16 bits of the uptime
+typedef uint16_t SystemTime_tick;
+
+// ticks since reset. rolls over after about 165 days
+typedef uint32_t SystemTime_uptime;
+
+// a timer runs until the uptime reaches its deadline. Durations and
+// the time a timer goes unchecked must each be under 2^31 ticks
+// (about 80 days)
+typedef struct Timer_struct {
+    SystemTime_uptime deadline;
+    bool running;
+} SystemTime_Timer;
+
+// prototype for functions that clients supply to
+// get notification when a tick occurs
+typedef void (*SystemTime_TickNotification)(void);
+
+extern void SystemTime_Initialize (void);
+
+extern void SystemTime_task (void);
+
+// adds a hook that is called from the tick interrupt every <divider>
+// (1..255) ticks. Hooks are called in order of priority, 0 first.
+// Keep hooks short - they run with interrupts disabled.
+// called during initialization, before interrupts are enabled
+// returns false if the priority is out of range or already taken
+extern bool SystemTime_registerTickHook (
+    SystemTime_TickNotification hookFunction,
+    const uint8_t priority,
+    const uint8_t divider);
+
+#if SYSTEMTIME_HOOK_USAGE
+// gets the divider of the tick hook at the given priority, and the
+// microseconds it has used inside the tick interrupt: in total, and
+// its longest single call.
+// returns false if there is no hook at that priority
+extern bool SystemTime_getTickHookUsage (
+    const uint8_t priority,
+    uint8_t* divider,
+    uint32_t* totalUs,
+    uint16_t* maxUs);
+#endif
+
+extern SystemTime_tick SystemTime_currentTick (void);
+
+extern SystemTime_uptime SystemTime_uptimeTicks (void);
+
+// the uptime in whole seconds, for stamping events and telemetry
+extern uint32_t SystemTime_uptimeSeconds (void);
+
+// timers measure from the uptime, so they don't need to be checked
+// at any particular rate. A cancelled timer reads as expired
+extern void SystemTime_startTimer (
+    const uint32_t duration,
+    SystemTime_Timer *timer);
+extern void SystemTime_cancelTimer (
+    SystemTime_Timer *timer);
+extern bool SystemTime_timerHasExpired (
+    SystemTime_Timer *timer);
+
+extern void SystemTime_commenceShutdown (void);
+extern bool SystemTime_shuttingDown (void);
+
+#if COUNT_MAJOR_CYCLES
+extern uint32_t majorCycleCounter;
+#endif
+
+#endif  // SYSTEMTIME_H
@@ -0,0 +1,146 @@
+//
+//  Task Profiler
+//
+//  How it works:
+//      Statistics are kept per scheduler task index. The run count and
+//      the running total halve together when the count would overflow,
+//      so the mean keeps tracking recent behavior. Histogram buckets
+//      saturate at 255 by halving all of the task's buckets, which
+//      keeps the shape of the distribution.
+//
+//      A report of all the tasks is sent by TaskProfiler_task, which
+//      waits for the transmitter to go idle before each line so that
+//      the line fits in the transmit queue.
+//
+
+#include "TaskProfiler.h"
+
+#if PROFILE_TASKS
+
+#include "TaskScheduler.h"
+#include "Console.h"
+#include "SoftwareSerialTx.h"
+#include "StringUtils.h"
+
+// how often the report task looks for the transmitter to go idle
+#define REPORT_POLL_INTERVAL (SYSTEMTIME_TICKS_PER_SECOND / 20)
+
+#define NO_REPORT 0xFF
+
+typedef struct {
+    uint16_t minCycles;
+    uint16_t maxCycles;
+    uint32_t totalCycles;
+    uint16_t numRuns;
+    uint8_t histogram[TASKPROFILER_HISTOGRAM_BUCKETS];
+} TaskProfile;
+
+// state variables
+static TaskProfile profiles[TASKSCHEDULER_MAX_TASKS];
+static uint8_t reportIndex;     // next task to report, or NO_REPORT
+
+void TaskProfiler_Initialize (void)
+{
+    TaskProfiler_reset();
+    reportIndex = NO_REPORT;
+}
+
+void TaskProfiler_task (void)
+{
+    if (reportIndex < TaskScheduler_numTasks()) {
+        if (SoftwareSerialTx_isIdle()) {
+            CharString_define(64, profStr);
+            TaskProfiler_appendProfile(reportIndex, &profStr);
+            Console_printLineCS(&profStr);
+            ++reportIndex;
+        }
+        TaskScheduler_delayCurrentTask(REPORT_POLL_INTERVAL);
+    } else {
+        reportIndex = NO_REPORT;
+    }
+}
+
+void TaskProfiler_startReport (void)
+{
+    reportIndex = 0;
+    TaskScheduler_wakeTask(TaskProfiler_task);
+}
+
+void TaskProfiler_reset (void)
+{
+    for (uint8_t t = 0; t < TASKSCHEDULER_MAX_TASKS; ++t) {
+        TaskProfile* profile = &profiles[t];
+        profile->minCycles = 65535;
+        profile->maxCycles = 0;
+        profile->totalCycles = 0;
+        profile->numRuns = 0;
+        for (uint8_t b = 0; b < TASKPROFILER_HISTOGRAM_BUCKETS; ++b) {
+            profile->histogram[b] = 0;
+        }
+    }
+}
+
+void TaskProfiler_record (
+    const uint8_t taskIndex,
+    const uint16_t cycles)
+{
+    TaskProfile* profile = &profiles[taskIndex];
+
+    if (cycles < profile->minCycles) {
+        profile->minCycles = cycles;
+    }
+    if (cycles > profile->maxCycles) {
+        profile->maxCycles = cycles;
+    }
+
+    if (profile->numRuns == 65535) {
+        profile->numRuns >>= 1;
+        profile->totalCycles >>= 1;
+    }
+    ++profile->numRuns;
+    profile->totalCycles += cycles;
+
+    // log2 bucket: under 64 cycles is bucket 0
+    uint16_t c = cycles >> 6;
+    uint8_t bucket = 0;
+    while ((c != 0) && (bucket < (TASKPROFILER_HISTOGRAM_BUCKETS - 1))) {
+        c >>= 1;
+        ++bucket;
+    }
+    if (profile->histogram[bucket] == 255) {
+        for (uint8_t b = 0; b < TASKPROFILER_HISTOGRAM_BUCKETS; ++b) {
+            profile->histogram[b] >>= 1;
+        }
+    }
+    ++profile->histogram[bucket];
+}
+
+bool TaskProfiler_appendProfile (
+    const uint8_t taskIndex,
+    CharString_t* profStr)
+{
+    if (taskIndex >= TaskScheduler_numTasks()) {
+        return false;
+    }
+
+    const TaskProfile* profile = &profiles[taskIndex];
+    StringUtils_appendDecimal(taskIndex, 0, profStr);
+    CharString_appendP(PSTR(" N"), profStr);
+    StringUtils_appendDecimal32(profile->numRuns, profStr);
+    if (profile->numRuns > 0) {
+        CharString_appendP(PSTR(" L"), profStr);
+        StringUtils_appendDecimal32(profile->minCycles, profStr);
+        CharString_appendP(PSTR(" A"), profStr);
+        StringUtils_appendDecimal32(profile->totalCycles / profile->numRuns, profStr);
+        CharString_appendP(PSTR(" H"), profStr);
+        StringUtils_appendDecimal32(profile->maxCycles, profStr);
+        for (uint8_t b = 0; b < TASKPROFILER_HISTOGRAM_BUCKETS; ++b) {
+            CharString_appendC((b == 0) ? ' ' : ',', profStr);
+            StringUtils_appendDecimal(profile->histogram[b], 0, profStr);
+        }
+    }
+
+    return true;
+}
+
+#endif  // PROFILE_TASKS
@@ -0,0 +1,77 @@
+//
+//  Task Profiler
+//
+//  Measures how long each scheduled task takes to run. The scheduler
+//  stamps each task call with Timer 1 (free-running at the CPU clock,
+//  1uS per count at 1MHz). Per task it keeps the minimum, maximum and
+//  mean execution time and a log2 histogram.
+//
+//  The "prof <task>" console command prints one task's line, tasks
+//  being numbered in the order they were added to the scheduler:
+//      <task> N<runs> L<min> A<mean> H<max> <histogram>
+//  Plain "prof" prints every task's line. The whole table doesn't fit
+//  in the transmit queue, so TaskProfiler_task sends it a line at a
+//  time, each once the transmitter has gone idle.
+//  Histogram bucket 0 counts runs under 64uS, bucket n counts runs
+//  from 2^(n+5) to 2^(n+6)uS, and the last bucket everything longer.
+//  Times include any interrupts serviced while the task ran.
+//
+//  Profiling costs about 200 bytes of RAM, so it is compiled in only
+//  when PROFILE_TASKS is true.
+//
+#ifndef TASKPROFILER_H
+#define TASKPROFILER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "CharString.h"
+
+#ifndef PROFILE_TASKS
+#define PROFILE_TASKS false
+#endif
+
+#define TASKPROFILER_HISTOGRAM_BUCKETS 8
+
+#if PROFILE_TASKS
+
+extern void TaskProfiler_Initialize (void);
+
+// sends the lines of a report that has been started
+extern void TaskProfiler_task (void);
+
+// returns the current Timer 1 count
+static inline uint16_t TaskProfiler_stamp (void)
+{
+    // 16-bit timer reads use a temp register shared with interrupt
+    // handlers, so read it with interrupts disabled
+    char SREGSave;
+    SREGSave = SREG;
+    cli();
+    const uint16_t stamp = TCNT1;
+    SREG = SREGSave;
+
+    return stamp;
+}
+
+// records one run of the task with the given scheduler index
+extern void TaskProfiler_record (
+    const uint8_t taskIndex,
+    const uint16_t cycles);
+
+// clears all the statistics
+extern void TaskProfiler_reset (void);
+
+// appends the statistics line of the task with the given scheduler
+// index. returns false if there is no such task
+extern bool TaskProfiler_appendProfile (
+    const uint8_t taskIndex,
+    CharString_t* profStr);
+
+// starts sending the statistics lines of all the tasks
+extern void TaskProfiler_startReport (void);
+
+#endif  // PROFILE_TASKS
+
+#endif  // TASKPROFILER_H
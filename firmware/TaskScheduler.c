@@ -0,0 +1,171 @@
+//
+//  Task Scheduler
+//
+//  How it works:
+//      The task list is a table the application passes in. The
+//      scheduler keeps the rest of each task's state alongside it.
+//      Each task has the tick at which it is next due and a flag that
+//      says it is suspended, and a flag that says it has been woken.
+//      Waking a task also sets a flag for the scheduler as a whole.
+//      Each pass clears that flag and runs, in order, every task that
+//      was woken or whose due tick has arrived. A task woken while the
+//      pass is running is picked up on the next pass. A task is
+//      suspended as it is run, and only becomes due again if it delays
+//      itself while it is running. Otherwise it waits for an interrupt
+//      handler (or another task) to wake it, so the tasks don't run on
+//      every tick for nothing.
+//
+//      After the pass, if no task was woken and the tick hasn't moved
+//      on, the CPU goes into idle sleep. The SystemTime tick (or any
+//      other interrupt) wakes it up again. Idle mode keeps the timers,
+//      ADC and pin change interrupts running. When ADCManager has a
+//      conversion waiting to be done in the ADC Noise Reduction mode,
+//      the CPU sleeps in that mode instead, and the end of the
+//      conversion wakes it up. The serial port's bit clock stops in
+//      that mode too, so while it is sending or receiving the
+//      conversion is done in idle mode.
+//
+//      Due ticks are compared as a signed 16-bit difference so they
+//      survive SystemTime tick rollover.
+//
+
+#include "TaskScheduler.h"
+#include "TaskProfiler.h"
+#include "ADCManager.h"
+#if ADCMANAGER_SLEEP
+#include "SoftwareSerialTx.h"
+#include "SoftwareSerialRx.h"
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+typedef struct {
+    SystemTime_tick dueTick;
+    bool suspended;
+    volatile bool woken;
+} TaskEntry;
+
+// state variables
+static const TaskScheduler_Task* taskList;
+static TaskEntry tasks[TASKSCHEDULER_MAX_TASKS];
+static uint8_t numTasks;
+static volatile bool anyWoken;          // some task has been woken
+static TaskEntry* currentTask;
+static SystemTime_tick currentTick;     // tick at the start of the pass
+
+#if ADCMANAGER_SLEEP
+// the serial port's bit clock stops in the ADC noise reduction mode
+static bool serialIsBusy (void)
+{
+    return !SoftwareSerialTx_isIdle() || !SoftwareSerialRx_isIdle();
+}
+#endif
+
+void TaskScheduler_Initialize (
+    const TaskScheduler_Task* newTaskList,
+    const uint8_t newNumTasks)
+{
+    taskList = newTaskList;
+    numTasks = newNumTasks;
+    // the tick is 0 until interrupts are enabled, so every task is
+    // due on the first pass
+    memset(tasks, 0, sizeof(tasks));
+    anyWoken = false;
+    currentTask = NULL;
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+uint8_t TaskScheduler_numTasks (void)
+{
+    return numTasks;
+}
+
+void TaskScheduler_delayCurrentTask (
+    const SystemTime_tick ticks)
+{
+    if (currentTask != NULL) {
+        currentTask->dueTick = currentTick + ticks;
+        currentTask->suspended = false;
+    }
+}
+
+void TaskScheduler_suspendCurrentTask (void)
+{
+    if (currentTask != NULL) {
+        currentTask->suspended = true;
+    }
+}
+
+void TaskScheduler_wakeTask (
+    TaskScheduler_Task task)
+{
+    TaskEntry* entry = tasks;
+    for (uint8_t t = 0; t < numTasks; ++t, ++entry) {
+        if (taskList[t] == task) {
+            // single byte writes, so interrupts can stay enabled
+            entry->woken = true;
+            anyWoken = true;
+            break;
+        }
+    }
+}
+
+void TaskScheduler_task (void)
+{
+    currentTick = SystemTime_currentTick();
+
+    // a task woken from here on keeps the CPU from going to sleep
+    anyWoken = false;
+
+    TaskEntry* entry = tasks;
+    for (uint8_t t = 0; t < numTasks; ++t, ++entry) {
+        if (entry->woken ||
+            ((!entry->suspended) &&
+             (((int16_t)(currentTick - entry->dueTick)) >= 0))) {
+            // the task waits to be woken unless it delays itself
+            entry->woken = false;
+            entry->suspended = true;
+            currentTask = entry;
+            const TaskScheduler_Task task = taskList[t];
+#if PROFILE_TASKS
+            const uint16_t startStamp = TaskProfiler_stamp();
+            task();
+            TaskProfiler_record(t, TaskProfiler_stamp() - startStamp);
+#else
+            task();
+#endif
+        }
+    }
+    currentTask = NULL;
+
+    // sleep until the next interrupt, unless something is already due.
+    // From cli() on interrupts stay disabled until sleep_cpu(), so a
+    // wakeup can't slip in between the last check and going to sleep.
+#if ADCMANAGER_SLEEP
+    // the sleep mode is worked out with interrupts enabled, to keep the
+    // time they are off short.
+    const uint8_t sleepMode = ADCManager_sleepMode(serialIsBusy());
+    set_sleep_mode(sleepMode);
+#endif
+    cli();
+    if ((!anyWoken) &&
+        (SystemTime_currentTick() == currentTick)) {
+#if ADCMANAGER_SLEEP
+        if ((sleepMode == SLEEP_MODE_ADC) && serialIsBusy()) {
+            // the serial port started up since. it needs its clock
+            set_sleep_mode(ADCManager_sleepMode(true));
+        }
+#endif
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    } else {
+        // the noise reduction conversion, if any, waits for the next
+        // sleep
+        sei();
+    }
+}
@@ -0,0 +1,62 @@
+//
+//  Task Scheduler
+//
+//  Runs the application tasks from a small run queue instead of calling
+//  every task on every pass of the main loop. A task runs when the tick
+//  it asked to run at has arrived, or when it has been woken (usually
+//  from an interrupt handler). When nothing is due the CPU is put into
+//  idle sleep until the next interrupt.
+//
+//  A task that has run waits to be woken, unless it delayed itself
+//  while it was running. A task that has to poll something delays
+//  itself by as long as it can stand to wait.
+//
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "SystemTime.h"
+#include "TaskProfiler.h"
+
+// room for the tasks in LightingUPS.c's list, and the profiler's
+#define TASKSCHEDULER_MAX_TASKS (10 + PROFILE_TASKS)
+
+// longest delay (in ticks) a task may ask for
+#define TASKSCHEDULER_MAX_DELAY 32767
+
+typedef void (*TaskScheduler_Task)(void);
+
+// called once at power-up, before interrupts are enabled. The task
+// list is a table of up to TASKSCHEDULER_MAX_TASKS tasks (the caller
+// checks that it fits, at compile time), which are run in that order.
+// It has to stay in place, since the scheduler doesn't copy it. Each
+// task runs on the first pass
+extern void TaskScheduler_Initialize (
+    const TaskScheduler_Task* taskList,
+    const uint8_t numTasks);
+
+// the number of tasks in the list
+extern uint8_t TaskScheduler_numTasks (void);
+
+// called by the running task: don't run it again for the given number
+// of ticks (1..TASKSCHEDULER_MAX_DELAY) unless it is woken sooner
+extern void TaskScheduler_delayCurrentTask (
+    const SystemTime_tick ticks);
+
+// called by the running task: don't run it again until it is woken.
+// this is what happens to a task that doesn't delay itself, so it
+// only needs calling to undo a delay
+extern void TaskScheduler_suspendCurrentTask (void);
+
+// makes the given task run on the next pass.
+// may be called from an interrupt handler
+extern void TaskScheduler_wakeTask (
+    TaskScheduler_Task task);
+
+// runs the tasks that are due, then sleeps until the next interrupt
+// if none were woken in the meantime.
+// called in each iteration of the mainloop
+extern void TaskScheduler_task (void);
+
+#endif  // TASKSCHEDULER_H
@@ -0,0 +1,440 @@
+//
+//  Host Board Model
+//
+#include "HostBoard.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "HostHAL.h"
+#include <avr/io.h>
+#include "SoftwareSerialTx.h"
+
+#define SUPPLY_VOLTAGE          4.99
+#define BATTERY_DIVIDER_RATIO   (10.0 / (10.0 + 21.7))
+// voltage drop across the battery's internal resistance at the LED load
+#define BATTERY_SAG_VOLTS       0.25
+// the firmware's default calibration: counts + (-266) = degrees C
+#define TEMPERATURE_SENSOR_VOLTS(c) ((((c) + 266.0) * 1.1) / 1024.0)
+
+// light the photocell sees from each source, 0..1
+#define ROOM_LIGHTS_LEVEL       0.6
+#define LED_LIGHT_LEVEL         0.5
+#define STRAY_LIGHT_LEVEL       0.02
+// the photocell follows a change in light with this time constant, so
+// it settles (to within 5%) in about 100mS. While it is moving its
+// input is updated every millisecond
+#define PHOTOCELL_TIME_CONSTANT (HOSTBOARD_CYCLES_PER_SECOND * 0.033)
+#define PHOTOCELL_STEP          (HOSTBOARD_CYCLES_PER_SECOND / 1000)
+#define PHOTOCELL_SETTLED       0.0005
+
+#define MAINS_HALF_CYCLE        (HOSTBOARD_CYCLES_PER_SECOND / 120)
+#define OPTO_ON_TIME            ((MAINS_HALF_CYCLE * 3) / 5)
+
+#define BAUD_RATE SOFTWARESERIAL_BAUD_RATE
+#define BIT_TIME (HOSTBOARD_CYCLES_PER_SECOND / BAUD_RATE)
+#define MAX_LINE_LENGTH 80
+
+// pins
+#define MAINS_OPTO_PIN  PA7
+#if SOFTWARESERIAL_USI
+// the USI's DO and DI
+#define TX_PIN          PA5
+#define RX_PIN          PA6
+#else
+#define TX_PIN          PA6
+#define RX_PIN          PA5
+#endif
+#define PUSHBUTTON_PIN  PA4
+#define ADAPTER_FET_PIN PA2
+#define BATTERY_FET_PIN PA1
+#define MOTION_PIN      PB2
+#define MODE_SWITCH_PIN PB1
+#define BATTERY_ADC     0
+#define PHOTOCELL_ADC   3
+#define TEMPERATURE_ADC 8
+
+typedef struct {
+    uint64_t nextSample;    // HOSTHAL_NEVER when idle
+    uint8_t bitNumber;      // 0 start, 1..8 data, 9 stop
+    uint8_t dataByte;
+    char line[MAX_LINE_LENGTH];
+    uint8_t lineLength;
+    bool inFrame;           // between a frame's zero bytes
+} TxDecoder;
+
+typedef struct {
+    char text[MAX_LINE_LENGTH];
+    uint8_t position;
+    uint8_t bitNumber;      // 0 start, 1..8 data, 9 stop
+    uint64_t nextBit;       // HOSTHAL_NEVER when idle
+    uint64_t bitTime;       // cycles
+} RxSender;
+
+// state variables
+static const HostBoard_Listener* listener;
+static bool mainsOn;
+static double batteryVolts;
+static double ambientLight;
+static bool roomLightsOn;
+static double temperature;
+static double serialSkew;           // percent
+static double photocellTarget;      // light falling on the photocell, 0..1
+static double photocellLevel;       // ...and what it shows
+static uint64_t photocellUpdatedAt;
+static uint64_t nextPhotocellStep;  // HOSTHAL_NEVER when settled
+static uint64_t nextOptoEdge;
+static bool optoLow;
+static TxDecoder tx;
+static RxSender rx;
+static bool batteryFETOn;
+static bool adapterFETOn;
+
+static bool batteryCarriesLoad (void)
+{
+    return batteryFETOn && !(adapterFETOn && mainsOn);
+}
+
+// moves the photocell toward the light falling on it, up to <cycle>
+static void movePhotocell (
+    const uint64_t cycle)
+{
+    if (cycle > photocellUpdatedAt) {
+        photocellLevel = photocellTarget + (photocellLevel - photocellTarget) *
+            exp(-(double)(cycle - photocellUpdatedAt) / PHOTOCELL_TIME_CONSTANT);
+        photocellUpdatedAt = cycle;
+    }
+    if (fabs(photocellLevel - photocellTarget) < PHOTOCELL_SETTLED) {
+        photocellLevel = photocellTarget;
+        nextPhotocellStep = HOSTHAL_NEVER;
+    } else {
+        nextPhotocellStep = cycle + PHOTOCELL_STEP;
+    }
+    HostHAL_setAnalogInput(PHOTOCELL_ADC, photocellLevel * SUPPLY_VOLTAGE);
+}
+
+static void updateAnalogInputs (void)
+{
+    double lightLevel = ambientLight + STRAY_LIGHT_LEVEL;
+    if (roomLightsOn && mainsOn) {
+        lightLevel += ROOM_LIGHTS_LEVEL;
+    }
+    if (batteryFETOn || adapterFETOn) {
+        lightLevel += LED_LIGHT_LEVEL;
+    }
+
+    HostHAL_setAnalogInput(BATTERY_ADC, HostBoard_batteryVolts() * BATTERY_DIVIDER_RATIO);
+    movePhotocell(HostHAL_cycles());
+    photocellTarget = fmin(1.0, lightLevel);
+    movePhotocell(HostHAL_cycles());
+    HostHAL_setAnalogInput(TEMPERATURE_ADC, TEMPERATURE_SENSOR_VOLTS(temperature));
+}
+
+static void updateOptoisolator (
+    const uint64_t cycle)
+{
+    if (mainsOn) {
+        // low while the mains voltage is high enough to light the
+        // optoisolator's LED, in both half cycles
+        optoLow = !optoLow;
+        nextOptoEdge = cycle + (optoLow ? OPTO_ON_TIME : (MAINS_HALF_CYCLE - OPTO_ON_TIME));
+    } else {
+        optoLow = false;
+        nextOptoEdge = HOSTHAL_NEVER;
+    }
+    HostHAL_setPinDrive(hp_portA, MAINS_OPTO_PIN, optoLow ? pd_low : pd_float);
+}
+
+static void updateRxSender (
+    const uint64_t cycle)
+{
+    const uint8_t ch = (uint8_t)rx.text[rx.position];
+    bool level;
+    if (rx.bitNumber == 0) {
+        level = false;
+    } else if (rx.bitNumber <= 8) {
+        level = ((ch >> (rx.bitNumber - 1)) & 1) != 0;
+    } else {
+        level = true;
+    }
+    HostHAL_setPinDrive(hp_portA, RX_PIN, level ? pd_high : pd_low);
+
+    if (rx.bitNumber < 9) {
+        ++rx.bitNumber;
+        rx.nextBit = cycle + rx.bitTime;
+    } else {
+        ++rx.position;
+        rx.bitNumber = 0;
+        rx.nextBit = (rx.text[rx.position] != 0) ? (cycle + rx.bitTime) : HOSTHAL_NEVER;
+    }
+}
+
+static void sampleTx (
+    const uint64_t cycle)
+{
+    const bool level = (HostHAL_portOutputs(hp_portA) & (1 << TX_PIN)) != 0;
+
+    if (tx.bitNumber == 0) {
+        // middle of the start bit
+        if (level) {
+            // glitch. wait for the next falling edge
+            tx.nextSample = HOSTHAL_NEVER;
+            return;
+        }
+        tx.dataByte = 0;
+    } else if (tx.bitNumber <= 8) {
+        if (level) {
+            tx.dataByte |= 1 << (tx.bitNumber - 1);
+        }
+    } else {
+        // stop bit
+        if (level) {
+            const char ch = (char)tx.dataByte;
+            if (ch == 0) {
+                if (!tx.inFrame) {
+                    // start of a frame. Drop any partial line
+                    tx.inFrame = true;
+                } else if (tx.lineLength > 0) {
+                    if ((listener != NULL) && (listener->frameReceived != NULL)) {
+                        listener->frameReceived(cycle,
+                            (const uint8_t*)tx.line, tx.lineLength);
+                    }
+                    tx.inFrame = false;
+                }
+                tx.lineLength = 0;
+            } else if (tx.inFrame) {
+                if (tx.lineLength < sizeof(tx.line)) {
+                    tx.line[tx.lineLength++] = ch;
+                }
+            } else if (ch == '\n') {
+                tx.line[tx.lineLength] = 0;
+                if ((listener != NULL) && (listener->lineReceived != NULL)) {
+                    listener->lineReceived(cycle, tx.line);
+                }
+                tx.lineLength = 0;
+            } else if ((ch != '\r') && (tx.lineLength < (sizeof(tx.line) - 1))) {
+                tx.line[tx.lineLength++] = ch;
+            }
+        }
+        tx.nextSample = HOSTHAL_NEVER;
+        return;
+    }
+    ++tx.bitNumber;
+    tx.nextSample = cycle + BIT_TIME;
+}
+
+static void notifyOutputChanged (
+    const uint64_t cycle,
+    const HostBoard_output output,
+    const bool on)
+{
+    if ((listener != NULL) && (listener->outputChanged != NULL)) {
+        listener->outputChanged(cycle, output, on);
+    }
+}
+
+void HostBoard_Initialize (
+    const HostBoard_Listener* boardListener)
+{
+    listener = boardListener;
+
+    HostHAL_setSupplyVoltage(SUPPLY_VOLTAGE);
+
+    // pushbutton and mode switch are open, and pulled up by the chip
+    HostHAL_setPinDrive(hp_portA, PUSHBUTTON_PIN, pd_float);
+    HostHAL_setPinDrive(hp_portB, MODE_SWITCH_PIN, pd_float);
+    HostHAL_setPinDrive(hp_portB, MOTION_PIN, pd_low);
+    // serial line idles high
+    HostHAL_setPinDrive(hp_portA, RX_PIN, pd_high);
+
+    mainsOn = false;
+    batteryVolts = 13.2;
+    ambientLight = 0.0;
+    roomLightsOn = false;
+    temperature = 25.0;
+    serialSkew = 0.0;
+    photocellTarget = 0.0;
+    photocellLevel = 0.0;
+    photocellUpdatedAt = 0;
+    nextPhotocellStep = HOSTHAL_NEVER;
+    nextOptoEdge = HOSTHAL_NEVER;
+    optoLow = false;
+    tx.nextSample = HOSTHAL_NEVER;
+    tx.lineLength = 0;
+    tx.inFrame = false;
+    rx.nextBit = HOSTHAL_NEVER;
+    rx.bitTime = BIT_TIME;
+    batteryFETOn = false;
+    adapterFETOn = false;
+
+    updateOptoisolator(0);
+    updateAnalogInputs();
+    // the board starts out in the dark, with the photocell settled
+    photocellLevel = photocellTarget;
+    movePhotocell(0);
+}
+
+void HostBoard_setMains (
+    const uint64_t cycle,
+    const bool on)
+{
+    if (on != mainsOn) {
+        mainsOn = on;
+        // the optoisolator follows at its next edge, or now if mains
+        // just came on
+        if (mainsOn) {
+            nextOptoEdge = cycle;
+        }
+        updateAnalogInputs();
+    }
+}
+
+void HostBoard_setBatteryVolts (
+    const double volts)
+{
+    batteryVolts = volts;
+    updateAnalogInputs();
+}
+
+void HostBoard_setAmbientLight (
+    const double level)
+{
+    ambientLight = level;
+    updateAnalogInputs();
+}
+
+void HostBoard_setRoomLights (
+    const bool on)
+{
+    roomLightsOn = on;
+    updateAnalogInputs();
+}
+
+void HostBoard_setMotion (
+    const bool motion)
+{
+    HostHAL_setPinDrive(hp_portB, MOTION_PIN, motion ? pd_high : pd_low);
+}
+
+void HostBoard_setButton (
+    const bool pressed)
+{
+    HostHAL_setPinDrive(hp_portA, PUSHBUTTON_PIN, pressed ? pd_low : pd_float);
+}
+
+void HostBoard_setTemperature (
+    const double degreesC)
+{
+    temperature = degreesC;
+    updateAnalogInputs();
+}
+
+void HostBoard_setSerialSkew (
+    const double percent)
+{
+    serialSkew = percent;
+}
+
+void HostBoard_sendLine (
+    const uint64_t cycle,
+    const char* text)
+{
+    if (rx.nextBit == HOSTHAL_NEVER) {
+        strncpy(rx.text, text, sizeof(rx.text) - 1);
+        rx.text[sizeof(rx.text) - 1] = 0;
+        rx.position = 0;
+        rx.bitNumber = 0;
+        rx.bitTime = (uint64_t)((BIT_TIME * (1.0 + (serialSkew / 100.0))) + 0.5);
+        rx.nextBit = (rx.text[0] != 0) ? cycle : HOSTHAL_NEVER;
+    }
+}
+
+bool HostBoard_mainsOn (void)
+{
+    return mainsOn;
+}
+
+bool HostBoard_batteryFETOn (void)
+{
+    return batteryFETOn;
+}
+
+bool HostBoard_adapterFETOn (void)
+{
+    return adapterFETOn;
+}
+
+double HostBoard_batteryVolts (void)
+{
+    return batteryCarriesLoad()
+        ? (batteryVolts - BATTERY_SAG_VOLTS)
+        : batteryVolts;
+}
+
+uint64_t HostBoard_update (
+    const uint64_t cycle)
+{
+    if (cycle >= nextOptoEdge) {
+        updateOptoisolator(cycle);
+    }
+    if (cycle >= rx.nextBit) {
+        updateRxSender(cycle);
+    }
+    if (cycle >= tx.nextSample) {
+        sampleTx(cycle);
+    }
+    if (cycle >= nextPhotocellStep) {
+        movePhotocell(cycle);
+    }
+
+    uint64_t next = nextOptoEdge;
+    if (rx.nextBit < next) {
+        next = rx.nextBit;
+    }
+    if (tx.nextSample < next) {
+        next = tx.nextSample;
+    }
+    if (nextPhotocellStep < next) {
+        next = nextPhotocellStep;
+    }
+
+    return next;
+}
+
+uint64_t HostBoard_outputsChanged (
+    const uint64_t cycle)
+{
+    uint64_t wanted = HOSTHAL_NEVER;
+    const uint8_t outputs = HostHAL_portOutputs(hp_portA);
+
+    // serial out: a falling edge while idle is a start bit
+    if (((outputs & (1 << TX_PIN)) == 0) &&
+        (tx.nextSample == HOSTHAL_NEVER) &&
+        ((HostHAL_portDirections(hp_portA) & (1 << TX_PIN)) != 0)) {
+        tx.bitNumber = 0;
+        tx.nextSample = cycle + (BIT_TIME / 2);
+        wanted = tx.nextSample;
+    }
+
+    const bool batteryFET = (outputs & (1 << BATTERY_FET_PIN)) != 0;
+    const bool adapterFET = (outputs & (1 << ADAPTER_FET_PIN)) != 0;
+    if ((batteryFET != batteryFETOn) || (adapterFET != adapterFETOn)) {
+        const bool batteryChanged = (batteryFET != batteryFETOn);
+        const bool adapterChanged = (adapterFET != adapterFETOn);
+        batteryFETOn = batteryFET;
+        adapterFETOn = adapterFET;
+        updateAnalogInputs();
+        if (batteryChanged) {
+            notifyOutputChanged(cycle, bo_batteryFET, batteryFET);
+        }
+        if (adapterChanged) {
+            notifyOutputChanged(cycle, bo_adapterFET, adapterFET);
+        }
+        if (nextPhotocellStep < wanted) {
+            wanted = nextPhotocellStep;
+        }
+    }
+
+    return wanted;
+}
@@ -0,0 +1,121 @@
+//
+//  Host Board Model
+//
+//  The LightingUPS board and the room around the simulated AtTiny84.
+//  Turns the state of the mains, battery and room into pin levels and
+//  ADC voltages, sends and receives on the serial line, and reports
+//  what the firmware does with its outputs.
+//
+//  Inputs:
+//      PA7 - mains optoisolator, pulled low for part of every half
+//            cycle of 60Hz mains while mains are on
+//      ADC0 - battery through the 10k/21.7k divider
+//      ADC3 - photocell, 0V dark to VCC in full light
+//      ADC8 - internal temperature sensor
+//      PB2 - motion detector output
+//      PA4 - pushbutton, pulls the pin low while pressed
+//      PB1 - mode switch, open
+//      PA5 - serial data in, SOFTWARESERIAL_BAUD_RATE (PA6 when the
+//            firmware is built with SOFTWARESERIAL_USI)
+//  Outputs:
+//      PA1 - battery FET
+//      PA2 - adapter FET
+//      PA6 - serial data out (PA5 with SOFTWARESERIAL_USI)
+//
+//  The photocell sees the ambient light, plus the room lights while
+//  mains are on, plus the LEDs while either FET is on, and takes about
+//  100mS to settle after that changes. The battery sags while it
+//  carries the LED load.
+//
+//  The simulation driver calls HostBoard_update and
+//  HostBoard_outputsChanged from its HostSim_ functions.
+//
+#ifndef HOSTBOARD_H
+#define HOSTBOARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HOSTBOARD_CYCLES_PER_SECOND ((uint64_t)F_CPU)
+
+typedef enum HostBoard_output_enum {
+    bo_batteryFET,
+    bo_adapterFET
+} HostBoard_output;
+
+// notifications from the board. Any may be NULL. A frame is what
+// the firmware sends between two zero bytes, as sent (still COBS
+// encoded)
+typedef struct HostBoard_Listener_struct {
+    void (*outputChanged)(
+        const uint64_t cycle,
+        const HostBoard_output output,
+        const bool on);
+    void (*lineReceived)(
+        const uint64_t cycle,
+        const char* line);
+    void (*frameReceived)(
+        const uint64_t cycle,
+        const uint8_t* frame,
+        const uint8_t length);
+} HostBoard_Listener;
+
+// sets up the chip's surroundings: mains off, battery full, dark
+// room, 25C. Call after HostHAL_Initialize
+extern void HostBoard_Initialize (
+    const HostBoard_Listener* listener);
+
+extern void HostBoard_setMains (
+    const uint64_t cycle,
+    const bool on);
+
+// resting (unloaded) battery voltage
+extern void HostBoard_setBatteryVolts (
+    const double volts);
+
+// daylight reaching the photocell, 0..1
+extern void HostBoard_setAmbientLight (
+    const double level);
+
+// the room's own lights, which only light while mains are on
+extern void HostBoard_setRoomLights (
+    const bool on);
+
+extern void HostBoard_setMotion (
+    const bool motion);
+
+extern void HostBoard_setButton (
+    const bool pressed);
+
+extern void HostBoard_setTemperature (
+    const double degreesC);
+
+// makes the serial input's bit times <percent> longer (negative:
+// shorter) than nominal from the next line sent
+extern void HostBoard_setSerialSkew (
+    const double percent);
+
+// sends text on the serial input. Ignored if a line is still being sent
+extern void HostBoard_sendLine (
+    const uint64_t cycle,
+    const char* text);
+
+extern bool HostBoard_mainsOn (void);
+extern bool HostBoard_batteryFETOn (void);
+extern bool HostBoard_adapterFETOn (void);
+
+// battery voltage at the terminals, after any sag from the load
+extern double HostBoard_batteryVolts (void);
+
+// brings the board up to <cycle>. Returns the cycle the board next
+// needs to be called at
+extern uint64_t HostBoard_update (
+    const uint64_t cycle);
+
+// for HostSim_outputsChanged. Returns the cycle the board next needs
+// HostBoard_update called at if that is now sooner, otherwise
+// HOSTHAL_NEVER
+extern uint64_t HostBoard_outputsChanged (
+    const uint64_t cycle);
+
+#endif  // HOSTBOARD_H
@@ -0,0 +1,1086 @@
+//
+//  Host Hardware Abstraction Layer
+//
+//  How it works:
+//      The I/O registers live in an array indexed by I/O address. The
+//      register accessors (used by every register name in avr/io.h)
+//      first charge the access time and bring the simulated peripherals
+//      up to the current cycle, then dispatch any interrupt that is
+//      enabled and pending, and finally hand the firmware a pointer to
+//      the register. Writes are seen at the next access: that is when a
+//      newly set ADSC starts a conversion, an EEPE starts an EEPROM
+//      write, a new OCR value takes effect, and so on.
+//
+//      Timers don't tick. Each keeps the cycle at which its count was
+//      zero, and works out its count, and which compare values it has
+//      passed since it was last brought up to date, from the cycle.
+//      Sleeping jumps straight to the next cycle at which a timer sets
+//      a flag, a conversion or EEPROM write finishes, the watchdog
+//      runs out or the driver changes an input.
+//
+//      The interrupt flag registers (GIFR, TIFR0, TIFR1) are only ever
+//      written by the firmware, to clear flags. An access to one of them
+//      is taken as a write: the flags that are 1 in the value left in
+//      the register are cleared.
+//      USISR is the same, except that its low four bits (the USI's
+//      counter) take the value written.
+//
+//      The USI shifts on each Timer 0 compare match while its clock is
+//      Timer 0: DI is shifted into the bottom of USIDR, DO shows the top
+//      bit (in three-wire mode, when DO is an output), and the counter
+//      overflows into USIOIF, copying USIDR to USIBR.
+//
+
+#include "HostHAL.h"
+
+#include <avr/io.h>
+#include <string.h>
+#include <stddef.h>
+
+// I/O addresses. avr/io.h register names are accessor calls, so the
+// simulation itself uses addresses
+#define IO_SREG     0x3F
+#define IO_OCR0B    0x3C
+#define IO_GIMSK    0x3B
+#define IO_GIFR     0x3A
+#define IO_TIMSK0   0x39
+#define IO_TIFR0    0x38
+#define IO_OCR0A    0x36
+#define IO_MCUCR    0x35
+#define IO_TCCR0B   0x33
+#define IO_TCNT0    0x32
+#define IO_TCCR0A   0x30
+#define IO_TCCR1A   0x2F
+#define IO_TCCR1B   0x2E
+#define IO_TCNT1    0x2C
+#define IO_OCR1A    0x2A
+#define IO_OCR1B    0x28
+#define IO_ICR1     0x24
+#define IO_PCMSK1   0x20
+#define IO_EEAR     0x1E
+#define IO_EEDR     0x1D
+#define IO_EECR     0x1C
+#define IO_PORTA    0x1B
+#define IO_DDRA     0x1A
+#define IO_PINA     0x19
+#define IO_PORTB    0x18
+#define IO_DDRB     0x17
+#define IO_PINB     0x16
+#define IO_PCMSK0   0x12
+#define IO_USIBR    0x10
+#define IO_USIDR    0x0F
+#define IO_USISR    0x0E
+#define IO_USICR    0x0D
+#define IO_TIMSK1   0x0C
+#define IO_TIFR1    0x0B
+#define IO_ACSR     0x08
+#define IO_ADMUX    0x07
+#define IO_ADCSRA   0x06
+#define IO_ADCH     0x05
+#define IO_ADCL     0x04
+#define IO_ADCSRB   0x03
+#define IO_SIZE     0x40
+
+#define SREG_INTERRUPT_ENABLE (1 << SREG_I)
+
+// flag bits are in the same place in TIFR0 and TIFR1,
+// and so are the enable bits in TIMSK0 and TIMSK1
+#define TIMER_OVERFLOW  (1 << TOV0)
+#define TIMER_COMPARE_A (1 << OCF0A)
+#define TIMER_COMPARE_B (1 << OCF0B)
+
+#define ADC_CLOCKS_PER_CONVERSION 13
+#define ADC_CLOCKS_FIRST_CONVERSION 25
+#define ADC_INTERNAL_REFERENCE 1.1
+// auto trigger sources (ADTS2:0)
+#define ADC_TRIGGER_SOURCE_MASK 0x07
+#define ADC_TRIGGER_TIMER0_COMPARE_A 3
+#define ADC_TRIGGER_TIMER1_COMPARE_B 5
+
+// Timer 1's input capture pin is PA7
+#define ICP1_PIN 7
+
+// USI pins, on port A, and its modes
+#define USI_DO_PIN 5
+#define USI_DI_PIN 6
+#define USI_WIRE_MODE_MASK ((1 << USIWM1) | (1 << USIWM0))
+#define USI_THREE_WIRE_MODE (1 << USIWM0)
+#define USI_CLOCK_MASK ((1 << USICS1) | (1 << USICS0) | (1 << USICLK))
+#define USI_CLOCK_TIMER0 (1 << USICS0)
+#define USI_FLAGS_MASK 0xF0
+#define USI_COUNTER_MASK 0x0F
+
+#define EEPROM_WRITE_CYCLES ((uint64_t)(F_CPU * 0.0034))
+#define EEPROM_READ_CYCLES 4
+
+// watchdog oscillator is 128kHz. WDTO_15MS is 2048 of its cycles
+#define WATCHDOG_CYCLES(timeout) \
+    ((((uint64_t)2048) << (timeout)) * F_CPU / 128000)
+
+typedef struct {
+    uint8_t tccra;      // I/O addresses of the timer's registers
+    uint8_t tccrb;
+    uint8_t tcnt;
+    uint8_t ocra;
+    uint8_t ocrb;
+    uint8_t timsk;
+    uint8_t tifr;
+    uint8_t compareAVector; // compare B and overflow follow it
+    bool sixteenBit;
+    uint32_t prescale;  // CPU cycles per count, 0 when stopped
+    uint32_t top;       // count wraps to 0 after this
+    int64_t origin;     // cycle at which the count was 0
+    uint64_t count;     // counts since origin, as of the last update
+    uint64_t nextEvent; // cycle of the next compare match or overflow
+    // register values the timer is currently running with
+    uint8_t tccraValue;
+    uint8_t tccrbValue;
+    uint16_t ocraValue;
+    uint16_t ocrbValue;
+} SimTimer;
+
+typedef void (*InterruptVector)(void);
+
+// default handlers (null unless the firmware defines them)
+void __vector_1 (void) __attribute__((weak));
+void __vector_2 (void) __attribute__((weak));
+void __vector_3 (void) __attribute__((weak));
+void __vector_4 (void) __attribute__((weak));
+void __vector_5 (void) __attribute__((weak));
+void __vector_6 (void) __attribute__((weak));
+void __vector_7 (void) __attribute__((weak));
+void __vector_8 (void) __attribute__((weak));
+void __vector_9 (void) __attribute__((weak));
+void __vector_10 (void) __attribute__((weak));
+void __vector_11 (void) __attribute__((weak));
+void __vector_12 (void) __attribute__((weak));
+void __vector_13 (void) __attribute__((weak));
+void __vector_14 (void) __attribute__((weak));
+void __vector_15 (void) __attribute__((weak));
+void __vector_16 (void) __attribute__((weak));
+
+static InterruptVector const vectors[_VECTORS_SIZE] = {
+    NULL,
+    __vector_1,  __vector_2,  __vector_3,  __vector_4,
+    __vector_5,  __vector_6,  __vector_7,  __vector_8,
+    __vector_9,  __vector_10, __vector_11, __vector_12,
+    __vector_13, __vector_14, __vector_15, __vector_16
+};
+
+uint8_t HostHAL_eeprom[HOSTHAL_EEPROM_SIZE];
+
+// state variables
+static union {
+    volatile uint8_t b[IO_SIZE];
+    volatile uint16_t w[IO_SIZE / 2];
+} io;
+static uint64_t cycles;
+static uint64_t inputsDue;          // when the driver next wants a call
+
+static uint8_t externalDriven[2];   // pins driven from outside
+static uint8_t externalHigh[2];     // ...and driven high
+static uint8_t lastOutputs[2];
+static uint8_t lastDirections[2];
+
+static SimTimer timer0;
+static SimTimer timer1;
+
+static double analogInputs[HOSTHAL_ADC_CHANNELS];
+static double supplyVoltage;
+static bool adcConverting;
+static bool adcFirstConversion;
+static uint64_t adcDoneCycle;
+
+static bool eepromWriting;
+static uint64_t eepromDoneCycle;
+
+static bool watchdogEnabled;
+static uint64_t watchdogTimeout;
+static uint64_t watchdogDeadline;
+
+static uint8_t flagRegisterAccessed;    // 0 if none
+static uint8_t flagRegisterSnapshot;    // value the firmware was given
+
+static const HostHAL_TimingObserver* timingObserver;
+static uint64_t raisedAt[_VECTORS_SIZE];    // cycle each flag was set
+static uint64_t wokeAt;                     // cycle the last sleep ended
+
+static void triggerADC (
+    const uint8_t source,
+    const uint64_t when);
+
+static uint16_t ioWord (
+    const uint8_t address)
+{
+    return io.w[address / 2];
+}
+
+static uint32_t timerPrescale (
+    const uint8_t tccrb)
+{
+    static const uint32_t prescales[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+    // external clock sources (6, 7) aren't simulated
+    return prescales[tccrb & 0x07];
+}
+
+static uint32_t timerTop (
+    const SimTimer* timer)
+{
+    uint32_t top;
+
+    if (timer->sixteenBit) {
+        const uint8_t wgm = (io.b[timer->tccra] & 0x03) |
+                            ((io.b[timer->tccrb] >> WGM12) & 0x03) << 2;
+        switch (wgm) {
+            case 4 :    top = ioWord(timer->ocra);  break;  // CTC
+            case 12 :   top = ioWord(IO_ICR1);      break;  // CTC
+            default :   top = 0xFFFF;               break;  // normal
+        }
+    } else {
+        const uint8_t wgm = (io.b[timer->tccra] & 0x03) |
+                            ((io.b[timer->tccrb] >> WGM02) & 0x01) << 2;
+        top = (wgm == 2)
+            ? io.b[timer->ocra]     // CTC
+            : 0xFF;                 // normal
+    }
+
+    return top;
+}
+
+static uint16_t timerCompareValue (
+    const SimTimer* timer,
+    const uint8_t address)
+{
+    return (timer->sixteenBit) ? ioWord(address) : io.b[address];
+}
+
+// first count after <after> at which the counter shows <value>
+static uint64_t nextMatch (
+    const uint64_t after,
+    const uint32_t period,
+    const uint32_t value)
+{
+    const uint64_t first = after + 1;
+    return first + ((value + period - (first % period)) % period);
+}
+
+// sets an interrupt flag, noting the cycle it was raised at for the
+// timing observer unless it was already set
+static bool raiseFlag (
+    const uint8_t address,
+    const uint8_t flag,
+    const uint8_t vector,
+    const uint64_t when)
+{
+    const bool raised = ((io.b[address] & flag) == 0);
+    if (raised) {
+        io.b[address] |= flag;
+        raisedAt[vector] = when;
+    }
+    return raised;
+}
+
+static void raiseTimerFlag (
+    const SimTimer* timer,
+    const uint8_t flag,
+    const uint8_t vectorOffset,
+    const uint64_t matchCount,
+    const uint64_t count)
+{
+    if (matchCount <= count) {
+        const uint64_t when =
+            (uint64_t)(timer->origin + (int64_t)(matchCount * timer->prescale));
+        if (raiseFlag(timer->tifr, flag, timer->compareAVector + vectorOffset, when)) {
+            if ((timer == &timer0) && (flag == TIMER_COMPARE_A)) {
+                triggerADC(ADC_TRIGGER_TIMER0_COMPARE_A, when);
+            } else if ((timer == &timer1) && (flag == TIMER_COMPARE_B)) {
+                triggerADC(ADC_TRIGGER_TIMER1_COMPARE_B, when);
+            }
+        }
+    }
+}
+
+// compare matches at <value> in counts (first, last]
+static uint64_t matchesBetween (
+    const uint64_t first,
+    const uint64_t last,
+    const uint32_t period,
+    const uint32_t value)
+{
+    const uint64_t firstMatch = nextMatch(first, period, value);
+    return (firstMatch <= last) ? (1 + ((last - firstMatch) / period)) : 0;
+}
+
+// clocks the USI <shifts> times, at cycle <when> (the last of them)
+static void clockUSI (
+    const uint64_t shifts,
+    const uint64_t when)
+{
+    for (uint64_t s = 0; s < shifts; ++s) {
+        const uint8_t di = (io.b[IO_PINA] >> USI_DI_PIN) & 1;
+        io.b[IO_USIDR] = (uint8_t)((io.b[IO_USIDR] << 1) | di);
+        const uint8_t counter = (io.b[IO_USISR] + 1) & USI_COUNTER_MASK;
+        io.b[IO_USISR] = (io.b[IO_USISR] & USI_FLAGS_MASK) | counter;
+        if (counter == 0) {
+            io.b[IO_USIBR] = io.b[IO_USIDR];
+            raiseFlag(IO_USISR, (1 << USIOIF), 16, when);
+        }
+    }
+}
+
+static uint64_t timerCountAt (
+    const SimTimer* timer,
+    const uint64_t now)
+{
+    return (uint64_t)((int64_t)now - timer->origin) / timer->prescale;
+}
+
+static uint64_t timerNextEvent (
+    const SimTimer* timer)
+{
+    uint64_t next = HOSTHAL_NEVER;
+
+    if (timer->prescale != 0) {
+        const uint32_t period = timer->top + 1;
+        uint64_t count = nextMatch(timer->count, period, 0);
+        if (timer->ocraValue <= timer->top) {
+            const uint64_t match = nextMatch(timer->count, period, timer->ocraValue);
+            if (match < count) {
+                count = match;
+            }
+        }
+        if (timer->ocrbValue <= timer->top) {
+            const uint64_t match = nextMatch(timer->count, period, timer->ocrbValue);
+            if (match < count) {
+                count = match;
+            }
+        }
+        next = (uint64_t)(timer->origin + (int64_t)(count * timer->prescale));
+    }
+
+    return next;
+}
+
+// Most accesses fall between timer events and don't touch the timer
+// registers, so the timer is only brought up to date when an event is
+// due or the firmware has changed its settings. TCNT is filled in when
+// the firmware accesses it (see updateTimerCount)
+static void updateTimer (
+    SimTimer* timer,
+    const uint64_t now)
+{
+    const uint8_t tccra = io.b[timer->tccra];
+    const uint8_t tccrb = io.b[timer->tccrb];
+    const uint16_t ocra = timerCompareValue(timer, timer->ocra);
+    const uint16_t ocrb = timerCompareValue(timer, timer->ocrb);
+    const bool settingsChanged =
+        (tccra != timer->tccraValue) || (tccrb != timer->tccrbValue) ||
+        (ocra != timer->ocraValue) || (ocrb != timer->ocrbValue);
+    if ((now < timer->nextEvent) && !settingsChanged) {
+        return;
+    }
+
+    // set the flags for the events since the last update, with the
+    // settings the timer had then
+    if (timer->prescale != 0) {
+        const uint64_t count = timerCountAt(timer, now);
+        if (count != timer->count) {
+            const uint32_t period = timer->top + 1;
+            if (timer->ocraValue <= timer->top) {
+                raiseTimerFlag(timer, TIMER_COMPARE_A, 0,
+                    nextMatch(timer->count, period, timer->ocraValue), count);
+                if ((timer == &timer0) &&
+                    ((io.b[IO_USICR] & USI_CLOCK_MASK) == USI_CLOCK_TIMER0)) {
+                    clockUSI(matchesBetween(timer->count, count, period,
+                        timer->ocraValue), now);
+                }
+            }
+            if (timer->ocrbValue <= timer->top) {
+                raiseTimerFlag(timer, TIMER_COMPARE_B, 1,
+                    nextMatch(timer->count, period, timer->ocrbValue), count);
+            }
+            if (timer->top == (timer->sixteenBit ? 0xFFFF : 0xFF)) {
+                raiseTimerFlag(timer, TIMER_OVERFLOW, 2,
+                    nextMatch(timer->count, period, 0), count);
+            }
+            timer->count = count;
+        }
+    }
+
+    if (settingsChanged) {
+        timer->tccraValue = tccra;
+        timer->tccrbValue = tccrb;
+        timer->ocraValue = ocra;
+        timer->ocrbValue = ocrb;
+
+        // pick up changes to the clock or mode, keeping the count
+        const uint32_t prescale = timerPrescale(tccrb);
+        const uint32_t top = timerTop(timer);
+        if ((prescale != timer->prescale) || (top != timer->top)) {
+            uint64_t value = (timer->prescale != 0)
+                ? (timer->count % (timer->top + 1))
+                : timerCompareValue(timer, timer->tcnt);
+            if (value > top) {
+                value = 0;
+            }
+            timer->prescale = prescale;
+            timer->top = top;
+            timer->count = value;
+            timer->origin = (int64_t)now - (int64_t)(value * prescale);
+        }
+    }
+
+    timer->nextEvent = timerNextEvent(timer);
+}
+
+// puts the current count in TCNT, for the firmware to read
+static void updateTimerCount (
+    SimTimer* timer)
+{
+    if (timer->prescale != 0) {
+        const uint32_t value = timerCountAt(timer, cycles) % (timer->top + 1);
+        if (timer->sixteenBit) {
+            io.w[timer->tcnt / 2] = value;
+        } else {
+            io.b[timer->tcnt] = value;
+        }
+    }
+}
+
+// holds the timer's count for <duration> cycles from the current cycle.
+// the timer must be up to date
+static void stopTimer (
+    SimTimer* timer,
+    const uint64_t duration)
+{
+    if (timer->prescale != 0) {
+        timer->origin += (int64_t)duration;
+        timer->nextEvent += duration;
+    }
+}
+
+static void initTimer (
+    SimTimer* timer)
+{
+    timer->prescale = 0;
+    timer->top = timer->sixteenBit ? 0xFFFF : 0xFF;
+    timer->origin = 0;
+    timer->count = 0;
+    timer->nextEvent = HOSTHAL_NEVER;
+    timer->tccraValue = 0;
+    timer->tccrbValue = 0;
+    timer->ocraValue = 0;
+    timer->ocrbValue = 0;
+}
+
+// the input capture unit, for an edge on ICP1. The noise canceler's
+// delay and the analog comparator as the capture source aren't
+// simulated
+static void captureTimer1 (
+    const uint64_t now,
+    const bool rising)
+{
+    const bool risingEdgeSelected = ((io.b[IO_TCCR1B] & (1 << ICES1)) != 0);
+    if ((timer1.prescale != 0) && (rising == risingEdgeSelected)) {
+        io.w[IO_ICR1 / 2] = timerCountAt(&timer1, now) % (timer1.top + 1);
+        raiseFlag(IO_TIFR1, (1 << ICF1), 5, now);
+    }
+}
+
+// the levels a port's output latches drive. In three-wire mode the
+// USI drives DO from the top bit of USIDR
+static uint8_t portLatches (
+    const HostHAL_port port)
+{
+    uint8_t latches = io.b[(port == hp_portA) ? IO_PORTA : IO_PORTB];
+    if ((port == hp_portA) &&
+        ((io.b[IO_USICR] & USI_WIRE_MODE_MASK) == USI_THREE_WIRE_MODE)) {
+        latches = (latches & ~(1 << USI_DO_PIN)) |
+            (((io.b[IO_USIDR] >> 7) & 1) << USI_DO_PIN);
+    }
+    return latches;
+}
+
+static void updatePins (
+    const uint64_t now)
+{
+    static const uint8_t pinAddress[2]  = { IO_PINA,   IO_PINB };
+    static const uint8_t portAddress[2] = { IO_PORTA,  IO_PORTB };
+    static const uint8_t ddrAddress[2]  = { IO_DDRA,   IO_DDRB };
+    static const uint8_t pcmskAddress[2] = { IO_PCMSK0, IO_PCMSK1 };
+    static const uint8_t pcif[2]        = { (1 << PCIF0), (1 << PCIF1) };
+    static const uint8_t pinMask[2]     = { 0xFF, 0x0F };
+
+    for (uint8_t p = 0; p < 2; ++p) {
+        const uint8_t ddr = io.b[ddrAddress[p]];
+        const uint8_t port = io.b[portAddress[p]];
+        const uint8_t pullups = (io.b[IO_MCUCR] & (1 << PUD)) ? 0 : port;
+        const uint8_t inputs =
+            (externalDriven[p] & externalHigh[p]) |
+            ((~externalDriven[p]) & pullups);
+        const uint8_t pins = ((ddr & portLatches(p)) | ((~ddr) & inputs)) & pinMask[p];
+
+        const uint8_t changed = pins ^ io.b[pinAddress[p]];
+        if ((changed & io.b[pcmskAddress[p]]) != 0) {
+            raiseFlag(IO_GIFR, pcif[p], 2 + p, now);
+        }
+        if ((p == hp_portA) && ((changed & (1 << ICP1_PIN)) != 0)) {
+            captureTimer1(now, (pins & (1 << ICP1_PIN)) != 0);
+        }
+        io.b[pinAddress[p]] = pins;
+    }
+}
+
+static void checkOutputs (void)
+{
+    const uint8_t outA = io.b[IO_DDRA] & portLatches(hp_portA);
+    const uint8_t outB = io.b[IO_DDRB] & portLatches(hp_portB);
+    if ((outA != lastOutputs[hp_portA]) ||
+        (outB != lastOutputs[hp_portB]) ||
+        (io.b[IO_DDRA] != lastDirections[hp_portA]) ||
+        (io.b[IO_DDRB] != lastDirections[hp_portB])) {
+        lastOutputs[hp_portA] = outA;
+        lastOutputs[hp_portB] = outB;
+        lastDirections[hp_portA] = io.b[IO_DDRA];
+        lastDirections[hp_portB] = io.b[IO_DDRB];
+        const uint64_t wanted = HostSim_outputsChanged(cycles);
+        if (wanted < inputsDue) {
+            inputsDue = wanted;
+        }
+    }
+}
+
+static double adcInputVoltage (
+    const uint8_t mux)
+{
+    double volts = 0.0;
+
+    if (mux < 8) {
+        volts = analogInputs[mux];
+    } else if (mux == 0x21) {
+        volts = ADC_INTERNAL_REFERENCE;
+    } else if (mux == 0x22) {
+        volts = analogInputs[8];    // temperature sensor
+    }
+    // 0x20 is ground. differential channels aren't simulated
+
+    return volts;
+}
+
+static void startADCAt (
+    const uint64_t start)
+{
+    const uint8_t adcsra = io.b[IO_ADCSRA];
+    if ((adcsra & (1 << ADEN)) == 0) {
+        adcConverting = false;
+        adcFirstConversion = true;
+        io.b[IO_ADCSRA] &= ~(1 << ADSC);
+    } else if (((adcsra & (1 << ADSC)) != 0) && !adcConverting) {
+        const uint8_t prescaleBits = adcsra & 0x07;
+        const uint32_t prescale = (prescaleBits == 0) ? 2 : (1 << prescaleBits);
+        const uint32_t clocks = adcFirstConversion
+            ? ADC_CLOCKS_FIRST_CONVERSION
+            : ADC_CLOCKS_PER_CONVERSION;
+        adcDoneCycle = start + (clocks * prescale);
+        adcConverting = true;
+        adcFirstConversion = false;
+        // writing ADCSRA back with ADIF set (as ADSC |= does) clears it
+        io.b[IO_ADCSRA] &= ~(1 << ADIF);
+    }
+}
+
+static void updateADC (
+    const uint64_t now)
+{
+    if (adcConverting && (now >= adcDoneCycle)) {
+        const uint8_t admux = io.b[IO_ADMUX];
+        double reference;
+        switch (admux >> REFS0) {
+            case 0 :    reference = supplyVoltage;          break;
+            case 1 :    reference = analogInputs[0];        break;  // AREF is PA0
+            default :   reference = ADC_INTERNAL_REFERENCE; break;
+        }
+        const double volts = adcInputVoltage(admux & 0x3F);
+        int32_t counts = (reference > 0.0)
+            ? (int32_t)((volts * 1024.0) / reference)
+            : 1023;
+        if (counts < 0) {
+            counts = 0;
+        } else if (counts > 1023) {
+            counts = 1023;
+        }
+        io.w[IO_ADCL / 2] = ((io.b[IO_ADCSRB] & (1 << ADLAR)) != 0)
+            ? (uint16_t)(counts << 6)
+            : (uint16_t)counts;
+
+        io.b[IO_ADCSRA] &= ~(1 << ADSC);
+        raiseFlag(IO_ADCSRA, (1 << ADIF), 13, adcDoneCycle);
+        adcConverting = false;
+    }
+}
+
+// a rising edge on the ADC's auto trigger source starts a conversion,
+// if auto triggering is on and the ADC is idle
+static void triggerADC (
+    const uint8_t source,
+    const uint64_t when)
+{
+    const uint8_t enabled = (1 << ADEN) | (1 << ADATE);
+    if (((io.b[IO_ADCSRA] & enabled) == enabled) &&
+        ((io.b[IO_ADCSRB] & ADC_TRIGGER_SOURCE_MASK) == source)) {
+        updateADC(when);
+        if (!adcConverting) {
+            io.b[IO_ADCSRA] |= (1 << ADSC);
+            startADCAt(when);
+        }
+    }
+}
+
+static void startEEPROM (void)
+{
+    const uint8_t eecr = io.b[IO_EECR];
+    if (!eepromWriting) {
+        const uint16_t address = ioWord(IO_EEAR) & (HOSTHAL_EEPROM_SIZE - 1);
+        if ((eecr & (1 << EERE)) != 0) {
+            io.b[IO_EEDR] = HostHAL_eeprom[address];
+            io.b[IO_EECR] &= ~(1 << EERE);
+            cycles += EEPROM_READ_CYCLES;
+        }
+        if ((eecr & (1 << EEPE)) != 0) {
+            if ((eecr & (1 << EEMPE)) != 0) {
+                switch ((eecr >> EEPM0) & 0x03) {
+                    case 0 :    HostHAL_eeprom[address] = io.b[IO_EEDR];  break;
+                    case 1 :    HostHAL_eeprom[address] = 0xFF;           break;
+                    case 2 :    HostHAL_eeprom[address] &= io.b[IO_EEDR]; break;
+                    default :   break;
+                }
+                eepromWriting = true;
+                eepromDoneCycle = cycles + EEPROM_WRITE_CYCLES;
+                io.b[IO_EECR] &= ~(1 << EEMPE);
+            } else {
+                // EEPE without EEMPE is ignored
+                io.b[IO_EECR] &= ~(1 << EEPE);
+            }
+        }
+    }
+}
+
+static void updateEEPROM (
+    const uint64_t now)
+{
+    if (eepromWriting && (now >= eepromDoneCycle)) {
+        io.b[IO_EECR] &= ~(1 << EEPE);
+        eepromWriting = false;
+    }
+}
+
+static void updateWatchdog (
+    const uint64_t now)
+{
+    if (watchdogEnabled && (now >= watchdogDeadline)) {
+        HostSim_halt(watchdogDeadline, "watchdog reset");
+    }
+}
+
+static void advancePeripherals (
+    const uint64_t now)
+{
+    updateTimer(&timer0, now);
+    updateTimer(&timer1, now);
+    updateADC(now);
+    updateEEPROM(now);
+    updateWatchdog(now);
+}
+
+// clears the flags the firmware wrote to a flag register, if it
+// accessed one
+static void applyFlagRegisterWrite (void)
+{
+    if (flagRegisterAccessed != 0) {
+        const uint8_t written = io.b[flagRegisterAccessed];
+        if (flagRegisterAccessed == IO_USISR) {
+            io.b[IO_USISR] = (flagRegisterSnapshot & ~written & USI_FLAGS_MASK) |
+                (written & USI_COUNTER_MASK);
+        } else {
+            io.b[flagRegisterAccessed] = flagRegisterSnapshot & ~written;
+        }
+        flagRegisterAccessed = 0;
+    }
+}
+
+// brings the simulated hardware up to the current cycle
+static void catchUp (void)
+{
+    applyFlagRegisterWrite();
+
+    // act on what the firmware wrote since the last access
+    startADCAt(cycles);
+    startEEPROM();
+
+    while (inputsDue <= cycles) {
+        advancePeripherals(inputsDue);
+        const uint64_t inputsChanged = inputsDue;
+        inputsDue = HostSim_updateInputs(inputsChanged);
+        updatePins(inputsChanged);
+    }
+    advancePeripherals(cycles);
+    updatePins(cycles);
+    checkOutputs();
+}
+
+// returns the number of the highest priority interrupt that is
+// enabled and pending, and clears its flag. 0 if there is none
+static uint8_t takePendingInterrupt (void)
+{
+    // a handler that clears its flag as its last access has to have
+    // done so before the flags are looked at again
+    applyFlagRegisterWrite();
+
+    uint8_t vector = 0;
+    const uint8_t gifr = io.b[IO_GIFR] & io.b[IO_GIMSK];
+    const uint8_t tifr1 = io.b[IO_TIFR1] & io.b[IO_TIMSK1];
+    const uint8_t tifr0 = io.b[IO_TIFR0] & io.b[IO_TIMSK0];
+    const uint8_t adcsra = io.b[IO_ADCSRA];
+    const uint8_t acsr = io.b[IO_ACSR];
+    const uint8_t usi = io.b[IO_USISR] & io.b[IO_USICR];
+
+    if ((gifr & (1 << PCIF0)) != 0) {
+        io.b[IO_GIFR] &= ~(1 << PCIF0);
+        vector = 2;
+    } else if ((gifr & (1 << PCIF1)) != 0) {
+        io.b[IO_GIFR] &= ~(1 << PCIF1);
+        vector = 3;
+    } else if ((tifr1 & (1 << ICF1)) != 0) {
+        io.b[IO_TIFR1] &= ~(1 << ICF1);
+        vector = 5;
+    } else if ((tifr1 & TIMER_COMPARE_A) != 0) {
+        io.b[IO_TIFR1] &= ~TIMER_COMPARE_A;
+        vector = 6;
+    } else if ((tifr1 & TIMER_COMPARE_B) != 0) {
+        io.b[IO_TIFR1] &= ~TIMER_COMPARE_B;
+        vector = 7;
+    } else if ((tifr1 & TIMER_OVERFLOW) != 0) {
+        io.b[IO_TIFR1] &= ~TIMER_OVERFLOW;
+        vector = 8;
+    } else if ((tifr0 & TIMER_COMPARE_A) != 0) {
+        io.b[IO_TIFR0] &= ~TIMER_COMPARE_A;
+        vector = 9;
+    } else if ((tifr0 & TIMER_COMPARE_B) != 0) {
+        io.b[IO_TIFR0] &= ~TIMER_COMPARE_B;
+        vector = 10;
+    } else if ((tifr0 & TIMER_OVERFLOW) != 0) {
+        io.b[IO_TIFR0] &= ~TIMER_OVERFLOW;
+        vector = 11;
+    } else if (((acsr & (1 << ACI)) != 0) && ((acsr & (1 << ACIE)) != 0)) {
+        io.b[IO_ACSR] &= ~(1 << ACI);
+        vector = 12;
+    } else if (((adcsra & (1 << ADIF)) != 0) && ((adcsra & (1 << ADIE)) != 0)) {
+        io.b[IO_ADCSRA] &= ~(1 << ADIF);
+        vector = 13;
+    } else if (((io.b[IO_EECR] & (1 << EERIE)) != 0) && !eepromWriting) {
+        vector = 14;    // level triggered
+    } else if ((usi & (1 << USISIF)) != 0) {
+        vector = 15;    // flag cleared by the handler
+    } else if ((usi & (1 << USIOIF)) != 0) {
+        vector = 16;    // flag cleared by the handler
+    }
+
+    return vector;
+}
+
+// returns the number of interrupt handlers run
+static uint16_t dispatchInterrupts (void)
+{
+    uint16_t numDispatched = 0;
+
+    uint8_t vector;
+    while (((io.b[IO_SREG] & SREG_INTERRUPT_ENABLE) != 0) &&
+           ((vector = takePendingInterrupt()) != 0)) {
+        if (vectors[vector] == NULL) {
+            // avr-libc's default handler jumps to the reset vector
+            HostSim_halt(cycles, "interrupt with no handler");
+        }
+        io.b[IO_SREG] &= ~SREG_INTERRUPT_ENABLE;
+        const uint64_t entered = cycles;
+        cycles += HOSTHAL_CYCLES_PER_INTERRUPT;
+        if ((timingObserver != NULL) && (timingObserver->interruptEntered != NULL)) {
+            // interrupts without a flag the simulation raises (EE_RDY,
+            // USI, comparator) count from when they were taken
+            const uint64_t raised = (raisedAt[vector] <= entered) ? raisedAt[vector] : entered;
+            timingObserver->interruptEntered(vector, cycles - raised);
+        }
+        raisedAt[vector] = HOSTHAL_NEVER;
+        vectors[vector]();
+        if ((timingObserver != NULL) && (timingObserver->interruptReturned != NULL)) {
+            timingObserver->interruptReturned(vector, cycles - entered);
+        }
+        io.b[IO_SREG] |= SREG_INTERRUPT_ENABLE;
+        ++numDispatched;
+    }
+
+    return numDispatched;
+}
+
+static void access (void)
+{
+    cycles += HOSTHAL_CYCLES_PER_ACCESS;
+    catchUp();
+    dispatchInterrupts();
+}
+
+static uint64_t nextEvent (
+    const bool timersRunning)
+{
+    uint64_t next = inputsDue;
+    if (timersRunning && (timer0.nextEvent < next)) {
+        next = timer0.nextEvent;
+    }
+    if (timersRunning && (timer1.nextEvent < next)) {
+        next = timer1.nextEvent;
+    }
+    if (adcConverting && (adcDoneCycle < next)) {
+        next = adcDoneCycle;
+    }
+    if (eepromWriting && (eepromDoneCycle < next)) {
+        next = eepromDoneCycle;
+    }
+    if (watchdogEnabled && (watchdogDeadline < next)) {
+        next = watchdogDeadline;
+    }
+
+    return next;
+}
+
+volatile uint8_t* HostHAL_io8 (
+    const uint8_t address)
+{
+    access();
+
+    if ((address == IO_GIFR) ||
+        (address == IO_TIFR0) ||
+        (address == IO_TIFR1) ||
+        (address == IO_USISR)) {
+        flagRegisterAccessed = address;
+        flagRegisterSnapshot = io.b[address];
+    } else if (address == IO_TCNT0) {
+        updateTimerCount(&timer0);
+    } else if ((address & ~1) == IO_TCNT1) {
+        updateTimerCount(&timer1);
+    }
+
+    return &io.b[address];
+}
+
+volatile uint16_t* HostHAL_io16 (
+    const uint8_t address)
+{
+    access();
+
+    if (address == IO_TCNT1) {
+        updateTimerCount(&timer1);
+    }
+
+    return &io.w[address / 2];
+}
+
+void HostHAL_cli (void)
+{
+    access();
+    io.b[IO_SREG] &= ~SREG_INTERRUPT_ENABLE;
+}
+
+void HostHAL_sei (void)
+{
+    // as on the chip, a pending interrupt is taken after the next
+    // instruction (so sei(); sleep_cpu(); can't miss a wakeup)
+    io.b[IO_SREG] |= SREG_INTERRUPT_ENABLE;
+}
+
+void HostHAL_sleep (void)
+{
+    // an interrupt that is already pending is taken below, as the
+    // wakeup. Taking it here would leave the sleep to wait for the
+    // next event, worked out before its handler's writes were seen
+    cycles += HOSTHAL_CYCLES_PER_ACCESS;
+    catchUp();
+
+    if ((io.b[IO_MCUCR] & (1 << SE)) == 0) {
+        dispatchInterrupts();
+    } else {
+        if ((io.b[IO_SREG] & SREG_INTERRUPT_ENABLE) == 0) {
+            HostSim_halt(cycles, "sleep with interrupts disabled");
+        }
+        if ((timingObserver != NULL) && (timingObserver->sleeping != NULL)) {
+            timingObserver->sleeping(cycles, cycles - wokeAt);
+        }
+
+        // ADC noise reduction mode stops the I/O clock (and so the
+        // timers), and starts a conversion if the ADC is idle
+        const bool adcNoiseReduction =
+            ((io.b[IO_MCUCR] & ((1 << SM1) | (1 << SM0))) == (1 << SM0));
+        if (adcNoiseReduction && !adcConverting) {
+            io.b[IO_ADCSRA] |= (1 << ADSC);
+            startADCAt(cycles);
+        }
+
+        bool woken = (dispatchInterrupts() != 0);
+        while (!woken) {
+            const uint64_t next = nextEvent(!adcNoiseReduction);
+            if (next == HOSTHAL_NEVER) {
+                HostSim_halt(cycles, "sleep with nothing to wake up");
+            }
+            if (next > cycles) {
+                if (adcNoiseReduction) {
+                    stopTimer(&timer0, next - cycles);
+                    stopTimer(&timer1, next - cycles);
+                }
+                cycles = next;
+            }
+            catchUp();
+            woken = (dispatchInterrupts() != 0);
+        }
+        wokeAt = cycles;
+    }
+}
+
+void HostHAL_wdtEnable (
+    const uint8_t timeout)
+{
+    access();
+    watchdogEnabled = true;
+    watchdogTimeout = WATCHDOG_CYCLES(timeout);
+    watchdogDeadline = cycles + watchdogTimeout;
+}
+
+void HostHAL_wdtDisable (void)
+{
+    access();
+    watchdogEnabled = false;
+}
+
+void HostHAL_wdtReset (void)
+{
+    access();
+    watchdogDeadline = cycles + watchdogTimeout;
+}
+
+void HostHAL_delayCycles (
+    const uint64_t delay)
+{
+    cycles += delay;
+    access();
+}
+
+void HostHAL_Initialize (void)
+{
+    memset((void*)io.b, 0, sizeof(io.b));
+    cycles = 0;
+    inputsDue = 0;
+
+    for (uint8_t p = 0; p < 2; ++p) {
+        externalDriven[p] = 0;
+        externalHigh[p] = 0;
+        lastOutputs[p] = 0;
+        lastDirections[p] = 0;
+    }
+
+    timer0.tccra = IO_TCCR0A;
+    timer0.tccrb = IO_TCCR0B;
+    timer0.tcnt = IO_TCNT0;
+    timer0.ocra = IO_OCR0A;
+    timer0.ocrb = IO_OCR0B;
+    timer0.timsk = IO_TIMSK0;
+    timer0.tifr = IO_TIFR0;
+    timer0.compareAVector = 9;
+    timer0.sixteenBit = false;
+    initTimer(&timer0);
+
+    timer1.tccra = IO_TCCR1A;
+    timer1.tccrb = IO_TCCR1B;
+    timer1.tcnt = IO_TCNT1;
+    timer1.ocra = IO_OCR1A;
+    timer1.ocrb = IO_OCR1B;
+    timer1.timsk = IO_TIMSK1;
+    timer1.tifr = IO_TIFR1;
+    timer1.compareAVector = 6;
+    timer1.sixteenBit = true;
+    initTimer(&timer1);
+
+    for (uint8_t c = 0; c < HOSTHAL_ADC_CHANNELS; ++c) {
+        analogInputs[c] = 0.0;
+    }
+    supplyVoltage = 5.0;
+    adcConverting = false;
+    adcFirstConversion = true;
+
+    eepromWriting = false;
+    watchdogEnabled = false;
+
+    flagRegisterAccessed = 0;
+
+    for (uint8_t v = 0; v < _VECTORS_SIZE; ++v) {
+        raisedAt[v] = HOSTHAL_NEVER;
+    }
+    wokeAt = 0;
+}
+
+void HostHAL_setTimingObserver (
+    const HostHAL_TimingObserver* observer)
+{
+    timingObserver = observer;
+}
+
+uint64_t HostHAL_cycles (void)
+{
+    return cycles;
+}
+
+void HostHAL_setPinDrive (
+    const HostHAL_port port,
+    const uint8_t pin,
+    const HostHAL_pinDrive drive)
+{
+    const uint8_t mask = 1 << pin;
+    switch (drive) {
+        case pd_float :
+            externalDriven[port] &= ~mask;
+            externalHigh[port] &= ~mask;
+            break;
+        case pd_low :
+            externalDriven[port] |= mask;
+            externalHigh[port] &= ~mask;
+            break;
+        case pd_high :
+            externalDriven[port] |= mask;
+            externalHigh[port] |= mask;
+            break;
+    }
+}
+
+void HostHAL_setAnalogInput (
+    const uint8_t channel,
+    const double volts)
+{
+    if (channel < HOSTHAL_ADC_CHANNELS) {
+        analogInputs[channel] = volts;
+    }
+}
+
+void HostHAL_setSupplyVoltage (
+    const double volts)
+{
+    supplyVoltage = volts;
+}
+
+uint8_t HostHAL_portOutputs (
+    const HostHAL_port port)
+{
+    return lastOutputs[port];
+}
+
+uint8_t HostHAL_portDirections (
+    const HostHAL_port port)
+{
+    return lastDirections[port];
+}
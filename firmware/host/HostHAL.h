@@ -0,0 +1,150 @@
+//
+//  Host Hardware Abstraction Layer
+//
+//  Simulates the parts of the AtTiny84 the firmware uses, so the
+//  firmware can be compiled and run on the host:
+//      I/O registers, SREG and the interrupt controller
+//      Timer 0 and Timer 1 (normal and CTC modes, compare, overflow,
+//          Timer 1 input capture)
+//      port A and B pins, pull-ups and pin change interrupts
+//      ADC (single conversions, 10-bit result, auto triggered by
+//          Timer0 compare match A or Timer1 compare match B)
+//      USI in three-wire mode, clocked by Timer0 compare match
+//      EEPROM (register interface, with write time)
+//      watchdog timer, idle and ADC noise reduction sleep
+//
+//  Time is counted in CPU cycles. It advances by a fixed amount on
+//  every register access and jumps ahead to the next interrupt when
+//  the firmware sleeps. Code between register accesses takes no time,
+//  so this is good for checking behavior over hours of simulated time
+//  but not for measuring cycle counts. The timings reported to a
+//  HostHAL_TimingObserver are in the same simulated cycles: they show
+//  how long interrupts are held off and how much register work the
+//  firmware does between sleeps, and are for comparing one build with
+//  another rather than for predicting the chip's figures.
+//
+//  A simulation driver supplies the HostSim_ functions below: it sets
+//  the external pin levels and analog voltages and watches the outputs.
+//
+#ifndef HOSTHAL_H
+#define HOSTHAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HOSTHAL_NEVER UINT64_MAX
+
+#define HOSTHAL_EEPROM_SIZE 512
+#define HOSTHAL_ADC_CHANNELS 9
+
+// simulated time charged for each register access, and for
+// entering and leaving an interrupt handler
+#define HOSTHAL_CYCLES_PER_ACCESS 2
+#define HOSTHAL_CYCLES_PER_INTERRUPT 30
+
+typedef enum HostHAL_port_enum {
+    hp_portA,
+    hp_portB
+} HostHAL_port;
+
+// what the outside world does to a pin
+typedef enum HostHAL_pinDrive_enum {
+    pd_float,   // reads the pull-up if it is on, otherwise low
+    pd_low,
+    pd_high
+} HostHAL_pinDrive;
+
+//
+// used by the shim headers in host/avr
+//
+extern volatile uint8_t* HostHAL_io8 (
+    const uint8_t address);
+extern volatile uint16_t* HostHAL_io16 (
+    const uint8_t address);
+extern void HostHAL_cli (void);
+extern void HostHAL_sei (void);
+extern void HostHAL_sleep (void);
+extern void HostHAL_wdtEnable (
+    const uint8_t timeout);
+extern void HostHAL_wdtDisable (void);
+extern void HostHAL_wdtReset (void);
+extern void HostHAL_delayCycles (
+    const uint64_t cycles);
+
+//
+// used by the simulation driver
+//
+
+// puts the chip in its power-on state. EEPROM contents are kept
+extern void HostHAL_Initialize (void);
+
+extern uint64_t HostHAL_cycles (void);
+
+extern void HostHAL_setPinDrive (
+    const HostHAL_port port,
+    const uint8_t pin,
+    const HostHAL_pinDrive drive);
+
+// sets the voltage at an ADC input. channels 0..7 are the ADCn pins,
+// 8 is the internal temperature sensor
+extern void HostHAL_setAnalogInput (
+    const uint8_t channel,
+    const double volts);
+
+extern void HostHAL_setSupplyVoltage (
+    const double volts);
+
+// levels the chip is driving on a port's output pins, and which
+// pins are outputs
+extern uint8_t HostHAL_portOutputs (
+    const HostHAL_port port);
+extern uint8_t HostHAL_portDirections (
+    const HostHAL_port port);
+
+extern uint8_t HostHAL_eeprom[HOSTHAL_EEPROM_SIZE];
+
+// timing notifications, for benchmarks. Any may be NULL
+typedef struct HostHAL_TimingObserver_struct {
+    // an interrupt handler was entered <latency> cycles after its
+    // flag was raised
+    void (*interruptEntered)(
+        const uint8_t vector,
+        const uint64_t latency);
+    // ...and returned <duration> cycles after the interrupt was taken
+    void (*interruptReturned)(
+        const uint8_t vector,
+        const uint64_t duration);
+    // the firmware is going to sleep, <awake> cycles after it last
+    // woke up
+    void (*sleeping)(
+        const uint64_t cycle,
+        const uint64_t awake);
+} HostHAL_TimingObserver;
+
+// NULL to stop the notifications
+extern void HostHAL_setTimingObserver (
+    const HostHAL_TimingObserver* observer);
+
+//
+// supplied by the simulation driver
+//
+
+// called when simulated time reaches the cycle the driver last asked
+// for (and once at cycle 0). The driver updates the inputs and
+// returns the cycle it next wants to be called at, or HOSTHAL_NEVER
+extern uint64_t HostSim_updateInputs (
+    const uint64_t cycle);
+
+// called when the chip changes the level or direction of an output pin.
+// Returns the cycle the driver wants HostSim_updateInputs called at if
+// that is sooner than it last asked for, otherwise HOSTHAL_NEVER
+extern uint64_t HostSim_outputsChanged (
+    const uint64_t cycle);
+
+// called when the watchdog times out, or the firmware gets into a
+// state the simulator can't continue from. Must not return
+extern void HostSim_halt (
+    const uint64_t cycle,
+    const char* reason);
+
+#endif  // HOSTHAL_H
@@ -0,0 +1,64 @@
+//
+//  avr-libc functions that the host C library doesn't have
+//
+
+#include "HostLibc.h"
+
+char* ultoa (
+    unsigned long value,
+    char* buffer,
+    int radix)
+{
+    char digits[8 * sizeof(unsigned long) + 1];
+    int numDigits = 0;
+
+    if ((radix < 2) || (radix > 36)) {
+        buffer[0] = 0;
+    } else {
+        do {
+            const int digit = value % radix;
+            digits[numDigits++] = (digit < 10) ? ('0' + digit) : ('a' + digit - 10);
+            value /= radix;
+        } while (value != 0);
+
+        int i = 0;
+        while (numDigits > 0) {
+            buffer[i++] = digits[--numDigits];
+        }
+        buffer[i] = 0;
+    }
+
+    return buffer;
+}
+
+char* ltoa (
+    long value,
+    char* buffer,
+    int radix)
+{
+    // like avr-libc, only radix 10 values are signed
+    if ((value < 0) && (radix == 10)) {
+        buffer[0] = '-';
+        ultoa(-(unsigned long)value, &buffer[1], radix);
+    } else {
+        ultoa((unsigned long)value, buffer, radix);
+    }
+
+    return buffer;
+}
+
+char* itoa (
+    int value,
+    char* buffer,
+    int radix)
+{
+    return ltoa(value, buffer, radix);
+}
+
+char* utoa (
+    unsigned int value,
+    char* buffer,
+    int radix)
+{
+    return ultoa(value, buffer, radix);
+}
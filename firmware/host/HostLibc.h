@@ -0,0 +1,29 @@
+//
+//  avr-libc functions that the host C library doesn't have
+//
+//  Included ahead of every firmware source by the host Makefile.
+//
+#ifndef HOSTLIBC_H
+#define HOSTLIBC_H
+
+extern char* itoa (
+    int value,
+    char* buffer,
+    int radix);
+
+extern char* utoa (
+    unsigned int value,
+    char* buffer,
+    int radix);
+
+extern char* ltoa (
+    long value,
+    char* buffer,
+    int radix);
+
+extern char* ultoa (
+    unsigned long value,
+    char* buffer,
+    int radix);
+
+#endif  // HOSTLIBC_H
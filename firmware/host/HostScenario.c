@@ -0,0 +1,280 @@
+//
+//  Host Scenario
+//
+#include "HostScenario.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include "HostHAL.h"
+#include "HostBoard.h"
+
+#define LINE_LENGTH 256
+
+typedef enum ValueType_enum {
+    vt_none,
+    vt_onOff,
+    vt_number,
+    vt_text
+} ValueType;
+
+static const struct {
+    const char* name;
+    ValueType valueType;
+} signals[] = {
+    { "mains",       vt_onOff },    // ss_mains
+    { "battery",     vt_number },   // ss_battery
+    { "light",       vt_number },   // ss_light
+    { "roomlights",  vt_onOff },    // ss_roomLights
+    { "motion",      vt_onOff },    // ss_motion
+    { "button",      vt_onOff },    // ss_button
+    { "temperature", vt_number },   // ss_temperature
+    { "serialskew",  vt_number },   // ss_serialSkew
+    { "send",        vt_text },     // ss_send
+    { "end",         vt_none }      // ss_end
+};
+#define NUM_SIGNALS (sizeof(signals) / sizeof(signals[0]))
+
+void HostScenario_Initialize (
+    HostScenario* scenario)
+{
+    scenario->events = NULL;
+    scenario->numEvents = 0;
+    scenario->capacity = 0;
+    scenario->nextEvent = 0;
+    scenario->ended = false;
+}
+
+void HostScenario_clear (
+    HostScenario* scenario)
+{
+    scenario->numEvents = 0;
+    scenario->nextEvent = 0;
+    scenario->ended = false;
+}
+
+void HostScenario_free (
+    HostScenario* scenario)
+{
+    free(scenario->events);
+    HostScenario_Initialize(scenario);
+}
+
+void HostScenario_add (
+    const uint64_t cycle,
+    const HostScenario_signal signal,
+    const double value,
+    const char* text,
+    HostScenario* scenario)
+{
+    if (scenario->numEvents == scenario->capacity) {
+        scenario->capacity = (scenario->capacity == 0) ? 64 : (scenario->capacity * 2);
+        scenario->events = realloc(scenario->events,
+            scenario->capacity * sizeof(HostScenario_Event));
+        if (scenario->events == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+    }
+
+    HostScenario_Event* event = &scenario->events[scenario->numEvents++];
+    event->cycle = cycle;
+    event->signal = signal;
+    event->value = value;
+    event->text[0] = 0;
+    if (text != NULL) {
+        strncpy(event->text, text, sizeof(event->text) - 1);
+        event->text[sizeof(event->text) - 1] = 0;
+    }
+}
+
+static char* skipSpace (
+    char* cp)
+{
+    while (isspace((unsigned char)*cp)) {
+        ++cp;
+    }
+    return cp;
+}
+
+static char* nextWord (
+    char** cp)
+{
+    char* word = skipSpace(*cp);
+    char* end = word;
+    while ((*end != 0) && !isspace((unsigned char)*end)) {
+        ++end;
+    }
+    if (*end != 0) {
+        *end++ = 0;
+    }
+    *cp = end;
+    return word;
+}
+
+bool HostScenario_load (
+    const char* path,
+    HostScenario* scenario)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+
+    bool ok = true;
+    uint32_t lineNumber = 0;
+    uint64_t lastCycle = 0;
+    char line[LINE_LENGTH];
+    while (ok && (fgets(line, sizeof(line), file) != NULL)) {
+        ++lineNumber;
+        line[strcspn(line, "\r\n")] = 0;
+        char* cp = skipSpace(line);
+        if ((*cp == 0) || (*cp == '#')) {
+            continue;
+        }
+
+        const char* timeWord = nextWord(&cp);
+        const char* signalWord = nextWord(&cp);
+        char* end;
+        const double seconds = strtod(timeWord, &end);
+        uint8_t s = 0;
+        while ((s < NUM_SIGNALS) && (strcasecmp(signalWord, signals[s].name) != 0)) {
+            ++s;
+        }
+        const uint64_t cycle = (uint64_t)(seconds * HOSTBOARD_CYCLES_PER_SECOND + 0.5);
+        if ((*end != 0) || (seconds < 0.0) || (cycle < lastCycle)) {
+            fprintf(stderr, "%s:%u: bad time '%s'\n", path, lineNumber, timeWord);
+            ok = false;
+        } else if (s == NUM_SIGNALS) {
+            fprintf(stderr, "%s:%u: unknown signal '%s'\n", path, lineNumber, signalWord);
+            ok = false;
+        } else {
+            double value = 0.0;
+            const char* text = NULL;
+            switch (signals[s].valueType) {
+                case vt_none :
+                    break;
+                case vt_onOff : {
+                    const char* valueWord = nextWord(&cp);
+                    if (strcasecmp(valueWord, "on") == 0) {
+                        value = 1.0;
+                    } else if (strcasecmp(valueWord, "off") != 0) {
+                        fprintf(stderr, "%s:%u: expected on or off\n", path, lineNumber);
+                        ok = false;
+                    }
+                    break;
+                }
+                case vt_number : {
+                    const char* valueWord = nextWord(&cp);
+                    value = strtod(valueWord, &end);
+                    if ((*valueWord == 0) || (*end != 0)) {
+                        fprintf(stderr, "%s:%u: expected a number\n", path, lineNumber);
+                        ok = false;
+                    }
+                    break;
+                }
+                case vt_text :
+                    text = skipSpace(cp);
+                    break;
+            }
+            if (ok) {
+                HostScenario_add(cycle, (HostScenario_signal)s, value, text, scenario);
+                lastCycle = cycle;
+            }
+        }
+    }
+    fclose(file);
+
+    return ok;
+}
+
+void HostScenario_writeEvent (
+    const HostScenario_Event* event,
+    FILE* file)
+{
+    fprintf(file, "%s", signals[event->signal].name);
+    switch (signals[event->signal].valueType) {
+        case vt_none :
+            break;
+        case vt_onOff :
+            fprintf(file, " %s", (event->value != 0.0) ? "on" : "off");
+            break;
+        case vt_number :
+            fprintf(file, " %g", event->value);
+            break;
+        case vt_text :
+            fprintf(file, " %s", event->text);
+            break;
+    }
+}
+
+void HostScenario_write (
+    const HostScenario* scenario,
+    FILE* file)
+{
+    for (uint32_t e = 0; e < scenario->numEvents; ++e) {
+        const HostScenario_Event* event = &scenario->events[e];
+        fprintf(file, "%.6f ", (double)event->cycle / HOSTBOARD_CYCLES_PER_SECOND);
+        HostScenario_writeEvent(event, file);
+        fprintf(file, "\n");
+    }
+}
+
+uint64_t HostScenario_apply (
+    const uint64_t cycle,
+    HostScenario* scenario)
+{
+    while ((scenario->nextEvent < scenario->numEvents) &&
+           (scenario->events[scenario->nextEvent].cycle <= cycle)) {
+        const HostScenario_Event* event = &scenario->events[scenario->nextEvent++];
+        const bool on = (event->value != 0.0);
+        switch (event->signal) {
+            case ss_mains :
+                HostBoard_setMains(cycle, on);
+                break;
+            case ss_battery :
+                HostBoard_setBatteryVolts(event->value);
+                break;
+            case ss_light :
+                HostBoard_setAmbientLight(event->value);
+                break;
+            case ss_roomLights :
+                HostBoard_setRoomLights(on);
+                break;
+            case ss_motion :
+                HostBoard_setMotion(on);
+                break;
+            case ss_button :
+                HostBoard_setButton(on);
+                break;
+            case ss_temperature :
+                HostBoard_setTemperature(event->value);
+                break;
+            case ss_serialSkew :
+                HostBoard_setSerialSkew(event->value);
+                break;
+            case ss_send : {
+                char line[HOSTSCENARIO_MAX_TEXT + 1];
+                snprintf(line, sizeof(line), "%s\r", event->text);
+                HostBoard_sendLine(cycle, line);
+                break;
+            }
+            case ss_end :
+                scenario->ended = true;
+                break;
+        }
+    }
+
+    return (scenario->nextEvent < scenario->numEvents)
+        ? scenario->events[scenario->nextEvent].cycle
+        : HOSTHAL_NEVER;
+}
+
+bool HostScenario_ended (
+    const HostScenario* scenario)
+{
+    return scenario->ended;
+}
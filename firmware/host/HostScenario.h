@@ -0,0 +1,107 @@
+//
+//  Host Scenario
+//
+//  A list of timed changes to the board's inputs (see HostBoard.h),
+//  scripted by hand, recorded from a real unit, or generated. As text,
+//  one event per line:
+//
+//      <seconds> <signal> <value>
+//
+//  Signals and values:
+//      mains       on | off
+//      battery     resting battery voltage
+//      light       ambient light, 0..1
+//      roomlights  on | off
+//      motion      on | off
+//      button      on | off (pressed or released)
+//      temperature degrees C
+//      serialskew  percent the serial input's bit times are longer (or,
+//                  negative, shorter) than nominal, as from a sender
+//                  whose clock is off
+//      send        text to send on the serial input, to the end of the
+//                  line (a carriage return is added)
+//      end         (no value) the scenario is over
+//
+//  Blank lines and lines starting with # are ignored. Events must be
+//  in time order.
+//
+#ifndef HOSTSCENARIO_H
+#define HOSTSCENARIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define HOSTSCENARIO_MAX_TEXT 32
+
+typedef enum HostScenario_signal_enum {
+    ss_mains,
+    ss_battery,
+    ss_light,
+    ss_roomLights,
+    ss_motion,
+    ss_button,
+    ss_temperature,
+    ss_serialSkew,
+    ss_send,
+    ss_end
+} HostScenario_signal;
+
+typedef struct HostScenario_Event_struct {
+    uint64_t cycle;
+    HostScenario_signal signal;
+    double value;       // 0 or 1 for on/off signals
+    char text[HOSTSCENARIO_MAX_TEXT];
+} HostScenario_Event;
+
+typedef struct HostScenario_struct {
+    HostScenario_Event* events;
+    uint32_t numEvents;
+    uint32_t capacity;
+    uint32_t nextEvent;     // first event not yet applied
+    bool ended;             // the end event has been applied
+} HostScenario;
+
+extern void HostScenario_Initialize (
+    HostScenario* scenario);
+
+// empties the scenario, keeping its storage
+extern void HostScenario_clear (
+    HostScenario* scenario);
+
+extern void HostScenario_free (
+    HostScenario* scenario);
+
+// appends an event. <text> is only used by ss_send, and may be NULL
+extern void HostScenario_add (
+    const uint64_t cycle,
+    const HostScenario_signal signal,
+    const double value,
+    const char* text,
+    HostScenario* scenario);
+
+// reads a scenario file. Reports problems on stderr and returns false
+extern bool HostScenario_load (
+    const char* path,
+    HostScenario* scenario);
+
+extern void HostScenario_write (
+    const HostScenario* scenario,
+    FILE* file);
+
+// writes an event's signal and value, without its time or a newline
+extern void HostScenario_writeEvent (
+    const HostScenario_Event* event,
+    FILE* file);
+
+// applies the events due by <cycle> to the board. Returns the cycle of
+// the next event, or HOSTHAL_NEVER
+extern uint64_t HostScenario_apply (
+    const uint64_t cycle,
+    HostScenario* scenario);
+
+// true once the end event has been applied
+extern bool HostScenario_ended (
+    const HostScenario* scenario);
+
+#endif  // HOSTSCENARIO_H
@@ -0,0 +1,872 @@
+//
+//  Host Simulator
+//
+//  Runs the firmware on the host against HostHAL and the board model
+//  in HostBoard, much faster than real time. It can be driven three
+//  ways:
+//
+//  24 hour outage (the default)
+//      The scenario starts at 17:00 with mains on and the room lights
+//      on. Mains fail at 19:00 and come back at 19:00 the next day.
+//      Someone is in the room (and sets off the motion detector) from
+//      17:00 to 23:30. A status request is sent over the serial port
+//      every 10 minutes. The battery is a 7Ah lead-acid cell, charged
+//      while mains are on and discharged by the LED load.
+//
+//  Scenario file (-s)
+//      Plays a scripted or recorded scenario (see HostScenario.h) from
+//      power-on.
+//
+//  Randomized outages (-r)
+//      Boots the firmware once with mains on, then runs <count> short
+//      random scenarios from that point. Ambient light, room lights,
+//      battery voltage, temperature and motion are picked at random,
+//      the pushbutton is sometimes pressed, and mains fail for between
+//      20ms and 20s. Each scenario runs in a forked copy of the
+//      simulator, so they all start from the same state. Prints the
+//      switchover latencies and what PowerCommand decided over all
+//      the scenarios. -g <n> prints scenario n as a scenario file,
+//      which -s replays.
+//
+//  The first two print a log of the inputs changing, the battery and
+//  adapter FETs switching, and the lines and binary frames (decoded,
+//  in hex) the firmware sends, time-stamped with simulated time, followed by a summary. With -t
+//  they also report the main loop and interrupt timings (see
+//  HostTiming.h), and with -b they check the timings against the
+//  budgets file for the scenario (named after the scenario file,
+//  without its directory or extension).
+//
+//  Usage:
+//      LightingUPS-host [-q] [-t]
+//      LightingUPS-host [-q] [-t] [-b <budgets file>] -s <scenario file>
+//      LightingUPS-host [-v] -r <count> [-S <seed>]
+//      LightingUPS-host -g <n> [-S <seed>]
+//          -q  print only the summary
+//          -v  print a line for each scenario
+//
+//  The exit status is 1 if the firmware halted (a watchdog reset, or a
+//  state the simulator can't continue from) or went over a budget.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <setjmp.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "HostHAL.h"
+#include "HostBoard.h"
+#include "HostScenario.h"
+#include "HostTiming.h"
+#include "crc8.h"
+
+// the firmware's main(), renamed by the host Makefile
+extern int firmware_main (void);
+
+#define CYCLES_PER_SECOND HOSTBOARD_CYCLES_PER_SECOND
+#define SECONDS(s) ((uint64_t)((s) * CYCLES_PER_SECOND))
+#define MINUTES(m) SECONDS((m) * 60)
+#define HOURS(h) MINUTES((h) * 60)
+
+// 24 hour outage
+#define START_HOUR          17.0
+#define OUTAGE_START        HOURS(2)
+#define OUTAGE_END          (OUTAGE_START + HOURS(24))
+#define RUN_END             (OUTAGE_END + MINUTES(30))
+#define ROOM_OCCUPIED_FROM  17.0    // hour of day
+#define ROOM_OCCUPIED_UNTIL 23.5
+#define MOTION_INTERVAL     SECONDS(60)
+#define MOTION_DURATION     SECONDS(3)
+#define STATUS_INTERVAL     MINUTES(10)
+#define ENVIRONMENT_STEP    SECONDS(1)
+#define BATTERY_CAPACITY_AH 7.0
+#define LED_LOAD_AMPS       1.0
+#define CHARGE_AMPS         0.7
+
+// scenario files without an end event end this long after the last event
+#define SCENARIO_RUN_ON     SECONDS(10)
+
+// randomized outages
+#define WARMUP_TIME         SECONDS(10)
+#define MIN_OUTAGE          0.02    // seconds
+#define MAX_OUTAGE          20.0
+#define RUN_ON_AFTER_OUTAGE SECONDS(3)
+
+typedef enum Mode_enum {
+    m_dayLong,
+    m_scenarioFile,
+    m_randomized,
+    m_printRandomScenario
+} Mode;
+
+typedef struct {
+    uint32_t switchovers;
+    uint64_t timeOnBattery;
+    uint64_t batteryOnSince;
+    uint64_t worstSwitchover;
+    double minBatteryVolts;
+    uint32_t linesReceived;
+    uint32_t framesReceived;
+    uint32_t badFrames;         // that didn't decode or failed the crc
+} Summary;
+
+// what happened around the outage in one randomized scenario
+typedef struct {
+    bool halted;
+    char haltReason[40];
+    bool roomLightsOn;
+    bool ledsOnAtOutage;
+    bool lit;                   // battery FET came on while mains were off
+    uint64_t switchLatency;     // mains off to battery FET on
+    bool ledsOnAtReturn;
+    bool adapterOn;             // adapter FET came on after mains returned
+    uint64_t returnLatency;     // mains on to adapter FET on
+} ScenarioResult;
+
+// state variables
+static jmp_buf runEnd;
+static Mode mode = m_dayLong;
+static bool quiet = false;
+static bool verbose = false;
+static bool timing = false;
+static Summary summary;
+static HostScenario scenario;
+static uint64_t runEndCycle;
+static uint64_t mainsWentOff;   // HOSTHAL_NEVER while mains are on
+static uint64_t mainsCameOn;    // HOSTHAL_NEVER while mains are off
+static ScenarioResult result;
+static uint32_t scenarioCount;
+static uint64_t seed = 1;
+static int resultPipe = -1;     // set in a randomized scenario's process
+
+// 24 hour outage
+static double batteryCharge;    // 0..1
+static uint64_t nextEnvironmentStep;
+static uint64_t nextStatusRequest;
+
+static void printTime (
+    const uint64_t cycle)
+{
+    const uint64_t ms = cycle / (CYCLES_PER_SECOND / 1000);
+    const uint64_t s = ms / 1000;
+    printf("%3u:%02u:%02u.%03u ",
+        (unsigned)(s / 3600), (unsigned)((s / 60) % 60),
+        (unsigned)(s % 60), (unsigned)(ms % 1000));
+}
+
+static double milliseconds (
+    const uint64_t cycles)
+{
+    return (double)cycles * 1000.0 / CYCLES_PER_SECOND;
+}
+
+static void mainsChanged (
+    const uint64_t cycle,
+    const bool on)
+{
+    const bool ledsOn = HostBoard_batteryFETOn() || HostBoard_adapterFETOn();
+    if (on) {
+        mainsWentOff = HOSTHAL_NEVER;
+        mainsCameOn = cycle;
+        result.ledsOnAtReturn = ledsOn;
+        result.adapterOn = false;
+    } else {
+        mainsWentOff = cycle;
+        mainsCameOn = HOSTHAL_NEVER;
+        result.ledsOnAtOutage = ledsOn;
+        result.lit = false;
+    }
+}
+
+static void outputChanged (
+    const uint64_t cycle,
+    const HostBoard_output output,
+    const bool on)
+{
+    if (!quiet) {
+        printTime(cycle);
+        printf("%s FET %s\n", (output == bo_batteryFET) ? "battery" : "adapter",
+            on ? "on" : "off");
+    }
+
+    if (output == bo_batteryFET) {
+        if (on) {
+            ++summary.switchovers;
+            summary.batteryOnSince = cycle;
+            if ((mainsWentOff != HOSTHAL_NEVER) && !result.lit) {
+                // first switch to battery since mains went off
+                result.lit = true;
+                result.switchLatency = cycle - mainsWentOff;
+                if (result.switchLatency > summary.worstSwitchover) {
+                    summary.worstSwitchover = result.switchLatency;
+                }
+            }
+        } else {
+            summary.timeOnBattery += cycle - summary.batteryOnSince;
+        }
+    } else if (on && (mainsCameOn != HOSTHAL_NEVER) && !result.adapterOn) {
+        result.adapterOn = true;
+        result.returnLatency = cycle - mainsCameOn;
+    }
+}
+
+static void lineReceived (
+    const uint64_t cycle,
+    const char* line)
+{
+    ++summary.linesReceived;
+    if (!quiet) {
+        printTime(cycle);
+        printf("tx: %s\n", line);
+    }
+}
+
+// undoes COBS_encode. Returns the length of the data, or 0 if the
+// encoding is broken
+static uint8_t decodeCOBS (
+    const uint8_t* encoded,
+    const uint8_t length,
+    uint8_t* data)
+{
+    uint8_t dataLength = 0;
+    uint8_t i = 0;
+    while (i < length) {
+        const uint8_t code = encoded[i++];
+        if ((code == 0) || ((i + code - 1) > length)) {
+            return 0;
+        }
+        for (uint8_t n = 1; n < code; ++n) {
+            data[dataLength++] = encoded[i++];
+        }
+        if (i < length) {
+            data[dataLength++] = 0;
+        }
+    }
+
+    return dataLength;
+}
+
+static void frameReceived (
+    const uint64_t cycle,
+    const uint8_t* frame,
+    const uint8_t length)
+{
+    uint8_t data[256];
+    const uint8_t dataLength = decodeCOBS(frame, length, data);
+    const bool good = (dataLength > 1) &&
+        (crc8(data, dataLength - 1) == data[dataLength - 1]);
+
+    ++summary.framesReceived;
+    if (!good) {
+        ++summary.badFrames;
+    }
+    if (!quiet) {
+        printTime(cycle);
+        if (good) {
+            printf("tx frame:");
+            for (uint8_t i = 0; i < (dataLength - 1); ++i) {
+                printf(" %02X", data[i]);
+            }
+            printf("\n");
+        } else {
+            printf("tx frame: bad (%u bytes)\n", length);
+        }
+    }
+}
+
+static const HostBoard_Listener boardListener = {
+    outputChanged,
+    lineReceived,
+    frameReceived
+};
+
+static void checkBatteryVolts (void)
+{
+    const double volts = HostBoard_batteryVolts();
+    if (volts < summary.minBatteryVolts) {
+        summary.minBatteryVolts = volts;
+    }
+}
+
+static double hourOfDay (
+    const uint64_t cycle)
+{
+    const double hours = START_HOUR + ((double)cycle / (double)HOURS(1));
+    return fmod(hours, 24.0);
+}
+
+static double sunlight (
+    const double hour)
+{
+    // sun up from 6:30 to 19:30
+    const double sun = sin(M_PI * (hour - 6.5) / 13.0);
+    return (sun > 0.0) ? (0.9 * sun) : 0.0;
+}
+
+static double restingBatteryVolts (
+    const double charge)
+{
+    // lead-acid: fairly flat, then falls steeply when nearly empty
+    return (charge > 0.1)
+        ? (11.6 + (1.2 * charge))
+        : (10.2 + (15.2 * charge));
+}
+
+static void updateEnvironment (
+    const uint64_t cycle)
+{
+    const double hour = hourOfDay(cycle);
+    const double stepHours = (double)ENVIRONMENT_STEP / (double)HOURS(1);
+
+    const bool mainsOn = (cycle < OUTAGE_START) || (cycle >= OUTAGE_END);
+    const bool occupied = (hour >= ROOM_OCCUPIED_FROM) && (hour < ROOM_OCCUPIED_UNTIL);
+
+    // while mains are on the adapter carries the load
+    double amps = 0.0;
+    if (HostBoard_batteryFETOn() && !(HostBoard_adapterFETOn() && mainsOn)) {
+        amps -= LED_LOAD_AMPS;
+    }
+    if (mainsOn) {
+        amps += CHARGE_AMPS;
+    }
+    batteryCharge += (amps * stepHours) / BATTERY_CAPACITY_AH;
+    if (batteryCharge > 1.0) {
+        batteryCharge = 1.0;
+    } else if (batteryCharge < 0.0) {
+        batteryCharge = 0.0;
+    }
+    double batteryVolts = restingBatteryVolts(batteryCharge);
+    if (mainsOn) {
+        // the charger holds the battery up
+        batteryVolts = fmin(13.6, batteryVolts + 0.8);
+    }
+
+    if (mainsOn != HostBoard_mainsOn()) {
+        HostBoard_setMains(cycle, mainsOn);
+        mainsChanged(cycle, mainsOn);
+        if (!quiet) {
+            printTime(cycle);
+            printf("mains %s\n", mainsOn ? "on" : "off");
+        }
+    }
+    HostBoard_setBatteryVolts(batteryVolts);
+    HostBoard_setAmbientLight(sunlight(hour));
+    HostBoard_setRoomLights(occupied);
+    HostBoard_setMotion(occupied && ((cycle % MOTION_INTERVAL) < MOTION_DURATION));
+    checkBatteryVolts();
+}
+
+static uint64_t updateDayLong (
+    const uint64_t cycle)
+{
+    if (cycle >= nextEnvironmentStep) {
+        updateEnvironment(cycle);
+        nextEnvironmentStep = cycle + ENVIRONMENT_STEP;
+    }
+    if (cycle >= nextStatusRequest) {
+        HostBoard_sendLine(cycle, "status\r");
+        nextStatusRequest = cycle + STATUS_INTERVAL;
+    }
+
+    return (nextEnvironmentStep < nextStatusRequest)
+        ? nextEnvironmentStep
+        : nextStatusRequest;
+}
+
+static uint64_t randomNumber (
+    uint64_t* state)
+{
+    // splitmix64
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double randomBetween (
+    uint64_t* state,
+    const double low,
+    const double high)
+{
+    const double fraction = (double)(randomNumber(state) >> 11) / (double)(1ULL << 53);
+    return low + ((high - low) * fraction);
+}
+
+static bool randomChance (
+    uint64_t* state,
+    const double probability)
+{
+    return randomBetween(state, 0.0, 1.0) < probability;
+}
+
+// the state the randomized scenarios all start from
+static void addWarmup (
+    HostScenario* s)
+{
+    HostScenario_add(0, ss_mains, 1, NULL, s);
+    HostScenario_add(0, ss_battery, 13.2, NULL, s);
+    HostScenario_add(0, ss_light, 0.3, NULL, s);
+    HostScenario_add(0, ss_roomLights, 1, NULL, s);
+    HostScenario_add(0, ss_temperature, 25, NULL, s);
+}
+
+typedef struct {
+    uint64_t cycle;
+    HostScenario_signal signal;
+    double value;
+} TimedEvent;
+
+// appends random scenario <index>, starting at <start>. Returns true
+// if the room lights are on
+static bool addRandomScenario (
+    const uint32_t index,
+    const uint64_t start,
+    HostScenario* s)
+{
+    uint64_t state = seed ^ (0xD1B54A32D192ED03ULL * (index + 1));
+
+    // surroundings, then time for the firmware to settle
+    const double light = randomChance(&state, 0.4) ? 0.0 : randomBetween(&state, 0.0, 0.6);
+    const bool roomLightsOn = randomChance(&state, 0.6);
+    HostScenario_add(start, ss_light, light, NULL, s);
+    HostScenario_add(start, ss_roomLights, roomLightsOn, NULL, s);
+    HostScenario_add(start, ss_battery, randomBetween(&state, 10.5, 13.4), NULL, s);
+    HostScenario_add(start, ss_temperature, randomBetween(&state, 0.0, 45.0), NULL, s);
+    const double settle = randomBetween(&state, 2.0, 6.0);
+
+    // outage of 20ms to 20s, evenly spread on a log scale
+    const double outage = exp(randomBetween(&state, log(MIN_OUTAGE), log(MAX_OUTAGE)));
+    const uint64_t outageStart = start + SECONDS(settle);
+    const uint64_t outageEnd = outageStart + SECONDS(outage);
+
+    // someone turns the LEDs on by hand before the outage
+    const bool pressButton = randomChance(&state, 0.25);
+    const uint64_t pressTime = start + SECONDS(randomBetween(&state, 0.5, settle - 0.5));
+    // someone walks past
+    const bool motion = randomChance(&state, 0.5);
+    const uint64_t motionTime = start + SECONDS(randomBetween(&state, 0.0, settle + outage));
+
+    TimedEvent events[] = {
+        { pressButton ? pressTime : HOSTHAL_NEVER, ss_button, 1 },
+        { pressButton ? (pressTime + SECONDS(0.2)) : HOSTHAL_NEVER, ss_button, 0 },
+        { motion ? motionTime : HOSTHAL_NEVER, ss_motion, 1 },
+        { motion ? (motionTime + SECONDS(2)) : HOSTHAL_NEVER, ss_motion, 0 },
+        { outageStart, ss_mains, 0 },
+        { outageEnd, ss_mains, 1 },
+        { outageEnd + RUN_ON_AFTER_OUTAGE, ss_end, 0 }
+    };
+    const uint8_t numEvents = sizeof(events) / sizeof(events[0]);
+
+    // scenario events have to be in time order
+    for (uint8_t i = 1; i < numEvents; ++i) {
+        for (uint8_t j = i; (j > 0) && (events[j].cycle < events[j - 1].cycle); --j) {
+            const TimedEvent t = events[j];
+            events[j] = events[j - 1];
+            events[j - 1] = t;
+        }
+    }
+    for (uint8_t e = 0; e < numEvents; ++e) {
+        if (events[e].cycle != HOSTHAL_NEVER) {
+            HostScenario_add(events[e].cycle, events[e].signal, events[e].value, NULL, s);
+        }
+    }
+
+    return roomLightsOn;
+}
+
+static void sendResult (void)
+{
+    const bool sent = write(resultPipe, &result, sizeof(result)) == sizeof(result);
+    _exit(sent ? 0 : 3);
+}
+
+static int compareCycles (
+    const void* a,
+    const void* b)
+{
+    const uint64_t x = *(const uint64_t*)a;
+    const uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void printLatencies (
+    const char* label,
+    uint64_t* latencies,
+    const uint32_t count)
+{
+    if (count > 0) {
+        qsort(latencies, count, sizeof(uint64_t), compareCycles);
+        printf("    %s ms: min %.1f, median %.1f, 99%% %.1f, max %.1f\n", label,
+            milliseconds(latencies[0]),
+            milliseconds(latencies[count / 2]),
+            milliseconds(latencies[((uint64_t)count * 99) / 100]),
+            milliseconds(latencies[count - 1]));
+    }
+}
+
+static void printResult (
+    const uint32_t index,
+    const ScenarioResult* r)
+{
+    printf("scenario %u: ", index);
+    if (r->halted) {
+        printf("halted: %s\n", r->haltReason);
+    } else {
+        printf("room lights %s, LEDs %s at outage, ",
+            r->roomLightsOn ? "on" : "off", r->ledsOnAtOutage ? "on" : "off");
+        if (r->lit) {
+            printf("battery FET on after %.1f ms\n", milliseconds(r->switchLatency));
+        } else {
+            printf("battery FET stayed off\n");
+        }
+    }
+}
+
+// runs the randomized scenarios, each in a child process that carries
+// on from here. Returns in the children; the parent prints the results
+// and exits
+static void runScenarios (
+    const uint64_t cycle)
+{
+    uint64_t* switchLatencies = malloc(scenarioCount * sizeof(uint64_t));
+    uint64_t* autoLatencies = malloc(scenarioCount * sizeof(uint64_t));
+    uint64_t* returnLatencies = malloc(scenarioCount * sizeof(uint64_t));
+    uint32_t ledsOnAtOutage = 0;
+    uint32_t switched = 0;
+    uint32_t darkWithRoomLights = 0;
+    uint32_t litWithRoomLights = 0;
+    uint32_t darkWithoutRoomLights = 0;
+    uint32_t litWithoutRoomLights = 0;
+    uint32_t ledsOnAtReturn = 0;
+    uint32_t returned = 0;
+    uint32_t halts = 0;
+
+    const time_t startTime = time(NULL);
+    fflush(stdout);
+    for (uint32_t i = 0; i < scenarioCount; ++i) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            exit(2);
+        }
+        const pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            exit(2);
+        } else if (pid == 0) {
+            close(fds[0]);
+            resultPipe = fds[1];
+            result.roomLightsOn = addRandomScenario(i, cycle, &scenario);
+            free(switchLatencies);
+            free(autoLatencies);
+            free(returnLatencies);
+            return;
+        }
+
+        close(fds[1]);
+        ScenarioResult r;
+        if (read(fds[0], &r, sizeof(r)) != sizeof(r)) {
+            memset(&r, 0, sizeof(r));
+            r.halted = true;
+            strcpy(r.haltReason, "simulator crashed");
+        }
+        close(fds[0]);
+        waitpid(pid, NULL, 0);
+
+        if (r.halted) {
+            ++halts;
+        } else {
+            if (r.ledsOnAtOutage) {
+                ++ledsOnAtOutage;
+                if (r.lit) {
+                    switchLatencies[switched++] = r.switchLatency;
+                }
+            } else if (r.roomLightsOn) {
+                ++darkWithRoomLights;
+                if (r.lit) {
+                    autoLatencies[litWithRoomLights + litWithoutRoomLights] = r.switchLatency;
+                    ++litWithRoomLights;
+                }
+            } else {
+                ++darkWithoutRoomLights;
+                if (r.lit) {
+                    autoLatencies[litWithRoomLights + litWithoutRoomLights] = r.switchLatency;
+                    ++litWithoutRoomLights;
+                }
+            }
+            if (r.ledsOnAtReturn) {
+                ++ledsOnAtReturn;
+                if (r.adapterOn) {
+                    returnLatencies[returned++] = r.returnLatency;
+                }
+            }
+        }
+        if (verbose || r.halted) {
+            printResult(i, &r);
+        }
+    }
+    const double wallSeconds = fmax(1.0, difftime(time(NULL), startTime));
+
+    printf("%u scenarios in %.0f s (%.0f per minute), seed %llu\n",
+        scenarioCount, wallSeconds, (scenarioCount * 60.0) / wallSeconds,
+        (unsigned long long)seed);
+    printf("LEDs on when mains failed: %u, switched to battery: %u\n",
+        ledsOnAtOutage, switched);
+    printLatencies("switchover", switchLatencies, switched);
+    printf("LEDs off when mains failed, room lights on: %u, came on: %u\n",
+        darkWithRoomLights, litWithRoomLights);
+    printf("LEDs off when mains failed, room lights off: %u, came on: %u\n",
+        darkWithoutRoomLights, litWithoutRoomLights);
+    printLatencies("automatic on", autoLatencies, litWithRoomLights + litWithoutRoomLights);
+    printf("LEDs on when mains returned: %u, back on adapter: %u\n",
+        ledsOnAtReturn, returned);
+    printLatencies("back on adapter", returnLatencies, returned);
+    printf("halted: %u\n", halts);
+
+    exit((halts == 0) ? 0 : 1);
+}
+
+static uint64_t updateScenario (
+    const uint64_t cycle)
+{
+    if ((mode == m_randomized) && (resultPipe < 0) && (cycle >= WARMUP_TIME)) {
+        runScenarios(cycle);
+    }
+
+    const bool mainsWereOn = HostBoard_mainsOn();
+    const uint32_t firstEvent = scenario.nextEvent;
+    uint64_t next = HostScenario_apply(cycle, &scenario);
+    if (!quiet) {
+        for (uint32_t e = firstEvent; e < scenario.nextEvent; ++e) {
+            printTime(cycle);
+            HostScenario_writeEvent(&scenario.events[e], stdout);
+            printf("\n");
+        }
+    }
+    if (HostBoard_mainsOn() != mainsWereOn) {
+        mainsChanged(cycle, HostBoard_mainsOn());
+    }
+    checkBatteryVolts();
+
+    if (HostScenario_ended(&scenario)) {
+        if (resultPipe >= 0) {
+            sendResult();
+        }
+        longjmp(runEnd, 1);
+    }
+    if ((mode == m_randomized) && (resultPipe < 0) && (WARMUP_TIME < next)) {
+        next = WARMUP_TIME;
+    }
+
+    return next;
+}
+
+uint64_t HostSim_updateInputs (
+    const uint64_t cycle)
+{
+    if (cycle >= runEndCycle) {
+        longjmp(runEnd, 1);
+    }
+
+    uint64_t next = (mode == m_dayLong)
+        ? updateDayLong(cycle)
+        : updateScenario(cycle);
+    const uint64_t boardNext = HostBoard_update(cycle);
+    if (boardNext < next) {
+        next = boardNext;
+    }
+    if (runEndCycle < next) {
+        next = runEndCycle;
+    }
+
+    return next;
+}
+
+uint64_t HostSim_outputsChanged (
+    const uint64_t cycle)
+{
+    return HostBoard_outputsChanged(cycle);
+}
+
+void HostSim_halt (
+    const uint64_t cycle,
+    const char* reason)
+{
+    if (resultPipe >= 0) {
+        result.halted = true;
+        snprintf(result.haltReason, sizeof(result.haltReason), "%s at %.3f s",
+            reason, (double)cycle / CYCLES_PER_SECOND);
+        sendResult();
+    }
+    printTime(cycle);
+    printf("halted: %s\n", reason);
+    longjmp(runEnd, 2);
+}
+
+static void initialize (void)
+{
+    memset(HostHAL_eeprom, 0xFF, sizeof(HostHAL_eeprom));
+    HostHAL_Initialize();
+    HostBoard_Initialize(&boardListener);
+
+    memset(&summary, 0, sizeof(summary));
+    summary.minBatteryVolts = 100.0;
+    memset(&result, 0, sizeof(result));
+    mainsWentOff = HOSTHAL_NEVER;
+    mainsCameOn = HOSTHAL_NEVER;
+
+    batteryCharge = 1.0;
+    nextEnvironmentStep = 0;
+    nextStatusRequest = MINUTES(1);
+}
+
+static void usage (
+    const char* name)
+{
+    fprintf(stderr,
+        "usage: %s [-q] [-t]\n"
+        "       %s [-q] [-t] [-b <budgets file>] -s <scenario file>\n"
+        "       %s [-v] -r <count> [-S <seed>]\n"
+        "       %s -g <n> [-S <seed>]\n",
+        name, name, name, name);
+    exit(2);
+}
+
+int main (
+    int argc,
+    char* argv[])
+{
+    const char* scenarioPath = NULL;
+    const char* budgetsPath = NULL;
+    uint32_t scenarioToPrint = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "qvtb:s:r:g:S:")) != -1) {
+        switch (opt) {
+            case 'q' :
+                quiet = true;
+                break;
+            case 'v' :
+                verbose = true;
+                break;
+            case 't' :
+                timing = true;
+                break;
+            case 'b' :
+                timing = true;
+                budgetsPath = optarg;
+                break;
+            case 's' :
+                mode = m_scenarioFile;
+                scenarioPath = optarg;
+                break;
+            case 'r' :
+                mode = m_randomized;
+                scenarioCount = strtoul(optarg, NULL, 0);
+                break;
+            case 'g' :
+                mode = m_printRandomScenario;
+                scenarioToPrint = strtoul(optarg, NULL, 0);
+                break;
+            case 'S' :
+                seed = strtoull(optarg, NULL, 0);
+                break;
+            default :
+                usage(argv[0]);
+        }
+    }
+    if ((optind != argc) ||
+        (timing && ((mode == m_randomized) || (mode == m_printRandomScenario))) ||
+        ((budgetsPath != NULL) && (mode != m_scenarioFile))) {
+        usage(argv[0]);
+    }
+
+    HostScenario_Initialize(&scenario);
+    runEndCycle = HOSTHAL_NEVER;
+    switch (mode) {
+        case m_dayLong :
+            runEndCycle = RUN_END;
+            break;
+        case m_scenarioFile :
+            if (!HostScenario_load(scenarioPath, &scenario)) {
+                return 2;
+            }
+            if ((scenario.numEvents == 0) ||
+                (scenario.events[scenario.numEvents - 1].signal != ss_end)) {
+                const uint64_t last = (scenario.numEvents == 0)
+                    ? 0
+                    : scenario.events[scenario.numEvents - 1].cycle;
+                HostScenario_add(last + SCENARIO_RUN_ON, ss_end, 0, NULL, &scenario);
+            }
+            break;
+        case m_randomized :
+            if (scenarioCount == 0) {
+                usage(argv[0]);
+            }
+            addWarmup(&scenario);
+            quiet = true;
+            break;
+        case m_printRandomScenario :
+            addWarmup(&scenario);
+            addRandomScenario(scenarioToPrint, WARMUP_TIME, &scenario);
+            HostScenario_write(&scenario, stdout);
+            return 0;
+    }
+
+    initialize();
+    if (timing) {
+        HostTiming_Initialize();
+    }
+
+    const clock_t startClock = clock();
+    const int runResult = setjmp(runEnd);
+    if (runResult == 0) {
+        firmware_main();
+    }
+    const double wallSeconds = (double)(clock() - startClock) / CLOCKS_PER_SEC;
+
+    const uint64_t endCycle = HostHAL_cycles();
+    if (HostBoard_batteryFETOn()) {
+        summary.timeOnBattery += endCycle - summary.batteryOnSince;
+    }
+    const double simSeconds = (double)endCycle / CYCLES_PER_SECOND;
+    printf("simulated %.0f s in %.1f s (%.0fx real time)\n",
+        simSeconds, wallSeconds, simSeconds / fmax(wallSeconds, 0.001));
+    printf("switches to battery: %u, worst after mains off: %.0f ms\n",
+        summary.switchovers, milliseconds(summary.worstSwitchover));
+    printf("time on battery: %.1f h, lowest battery: %.2f V",
+        (double)summary.timeOnBattery / HOURS(1), summary.minBatteryVolts);
+    if (mode == m_dayLong) {
+        printf(", charge at end: %.0f%%", batteryCharge * 100.0);
+    }
+    printf("\nstatus lines received: %u\n", summary.linesReceived);
+    if (summary.framesReceived > 0) {
+        printf("status frames received: %u, bad: %u\n",
+            summary.framesReceived, summary.badFrames);
+    }
+
+    bool withinBudget = true;
+    if (timing) {
+        HostTiming_report(stdout);
+    }
+    if (budgetsPath != NULL) {
+        // the scenario's name is its file name, without the extension
+        const char* nameStart = strrchr(scenarioPath, '/');
+        nameStart = (nameStart != NULL) ? (nameStart + 1) : scenarioPath;
+        char name[64];
+        snprintf(name, sizeof(name), "%s", nameStart);
+        char* extension = strrchr(name, '.');
+        if (extension != NULL) {
+            *extension = 0;
+        }
+        withinBudget = HostTiming_checkBudgets(budgetsPath, name, stdout);
+    }
+
+    HostScenario_free(&scenario);
+
+    return ((runResult == 1) && withinBudget) ? 0 : 1;
+}
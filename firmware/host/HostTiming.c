@@ -0,0 +1,286 @@
+//
+//  Host Timing
+//
+#include "HostTiming.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+
+#include "HostHAL.h"
+#include <avr/io.h>
+
+#define LINE_LENGTH 256
+
+typedef enum Statistic_enum {
+    st_p50,
+    st_p99,
+    st_max,
+    st_count
+} Statistic;
+
+typedef struct {
+    uint32_t* samples;
+    uint32_t numSamples;
+    uint32_t capacity;
+    bool sorted;
+} SampleSet;
+
+// handler names, by vector number
+static const char* const vectorNames[_VECTORS_SIZE] = {
+    "RESET",
+    "SIG_INTERRUPT0",
+    "SIG_PIN_CHANGE0",
+    "SIG_PIN_CHANGE1",
+    "SIG_WATCHDOG_TIMEOUT",
+    "SIG_INPUT_CAPTURE1",
+    "SIG_OUTPUT_COMPARE1A",
+    "SIG_OUTPUT_COMPARE1B",
+    "SIG_OVERFLOW1",
+    "SIG_OUTPUT_COMPARE0A",
+    "SIG_OUTPUT_COMPARE0B",
+    "SIG_OVERFLOW0",
+    "SIG_COMPARATOR",
+    "SIG_ADC",
+    "SIG_EEPROM_READY",
+    "SIG_USI_START",
+    "SIG_USI_OVERFLOW"
+};
+
+static const char* const statisticNames[] = { "p50", "p99", "max" };
+
+// state variables
+static SampleSet latencies[_VECTORS_SIZE];
+static SampleSet durations[_VECTORS_SIZE];
+static SampleSet awake;
+static SampleSet boot;          // power-on to the first sleep
+static bool booted;
+
+static void addSample (
+    const uint64_t value,
+    SampleSet* set)
+{
+    if (set->numSamples == set->capacity) {
+        set->capacity = (set->capacity == 0) ? 1024 : (set->capacity * 2);
+        set->samples = realloc(set->samples, set->capacity * sizeof(uint32_t));
+        if (set->samples == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+    }
+    set->samples[set->numSamples++] = (value > UINT32_MAX) ? UINT32_MAX : (uint32_t)value;
+    set->sorted = false;
+}
+
+static int compareSamples (
+    const void* a,
+    const void* b)
+{
+    const uint32_t x = *(const uint32_t*)a;
+    const uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// 0 if there are no samples
+static uint32_t statistic (
+    const Statistic stat,
+    SampleSet* set)
+{
+    uint32_t value = 0;
+
+    if (set->numSamples > 0) {
+        if (!set->sorted) {
+            qsort(set->samples, set->numSamples, sizeof(uint32_t), compareSamples);
+            set->sorted = true;
+        }
+        switch (stat) {
+            case st_p50 :
+                value = set->samples[set->numSamples / 2];
+                break;
+            case st_p99 :
+                value = set->samples[((uint64_t)set->numSamples * 99) / 100];
+                break;
+            default :
+                value = set->samples[set->numSamples - 1];
+                break;
+        }
+    }
+
+    return value;
+}
+
+static void interruptEntered (
+    const uint8_t vector,
+    const uint64_t latency)
+{
+    if (booted) {
+        addSample(latency, &latencies[vector]);
+    }
+}
+
+static void interruptReturned (
+    const uint8_t vector,
+    const uint64_t duration)
+{
+    if (booted) {
+        addSample(duration, &durations[vector]);
+    }
+}
+
+static void sleeping (
+    const uint64_t cycle,
+    const uint64_t awakeCycles)
+{
+    // startup (with interrupts off, and EEPROM writes on a blank chip)
+    // is reported on its own so it doesn't swamp the figures
+    if (booted) {
+        addSample(awakeCycles, &awake);
+    } else {
+        addSample(cycle, &boot);
+        booted = true;
+    }
+}
+
+static const HostHAL_TimingObserver observer = {
+    interruptEntered,
+    interruptReturned,
+    sleeping
+};
+
+void HostTiming_Initialize (void)
+{
+    for (uint8_t v = 0; v < _VECTORS_SIZE; ++v) {
+        latencies[v].numSamples = 0;
+        durations[v].numSamples = 0;
+    }
+    awake.numSamples = 0;
+    boot.numSamples = 0;
+    booted = false;
+
+    HostHAL_setTimingObserver(&observer);
+}
+
+static void reportSet (
+    const char* name,
+    const char* measure,
+    SampleSet* set,
+    FILE* file)
+{
+    fprintf(file, "%-22s %-9s %8u %8u %8u %8u\n", name, measure, set->numSamples,
+        statistic(st_p50, set), statistic(st_p99, set), statistic(st_max, set));
+}
+
+void HostTiming_report (
+    FILE* file)
+{
+    fprintf(file, "%-22s %-9s %8s %8s %8s %8s\n", "cycles", "", "count", "p50", "p99", "max");
+    reportSet("startup", "boot", &boot, file);
+    reportSet("main loop", "awake", &awake, file);
+    for (uint8_t v = 0; v < _VECTORS_SIZE; ++v) {
+        if (latencies[v].numSamples > 0) {
+            reportSet(vectorNames[v], "latency", &latencies[v], file);
+            reportSet("", "duration", &durations[v], file);
+        }
+    }
+}
+
+// finds the samples and statistic a metric name refers to.
+// Returns false if there is no such metric
+static bool findMetric (
+    const char* metric,
+    SampleSet** set,
+    Statistic* stat)
+{
+    const char* statName = strrchr(metric, '.');
+    if (statName == NULL) {
+        return false;
+    }
+    const size_t setNameLength = statName - metric;
+    ++statName;
+
+    *stat = st_count;
+    for (uint8_t s = 0; s < st_count; ++s) {
+        if (strcasecmp(statName, statisticNames[s]) == 0) {
+            *stat = (Statistic)s;
+        }
+    }
+
+    *set = NULL;
+    if ((setNameLength == 5) && (strncasecmp(metric, "awake", 5) == 0)) {
+        *set = &awake;
+    } else if ((setNameLength == 4) && (strncasecmp(metric, "boot", 4) == 0)) {
+        *set = &boot;
+    } else {
+        for (uint8_t v = 0; v < _VECTORS_SIZE; ++v) {
+            const size_t nameLength = strlen(vectorNames[v]);
+            if ((setNameLength > nameLength) &&
+                (strncasecmp(metric, vectorNames[v], nameLength) == 0) &&
+                (metric[nameLength] == '.')) {
+                const char* measure = &metric[nameLength + 1];
+                const size_t measureLength = setNameLength - nameLength - 1;
+                if ((measureLength == 7) && (strncasecmp(measure, "latency", 7) == 0)) {
+                    *set = &latencies[v];
+                } else if ((measureLength == 8) && (strncasecmp(measure, "duration", 8) == 0)) {
+                    *set = &durations[v];
+                }
+            }
+        }
+    }
+
+    return (*set != NULL) && (*stat != st_count);
+}
+
+bool HostTiming_checkBudgets (
+    const char* path,
+    const char* scenario,
+    FILE* file)
+{
+    FILE* budgets = fopen(path, "r");
+    if (budgets == NULL) {
+        perror(path);
+        return false;
+    }
+
+    bool withinBudget = true;
+    uint32_t lineNumber = 0;
+    uint32_t numChecked = 0;
+    char line[LINE_LENGTH];
+    while (fgets(line, sizeof(line), budgets) != NULL) {
+        ++lineNumber;
+        char* comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = 0;
+        }
+        char scenarioName[64];
+        char metric[64];
+        unsigned long limit;
+        const int numFields = sscanf(line, "%63s %63s %lu", scenarioName, metric, &limit);
+        if (numFields <= 0) {
+            continue;
+        }
+
+        SampleSet* set;
+        Statistic stat;
+        if ((numFields != 3) || !findMetric(metric, &set, &stat)) {
+            fprintf(file, "%s:%u: bad budget\n", path, lineNumber);
+            withinBudget = false;
+        } else if ((strcmp(scenarioName, "*") == 0) ||
+                   (strcmp(scenarioName, scenario) == 0)) {
+            const uint32_t value = statistic(stat, set);
+            ++numChecked;
+            if (value > limit) {
+                fprintf(file, "over budget: %s %s is %u cycles, budget %lu\n",
+                    scenario, metric, value, limit);
+                withinBudget = false;
+            }
+        }
+    }
+    fclose(budgets);
+
+    if (withinBudget) {
+        fprintf(file, "%s: within all %u budgets\n", scenario, numChecked);
+    }
+
+    return withinBudget;
+}
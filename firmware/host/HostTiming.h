@@ -0,0 +1,42 @@
+//
+//  Host Timing
+//
+//  Collects the interrupt latencies and durations, and the time the
+//  main loop spends awake between sleeps, from HostHAL's timing
+//  notifications, and reports them as percentiles. Startup, up to the
+//  first sleep, is counted separately (as boot). All figures are in
+//  simulated cycles (see HostHAL.h for what those measure).
+//
+//  Budgets are kept in a text file, one per line:
+//
+//      <scenario> <metric> <cycles>
+//
+//  where <scenario> is a scenario name or * for all of them, and
+//  <metric> is boot.<stat>, awake.<stat>, <interrupt>.latency.<stat>
+//  or <interrupt>.duration.<stat>. <stat> is p50, p99 or max, and
+//  <interrupt> is the handler's name in the firmware (for example
+//  SIG_OUTPUT_COMPARE0A). Blank lines and lines starting with # are
+//  ignored.
+//
+#ifndef HOSTTIMING_H
+#define HOSTTIMING_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// starts collecting, from HostHAL's timing notifications.
+// Call after HostHAL_Initialize
+extern void HostTiming_Initialize (void);
+
+extern void HostTiming_report (
+    FILE* file);
+
+// compares the figures with the budgets for <scenario> in the budgets
+// file, and reports any that are over. Returns false if any are over,
+// or the file can't be read
+extern bool HostTiming_checkBudgets (
+    const char* path,
+    const char* scenario,
+    FILE* file);
+
+#endif  // HOSTTIMING_H
@@ -0,0 +1,13 @@
+//
+//  avr/eeprom.h for the host build
+//
+//  The firmware reaches the EEPROM through its registers (see
+//  CommonCode/EEPROM.c), which HostHAL.c simulates. Nothing is
+//  needed here.
+//
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+
+#include <avr/io.h>
+
+#endif  // HOST_AVR_EEPROM_H
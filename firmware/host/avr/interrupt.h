@@ -0,0 +1,26 @@
+//
+//  avr/interrupt.h for the host build
+//
+//  ISR() defines an ordinary function with the vector's name. The
+//  simulated interrupt controller in HostHAL.c calls it.
+//
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+#define cli() HostHAL_cli()
+#define sei() HostHAL_sei()
+
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR_NAKED
+
+#define ISR(vector, ...) \
+    void vector (void); \
+    void vector (void)
+
+#define EMPTY_INTERRUPT(vector) \
+    void vector (void) {}
+
+#endif  // HOST_AVR_INTERRUPT_H
@@ -0,0 +1,312 @@
+//
+//  avr/io.h for the host build
+//
+//  Stands in for avr-libc's register definitions when the firmware is
+//  compiled for the host. Each register name expands to an lvalue in
+//  the simulated I/O space of an AtTiny84 (see HostHAL.h). Taking the
+//  address of a register lets the simulated peripherals catch up with
+//  simulated time first, so timer counts, pin levels and flags are
+//  current when the firmware reads them.
+//
+//  Only the registers and bits the firmware uses are defined.
+//
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+#include "HostHAL.h"
+
+#define _SFR_IO8(addr)  (*HostHAL_io8(addr))
+#define _SFR_IO16(addr) (*HostHAL_io16(addr))
+
+#define _BV(bit) (1 << (bit))
+
+// registers (I/O addresses)
+#define SREG    _SFR_IO8(0x3F)
+#define OCR0B   _SFR_IO8(0x3C)
+#define GIMSK   _SFR_IO8(0x3B)
+#define GIFR    _SFR_IO8(0x3A)
+#define TIMSK0  _SFR_IO8(0x39)
+#define TIFR0   _SFR_IO8(0x38)
+#define SPMCSR  _SFR_IO8(0x37)
+#define OCR0A   _SFR_IO8(0x36)
+#define MCUCR   _SFR_IO8(0x35)
+#define MCUSR   _SFR_IO8(0x34)
+#define TCCR0B  _SFR_IO8(0x33)
+#define TCNT0   _SFR_IO8(0x32)
+#define OSCCAL  _SFR_IO8(0x31)
+#define TCCR0A  _SFR_IO8(0x30)
+#define TCCR1A  _SFR_IO8(0x2F)
+#define TCCR1B  _SFR_IO8(0x2E)
+#define TCNT1   _SFR_IO16(0x2C)
+#define OCR1A   _SFR_IO16(0x2A)
+#define OCR1B   _SFR_IO16(0x28)
+#define DWDR    _SFR_IO8(0x27)
+#define CLKPR   _SFR_IO8(0x26)
+#define ICR1    _SFR_IO16(0x24)
+#define GTCCR   _SFR_IO8(0x23)
+#define TCCR1C  _SFR_IO8(0x22)
+#define WDTCSR  _SFR_IO8(0x21)
+#define PCMSK1  _SFR_IO8(0x20)
+#define EEAR    _SFR_IO16(0x1E)
+#define EEARL   _SFR_IO8(0x1E)
+#define EEARH   _SFR_IO8(0x1F)
+#define EEDR    _SFR_IO8(0x1D)
+#define EECR    _SFR_IO8(0x1C)
+#define PORTA   _SFR_IO8(0x1B)
+#define DDRA    _SFR_IO8(0x1A)
+#define PINA    _SFR_IO8(0x19)
+#define PORTB   _SFR_IO8(0x18)
+#define DDRB    _SFR_IO8(0x17)
+#define PINB    _SFR_IO8(0x16)
+#define GPIOR2  _SFR_IO8(0x15)
+#define GPIOR1  _SFR_IO8(0x14)
+#define GPIOR0  _SFR_IO8(0x13)
+#define PCMSK0  _SFR_IO8(0x12)
+#define USIBR   _SFR_IO8(0x10)
+#define USIDR   _SFR_IO8(0x0F)
+#define USISR   _SFR_IO8(0x0E)
+#define USICR   _SFR_IO8(0x0D)
+#define TIMSK1  _SFR_IO8(0x0C)
+#define TIFR1   _SFR_IO8(0x0B)
+#define ACSR    _SFR_IO8(0x08)
+#define ADMUX   _SFR_IO8(0x07)
+#define ADCSRA  _SFR_IO8(0x06)
+#define ADCH    _SFR_IO8(0x05)
+#define ADCL    _SFR_IO8(0x04)
+#define ADC     _SFR_IO16(0x04)
+#define ADCW    _SFR_IO16(0x04)
+#define ADCSRB  _SFR_IO8(0x03)
+#define DIDR0   _SFR_IO8(0x01)
+#define PRR     _SFR_IO8(0x00)
+
+// SREG
+#define SREG_I  7
+
+// GIMSK
+#define INT0    6
+#define PCIE1   5
+#define PCIE0   4
+
+// GIFR
+#define INTF0   6
+#define PCIF1   5
+#define PCIF0   4
+
+// TIMSK0 / TIFR0
+#define OCIE0B  2
+#define OCIE0A  1
+#define TOIE0   0
+#define OCF0B   2
+#define OCF0A   1
+#define TOV0    0
+
+// MCUCR
+#define BODS    7
+#define PUD     6
+#define SE      5
+#define SM1     4
+#define SM0     3
+#define BODSE   2
+#define ISC01   1
+#define ISC00   0
+
+// TCCR0A / TCCR0B
+#define COM0A1  7
+#define COM0A0  6
+#define COM0B1  5
+#define COM0B0  4
+#define WGM01   1
+#define WGM00   0
+#define FOC0A   7
+#define FOC0B   6
+#define WGM02   3
+#define CS02    2
+#define CS01    1
+#define CS00    0
+
+// TCCR1A / TCCR1B / TCCR1C
+#define COM1A1  7
+#define COM1A0  6
+#define COM1B1  5
+#define COM1B0  4
+#define WGM11   1
+#define WGM10   0
+#define ICNC1   7
+#define ICES1   6
+#define WGM13   4
+#define WGM12   3
+#define CS12    2
+#define CS11    1
+#define CS10    0
+#define FOC1A   7
+#define FOC1B   6
+
+// TIMSK1 / TIFR1
+#define ICIE1   5
+#define OCIE1B  2
+#define OCIE1A  1
+#define TOIE1   0
+#define ICF1    5
+#define OCF1B   2
+#define OCF1A   1
+#define TOV1    0
+
+// WDTCSR
+#define WDIF    7
+#define WDIE    6
+#define WDP3    5
+#define WDCE    4
+#define WDE     3
+#define WDP2    2
+#define WDP1    1
+#define WDP0    0
+
+// EECR
+#define EEPM1   5
+#define EEPM0   4
+#define EERIE   3
+#define EEMPE   2
+#define EEPE    1
+#define EERE    0
+
+// port pins
+#define PA7     7
+#define PA6     6
+#define PA5     5
+#define PA4     4
+#define PA3     3
+#define PA2     2
+#define PA1     1
+#define PA0     0
+#define PB3     3
+#define PB2     2
+#define PB1     1
+#define PB0     0
+
+// PCMSK0 / PCMSK1
+#define PCINT7  7
+#define PCINT6  6
+#define PCINT5  5
+#define PCINT4  4
+#define PCINT3  3
+#define PCINT2  2
+#define PCINT1  1
+#define PCINT0  0
+#define PCINT11 3
+#define PCINT10 2
+#define PCINT9  1
+#define PCINT8  0
+
+// USICR / USISR
+#define USISIE  7
+#define USIOIE  6
+#define USIWM1  5
+#define USIWM0  4
+#define USICS1  3
+#define USICS0  2
+#define USICLK  1
+#define USITC   0
+#define USISIF  7
+#define USIOIF  6
+#define USIPF   5
+#define USIDC   4
+#define USICNT3 3
+#define USICNT2 2
+#define USICNT1 1
+#define USICNT0 0
+
+// ACSR
+#define ACD     7
+#define ACBG    6
+#define ACO     5
+#define ACI     4
+#define ACIE    3
+#define ACIC    2
+#define ACIS1   1
+#define ACIS0   0
+
+// ADMUX
+#define REFS1   7
+#define REFS0   6
+#define MUX5    5
+#define MUX4    4
+#define MUX3    3
+#define MUX2    2
+#define MUX1    1
+#define MUX0    0
+
+// ADCSRA
+#define ADEN    7
+#define ADSC    6
+#define ADATE   5
+#define ADIF    4
+#define ADIE    3
+#define ADPS2   2
+#define ADPS1   1
+#define ADPS0   0
+
+// ADCSRB
+#define BIN     7
+#define ACME    6
+#define ADLAR   4
+#define ADTS2   2
+#define ADTS1   1
+#define ADTS0   0
+
+// DIDR0
+#define ADC7D   7
+#define ADC6D   6
+#define ADC5D   5
+#define ADC4D   4
+#define ADC3D   3
+#define ADC2D   2
+#define ADC1D   1
+#define ADC0D   0
+
+// PRR
+#define PRTIM1  3
+#define PRTIM0  2
+#define PRUSI   1
+#define PRADC   0
+
+// interrupt vectors
+#define INT0_vect           __vector_1
+#define PCINT0_vect         __vector_2
+#define PCINT1_vect         __vector_3
+#define WDT_vect            __vector_4
+#define TIM1_CAPT_vect      __vector_5
+#define TIM1_COMPA_vect     __vector_6
+#define TIM1_COMPB_vect     __vector_7
+#define TIM1_OVF_vect       __vector_8
+#define TIM0_COMPA_vect     __vector_9
+#define TIM0_COMPB_vect     __vector_10
+#define TIM0_OVF_vect       __vector_11
+#define ANA_COMP_vect       __vector_12
+#define ADC_vect            __vector_13
+#define EE_RDY_vect         __vector_14
+#define USI_STR_vect        __vector_15
+#define USI_OVF_vect        __vector_16
+#define _VECTORS_SIZE       17
+
+// old-style vector names
+#define SIG_INTERRUPT0          INT0_vect
+#define SIG_PIN_CHANGE0         PCINT0_vect
+#define SIG_PIN_CHANGE1         PCINT1_vect
+#define SIG_WATCHDOG_TIMEOUT    WDT_vect
+#define SIG_INPUT_CAPTURE1      TIM1_CAPT_vect
+#define SIG_OUTPUT_COMPARE1A    TIM1_COMPA_vect
+#define SIG_OUTPUT_COMPARE1B    TIM1_COMPB_vect
+#define SIG_OVERFLOW1           TIM1_OVF_vect
+#define SIG_OUTPUT_COMPARE0A    TIM0_COMPA_vect
+#define SIG_OUTPUT_COMPARE0B    TIM0_COMPB_vect
+#define SIG_OVERFLOW0           TIM0_OVF_vect
+#define SIG_COMPARATOR          ANA_COMP_vect
+#define SIG_ADC                 ADC_vect
+#define SIG_EEPROM_READY        EE_RDY_vect
+#define SIG_USI_START           USI_STR_vect
+#define SIG_USI_OVERFLOW        USI_OVF_vect
+
+#define E2END   0x1FF
+
+#endif  // HOST_AVR_IO_H
@@ -0,0 +1,45 @@
+//
+//  avr/pgmspace.h for the host build
+//
+//  There is only one address space on the host, so program memory
+//  strings and tables are ordinary const data.
+//
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+
+typedef const char* PGM_P;
+typedef const void* PGM_VOID_P;
+typedef int8_t prog_int8_t;
+typedef uint8_t prog_uint8_t;
+typedef int16_t prog_int16_t;
+typedef uint16_t prog_uint16_t;
+typedef int32_t prog_int32_t;
+typedef uint32_t prog_uint32_t;
+typedef char prog_char;
+
+#define pgm_read_byte(addr)         (*(const uint8_t*)(addr))
+#define pgm_read_byte_near(addr)    pgm_read_byte(addr)
+#define pgm_read_word(addr)         (*(const uint16_t*)(addr))
+#define pgm_read_word_near(addr)    pgm_read_word(addr)
+#define pgm_read_dword(addr)        (*(const uint32_t*)(addr))
+#define pgm_read_dword_near(addr)   pgm_read_dword(addr)
+
+#define memcpy_P        memcpy
+#define strcpy_P        strcpy
+#define strncpy_P       strncpy
+#define strcat_P        strcat
+#define strlen_P        strlen
+#define strcmp_P        strcmp
+#define strncmp_P       strncmp
+#define strcasecmp_P    strcasecmp
+#define strncasecmp_P   strncasecmp
+#define strstr_P        strstr
+
+#endif  // HOST_AVR_PGMSPACE_H
@@ -0,0 +1,30 @@
+//
+//  avr/sleep.h for the host build
+//
+//  sleep_cpu() lets simulated time run on to the next interrupt.
+//
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+
+#include <avr/io.h>
+
+#define SLEEP_MODE_IDLE         0
+#define SLEEP_MODE_ADC          (1 << SM0)
+#define SLEEP_MODE_PWR_DOWN     (1 << SM1)
+#define SLEEP_MODE_STANDBY      ((1 << SM1) | (1 << SM0))
+
+#define set_sleep_mode(mode) \
+    (MCUCR = (MCUCR & ~((1 << SM1) | (1 << SM0))) | (mode))
+
+#define sleep_enable()  (MCUCR |= (1 << SE))
+#define sleep_disable() (MCUCR &= ~(1 << SE))
+#define sleep_cpu()     HostHAL_sleep()
+
+#define sleep_mode() \
+    do { \
+        sleep_enable(); \
+        sleep_cpu(); \
+        sleep_disable(); \
+    } while (0)
+
+#endif  // HOST_AVR_SLEEP_H
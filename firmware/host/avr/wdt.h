@@ -0,0 +1,27 @@
+//
+//  avr/wdt.h for the host build
+//
+//  The simulated watchdog resets the chip (ends the run, see
+//  HostSim_watchdogReset) if it isn't reset within its timeout.
+//
+#ifndef HOST_AVR_WDT_H
+#define HOST_AVR_WDT_H
+
+#include <avr/io.h>
+
+#define WDTO_15MS   0
+#define WDTO_30MS   1
+#define WDTO_60MS   2
+#define WDTO_120MS  3
+#define WDTO_250MS  4
+#define WDTO_500MS  5
+#define WDTO_1S     6
+#define WDTO_2S     7
+#define WDTO_4S     8
+#define WDTO_8S     9
+
+#define wdt_enable(timeout) HostHAL_wdtEnable(timeout)
+#define wdt_disable()       HostHAL_wdtDisable()
+#define wdt_reset()         HostHAL_wdtReset()
+
+#endif  // HOST_AVR_WDT_H
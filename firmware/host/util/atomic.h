@@ -0,0 +1,40 @@
+//
+//  util/atomic.h for the host build
+//
+//  The same ATOMIC_BLOCK as avr-libc's, on the simulated SREG.
+//
+#ifndef HOST_UTIL_ATOMIC_H
+#define HOST_UTIL_ATOMIC_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+static inline uint8_t HostAtomic_cliReturnOne (void)
+{
+    cli();
+    return 1;
+}
+
+static inline void HostAtomic_restore (
+    const uint8_t* sregSave)
+{
+    SREG = *sregSave;
+}
+
+static inline void HostAtomic_forceOn (
+    const uint8_t* sregSave)
+{
+    (void)sregSave;
+    sei();
+}
+
+#define ATOMIC_BLOCK(type) \
+    for (type, atomicToDo = HostAtomic_cliReturnOne(); atomicToDo; atomicToDo = 0)
+
+#define ATOMIC_RESTORESTATE \
+    uint8_t sregSave __attribute__((__cleanup__(HostAtomic_restore))) = SREG
+#define ATOMIC_FORCEON \
+    uint8_t sregSave __attribute__((__cleanup__(HostAtomic_forceOn))) = 0
+
+#endif  // HOST_UTIL_ATOMIC_H
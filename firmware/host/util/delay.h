@@ -0,0 +1,14 @@
+//
+//  util/delay.h for the host build
+//
+//  Busy-wait delays advance simulated time instead of spinning.
+//
+#ifndef HOST_UTIL_DELAY_H
+#define HOST_UTIL_DELAY_H
+
+#include "HostHAL.h"
+
+#define _delay_us(us) HostHAL_delayCycles((uint64_t)((us) * (F_CPU / 1000000.0)))
+#define _delay_ms(ms) HostHAL_delayCycles((uint64_t)((ms) * (F_CPU / 1000.0)))
+
+#endif  // HOST_UTIL_DELAY_H